@@ -38,6 +38,9 @@ int init(call_t *to, void *params) {
    classdata->current_rx_control_packet = 0;
    classdata->current_tx_control_packet_bytes = 0;
    classdata->current_rx_control_packet_bytes = 0;  
+
+   /* resolve the packet header handles */
+   packet_header_fields_init(classdata);
    
     /* Assign the initialized local variables to the node */
     set_class_private_data(to, classdata);
@@ -72,7 +75,12 @@ int bind(call_t *to, void *params) {
   nodedata->neighbors = list_create();
   nodedata->routing_table = list_create();
   nodedata->rreq_table = list_create();
+  nodedata->rreq_backoff_table = list_create();
   nodedata->rrep_table = list_create();
+  nodedata->pending_table = list_create();
+  for (i=0; i<MAX_NEIGHBORS_SIZE; i++) {
+	nodedata->route_index[i] = NULL;
+  }
   nodedata->path_establishment_delay = -1;
   nodedata->sink_id = -1;
   for (i=0; i<5; i++) {
@@ -92,6 +100,15 @@ int bind(call_t *to, void *params) {
   nodedata->hello_start = 0;
   nodedata->hello_period = 1000000000ull; /* 1s */
   nodedata->hello_timeout = 3*nodedata->hello_period;  
+  nodedata->hello_imin = 0;
+  nodedata->hello_imax = 0;
+  nodedata->hello_k = 0;
+  nodedata->hello_interval = 0;
+  nodedata->hello_interval_start = 0;
+  nodedata->hello_counter = 0;
+  nodedata->hello_suppressed = 0;
+  nodedata->hello_epoch = 0;
+  nodedata->hello_callback = NULL;
   
   /* set the default values for the AODV protocol */
   nodedata->rreq_status = STATUS_OFF;        
@@ -105,7 +122,19 @@ int bind(call_t *to, void *params) {
   nodedata->rreq_seq = 0;
   nodedata->rrep_seq = 0;
   nodedata->rreq_ttl = 9999;
+  nodedata->rreq_ttl_start = 0; /* no expanding ring search */
+  nodedata->rreq_ttl_increment = 2;
+  nodedata->rreq_ttl_threshold = 7;
+  nodedata->rreq_suppression_mode = RREQ_SUPPRESSION_OFF;
+  nodedata->rreq_counter_threshold = 3;
+  nodedata->rreq_distance_threshold = 10.0;
   nodedata->rreq_data_type = -1;
+  nodedata->route_lifetime = 0; /* no expiry */
+  nodedata->local_repair_status = STATUS_ON;
+  nodedata->rreq_discovery_timeout = 1000000000ull; /* 1s */
+  nodedata->rreq_retries = 2;
+  nodedata->pending_queue_size = 16;
+  nodedata->pending_timeout = 5000000000ull; /* 5s */
 
   /* set the default values for the link quality estimator */
   nodedata->rssi_smoothing1_nbr = 1;
@@ -156,6 +185,21 @@ int bind(call_t *to, void *params) {
 	goto error;
       }
     }
+    if (!strcmp(param->key, "hello_imin")) {
+      if (get_param_time(param->value, &(nodedata->hello_imin))) {
+	goto error;
+      }
+    }
+    if (!strcmp(param->key, "hello_imax")) {
+      if (get_param_integer_range(param->value, &(nodedata->hello_imax), 0, 16)) {
+	goto error;
+      }
+    }
+    if (!strcmp(param->key, "hello_k")) {
+      if (get_param_integer(param->value, &(nodedata->hello_k))) {
+	goto error;
+      }
+    }
     /* reading the parameter related to the RREQ protocol from the xml file */
     if (!strcmp(param->key, "rreq_status")) {
       if (get_param_integer(param->value, &(nodedata->rreq_status))) {
@@ -177,6 +221,69 @@ int bind(call_t *to, void *params) {
 	goto error;
       }
     }
+    /* reading the parameter related to the route cache from the xml file */
+    if (!strcmp(param->key, "route_lifetime")) {
+      if (get_param_time(param->value, &(nodedata->route_lifetime))) {
+	goto error;
+      }
+    }
+    if (!strcmp(param->key, "local_repair_status")) {
+      if (get_param_integer(param->value, &(nodedata->local_repair_status))) {
+	goto error;
+      }
+    }
+    /* reading the parameter related to the expanding ring search and the RREQ suppression from the xml file */
+    if (!strcmp(param->key, "rreq_ttl_start")) {
+      if (get_param_integer(param->value, &(nodedata->rreq_ttl_start))) {
+	goto error;
+      }
+    }
+    if (!strcmp(param->key, "rreq_ttl_increment")) {
+      if (get_param_integer(param->value, &(nodedata->rreq_ttl_increment))) {
+	goto error;
+      }
+    }
+    if (!strcmp(param->key, "rreq_ttl_threshold")) {
+      if (get_param_integer(param->value, &(nodedata->rreq_ttl_threshold))) {
+	goto error;
+      }
+    }
+    if (!strcmp(param->key, "rreq_suppression_mode")) {
+      if (get_param_integer(param->value, &(nodedata->rreq_suppression_mode))) {
+	goto error;
+      }
+    }
+    if (!strcmp(param->key, "rreq_counter_threshold")) {
+      if (get_param_integer(param->value, &(nodedata->rreq_counter_threshold))) {
+	goto error;
+      }
+    }
+    if (!strcmp(param->key, "rreq_distance_threshold")) {
+      if (get_param_double(param->value, &(nodedata->rreq_distance_threshold))) {
+	goto error;
+      }
+    }
+    /* reading the parameter related to the route discovery and the waiting packets from the xml file */
+    if (!strcmp(param->key, "rreq_discovery_timeout")) {
+      if (get_param_time(param->value, &(nodedata->rreq_discovery_timeout))) {
+	goto error;
+      }
+    }
+    if (!strcmp(param->key, "rreq_retries")) {
+      if (get_param_integer(param->value, &(nodedata->rreq_retries))) {
+	goto error;
+      }
+    }
+    if (!strcmp(param->key, "pending_queue_size")) {
+      if (get_param_integer(param->value, &(nodedata->pending_queue_size))) {
+	goto error;
+      }
+    }
+    if (!strcmp(param->key, "pending_timeout")) {
+      if (get_param_time(param->value, &(nodedata->pending_timeout))) {
+	goto error;
+      }
+    }
     /* reading the parameter related to the link quality estimator from the xml file */
     if (!strcmp(param->key, "rssi_smoothing1_nbr")) {
       if (get_param_integer(param->value, &(nodedata->rssi_smoothing1_nbr))) {
@@ -225,6 +332,14 @@ int bind(call_t *to, void *params) {
 
   /* Check protocol status */
   nodedata->hello_status = (nodedata->hello_status > 0)? STATUS_ON : STATUS_OFF;	
+  nodedata->local_repair_status = (nodedata->local_repair_status > 0)? STATUS_ON : STATUS_OFF;	
+  if (nodedata->rreq_suppression_mode != RREQ_SUPPRESSION_COUNTER && nodedata->rreq_suppression_mode != RREQ_SUPPRESSION_DISTANCE) {
+    nodedata->rreq_suppression_mode = RREQ_SUPPRESSION_OFF;
+  }
+  if (nodedata->rreq_ttl_increment < 1) {
+    nodedata->rreq_ttl_increment = 1;
+  }
+  nodedata->pending_queue_size = (nodedata->pending_queue_size < 1)? 1 : (nodedata->pending_queue_size > MAX_PENDING_SIZE)? MAX_PENDING_SIZE : nodedata->pending_queue_size;
 	
   set_node_private_data(to, nodedata);
   return 0;
@@ -238,6 +353,7 @@ int unbind(call_t *to) {
  struct nodedata *nodedata = get_node_private_data(to);
  struct neighbor *neighbor = NULL;
  struct route_aodv *route = NULL;
+ struct rreq_backoff *backoff = NULL;
  
 #ifdef ROUTING_LOG_NODE_STATS
   int size_hello = (nodedata->hello_packet_real_size != -1) ? nodedata->hello_packet_real_size : (int)(nodedata->overhead + sizeof(struct packet_header)+sizeof(struct hello_packet_header));
@@ -270,10 +386,24 @@ int unbind(call_t *to) {
   while((route = (struct route_aodv *) list_traverse(nodedata->routing_table)) != NULL) {
     if (route->dst == 0) {
       printf("[NETWORK_GRAPHVIZ] %d -> %d [style=bold]; \n", to->object, route->nexthop_id);
-      free(route);
     }
   }
 
+  /* free the routing table */
+  while ((route = (struct route_aodv *) list_pop(nodedata->routing_table)) != NULL) {
+	free(route);
+  }
+  list_destroy(nodedata->routing_table);    
+
+  /* free the data packets still waiting for a route */
+  route_pending_destroy(to);
+
+  /* free the RREQ packets waiting for their rebroadcast */
+  while ((backoff = (struct rreq_backoff *) list_pop(nodedata->rreq_backoff_table)) != NULL) {
+	free(backoff);
+  }
+  list_destroy(nodedata->rreq_backoff_table);
+
   free(nodedata);
   return 0;
 }
@@ -291,10 +421,7 @@ int bootstrap(call_t *to) {
         
   /* start the neighbor discovery protocol */
   if (nodedata->hello_status == STATUS_ON && (nodedata->hello_nbr > 0 || nodedata->hello_nbr == -1)) {
-    uint64_t hello_slot_time = get_time() + nodedata->hello_start;
-    uint64_t hello_tx_time = hello_slot_time + get_random_double() * nodedata->hello_period;
-    nodedata->previous_hello_slot_time = hello_slot_time; 
-	scheduler_add_callback(hello_tx_time, to, &from, neighbor_discovery_callback_aodv, NULL);
+    neighbor_hello_start(to, &from, neighbor_discovery_callback_aodv);
   }
 
    /* start the periodic RREQ generation */
@@ -329,21 +456,32 @@ int set_header(call_t *to, call_t *from, packet_t *packet, destination_t *dst) {
 
   /* check for a route to the destination */
   if (dst->id != BROADCAST_ADDR) {
-	  /* if no route, return -1 */
+	  /* if no route, the packet waits in tx() for the route discovery */
 	  if ( (route = route_get_nexthop_to_destination(to, dst->id)) == NULL) {
 #ifdef ROUTING_DEBUG	  
 		printf("[ROUTING_DATA_SETHEADER] node %d no route to destination %d ==> broadcast RREQ...\n", to->object, dst->id);
 #endif
-		rreq_propagation_callback(to, from, (void *)dst);
-		return -1;
+		rreq_route_discovery(to, dst->id);
+
+		header->dst = -1;
+		header->nexthop = PENDING_ADDR;
+		header->end_dst = dst->id;
+		header->src = to->object;
+		header->prevhop = to->object;
+		header->type = nodedata->node_type;
+		header->packet_type = DATA_PACKET;
+		header->hop = 0;
+		return 0;
 	  }
 	  destination.id = route->nexthop_id;
 	  header->dst = route->nexthop_id;
+	  header->nexthop = route->nexthop_id;
 	  header->end_dst = dst->id;
   }
   else {
 	  destination.id = BROADCAST_ADDR;
 	  header->dst = BROADCAST_ADDR;
+	  header->nexthop = BROADCAST_ADDR;
   }
 #ifdef ROUTING_DEBUG	  
   printf("[ROUTING_DATA_SETHEADER] node %d route to destination %d ==> nexthop = %d...\n", to->object, dst->id, destination.id);
@@ -351,6 +489,7 @@ int set_header(call_t *to, call_t *from, packet_t *packet, destination_t *dst) {
 
   /* set packet header */
   header->src = to->object;
+  header->prevhop = to->object;
   header->type = nodedata->node_type;
   header->packet_type = DATA_PACKET;
   header->hop = 0;
@@ -393,10 +532,15 @@ int get_header_real_size(call_t *to, call_t *from) {
 /* ************************************************** */
 void tx(call_t *to, call_t* from, packet_t *packet) {
   struct nodedata *nodedata = get_node_private_data(to);
-  field_t *field_header = packet_retrieve_field(packet, "packet_header");
-  struct packet_header* header = (struct packet_header*) field_getValue(field_header);
+  struct packet_header* header = (struct packet_header*) packet_header_get(to, packet, HEADER_FIELD_PACKET);
   call_t to0   = {get_class_bindings_down(to)->elts[0], to->object};
   call_t from0 = {to->class, to->object};
+
+  /* keep the data packet until the route discovery completes */
+  if (header->nexthop == PENDING_ADDR) {
+    route_pending_insert(to, packet, header->end_dst);
+    return;
+  }
   
   TX(&to0, &from0, packet);
 
@@ -416,11 +560,10 @@ void tx(call_t *to, call_t* from, packet_t *packet) {
 void rx(call_t *to, call_t *from, packet_t *packet) {
   struct nodedata *nodedata = get_node_private_data(to);
   struct classdata *classdata = get_class_private_data(to);
-  field_t *field_rreq_packet_header, *field_rrep_header;
   
-  field_t *field_header = packet_retrieve_field(packet, "packet_header");
-  struct packet_header* header = (struct packet_header*) field_getValue(field_header);
+  struct packet_header* header = (struct packet_header*) packet_header_get(to, packet, HEADER_FIELD_PACKET);
   
+  struct hello_packet_header *hello_header;
   struct rreq_packet_header *rreq_header;
   struct rrep_packet_header *rrep_header;
   struct route_aodv* route;
@@ -449,25 +592,25 @@ void rx(call_t *to, call_t *from, packet_t *packet) {
   
   /* Update neighbor table from other packets than hello packets */
   if (nodedata->hello_status == STATUS_ON && header->packet_type != HELLO_PACKET) {
-	//neighbor_update_from_aodv_packet(c, packet);
+	//neighbor_update_from_aodv_packet(to, packet, header);
   }
   
   /* process the received packet  */
   switch(header->packet_type) {
     case HELLO_PACKET:         
 			/* update local neighbor table */
-			neighbor_update_from_aodv_hello(to, packet);
+			hello_header = (struct hello_packet_header*) packet_header_get(to, packet, HEADER_FIELD_HELLO);
+			neighbor_update_from_aodv_hello(to, packet, header, hello_header);
 			/* destroy hello packet */
 			packet_dealloc(packet);
 			break;
 
 	case RREQ_PACKET: 
 			/* extract RREQ packet header */
-			field_rreq_packet_header = packet_retrieve_field(packet, "rreq_packet_header");
-			rreq_header = (struct rreq_packet_header*) field_getValue(field_rreq_packet_header);
+			rreq_header = (struct rreq_packet_header*) packet_header_get(to, packet, HEADER_FIELD_RREQ);
   
 			/* update routing table according to received RREQ */
-			route_update_from_rreq(to, packet);
+			route_update_from_rreq(to, header, rreq_header);
 
 			//printf("[ROUTING_LOG_RX] Node %d received RREQ from %d towards %d \n", to->object, rreq_header->src, rreq_header->dst);
 			
@@ -513,7 +656,13 @@ void rx(call_t *to, call_t *from, packet_t *packet) {
 		#ifdef ROUTING_LOG_RX
 				printf("[ROUTING_LOG_RX_RREQ] Time %lfs Node %d has received an RREQ packet from node %d => propagate RREQ packet towards node %d \n", get_time()*0.000000001, to->object, header->src, rreq_header->dst);
 		#endif
-				 scheduler_add_callback(get_time() + get_random_double() * nodedata->rreq_propagation_backoff, to, from, rreq_propagation, (void *)(packet));
+				/* first copy: wait for the backoff, the other copies are only counted */
+				if (rreq_backoff_update(to, rreq_header) == 0) {
+				  scheduler_add_callback(get_time() + get_random_double() * nodedata->rreq_propagation_backoff, to, from, rreq_propagation, (void *)(packet));
+				}
+				else {
+				  packet_dealloc(packet);
+				}
 			} 
 
 			/* else destroy the received packet */
@@ -528,13 +677,12 @@ void rx(call_t *to, call_t *from, packet_t *packet) {
 			break;
 			
 	case RREP_PACKET: 
-			field_rrep_header = packet_retrieve_field(packet, "rrep_packet_header");
-			rrep_header = (struct rrep_packet_header*) field_getValue(field_rrep_header);
+			rrep_header = (struct rrep_packet_header*) packet_header_get(to, packet, HEADER_FIELD_RREP);
   
 			printf("[ROUTING_LOG_RX_RREP] Time %lfs node %d received a RREP packet:  src=%d, dst=%d, nexthop=%d, seq=%d, hop_to_dst=%d \n", get_time()*0.000000001, to->object, rrep_header->src, rrep_header->dst, header->dst, rrep_header->seq, rrep_header->hop_to_dst);
   
 			/* update routing table according to received RREP */
-			route_update_from_rrep(to, packet);
+			route_update_from_rrep(to, header, rrep_header);
 			
 			/* update the local sink id */
 			nodedata->sink_id = rrep_header->src;
@@ -39,6 +39,9 @@ int init(call_t *to, void *params) {
    classdata->current_rx_control_packet = 0;
    classdata->current_tx_control_packet_bytes = 0;
    classdata->current_rx_control_packet_bytes = 0;  
+
+   /* resolve the packet header handles */
+   packet_header_fields_init(classdata);
    
     /* Assign the initialized local variables to the node */
     set_class_private_data(to, classdata);
@@ -73,16 +76,32 @@ int bind(call_t *to, void *params) {
   nodedata->neighbors = list_create();
   nodedata->routing_table = list_create();
   nodedata->interest_table = list_create();
+  nodedata->interest_pending = list_create();
+  nodedata->interest_flush_scheduled = 0;
+  nodedata->interest_aggregation_size = MAX_AGGREGATED_INTERESTS;
+  nodedata->aggregation_table = list_create();
+  nodedata->duplicate_table = hashtable_create(route_duplicate_hash, route_duplicate_equal, NULL, free);
+  for (i=0; i<MAX_DATA_TYPES; i++) {
+	nodedata->aggregation_function[i] = AGGREGATION_OFF;
+  }
+  nodedata->aggregation_hold = 100000000ull; /* 100ms */
+  nodedata->aggregation_max_size = MAX_AGGREGATED_DATA;
+  nodedata->gradient_table = list_create();
   nodedata->path_establishment_delay = -1;
   for (i=0; i<5; i++) {
 	nodedata->rx_nbr[i] = 0;
 	nodedata->tx_nbr[i] = 0;
   }
+  for (i=0; i<MAX_NEIGHBORS_SIZE; i++) {
+	nodedata->gradient_index[i] = NULL;
+  }
+  nodedata->data_seq = 0;
   nodedata->data_packet_size = -1;
   
   /* set the default values for the real sizes of packets */
   nodedata->hello_packet_real_size     = 16; // as in OLSR v2 RFC3626
   nodedata->interest_packet_real_size  = 12; // as in OLSR v2 RFC3626
+  nodedata->interest_entry_real_size  = 8;
   
   /* set the default values for the hello protocol */
   nodedata->hello_status = STATUS_ON;
@@ -90,6 +109,20 @@ int bind(call_t *to, void *params) {
   nodedata->hello_start = 0;
   nodedata->hello_period = 1000000000ull; /* 1s */
   nodedata->hello_timeout = 3*nodedata->hello_period;
+  nodedata->hello_imin = 0;
+  nodedata->hello_imax = 0;
+  nodedata->hello_k = 0;
+  nodedata->hello_interval = 0;
+  nodedata->hello_interval_start = 0;
+  nodedata->hello_counter = 0;
+  nodedata->hello_suppressed = 0;
+  nodedata->hello_epoch = 0;
+  nodedata->hello_callback = NULL;
+  nodedata->last_tx_time = 0;
+  nodedata->delayed_hello = 0;
+  nodedata->hello_window_start = 0;
+  nodedata->hello_seq = 0;
+  nodedata->hello_piggyback_unicast = STATUS_OFF;
 
   /* set the default values for the link quality estimator */
   nodedata->rssi_smoothing1_nbr = 1;
@@ -108,6 +141,10 @@ int bind(call_t *to, void *params) {
   nodedata->sink_interest_period = 10000000000ull; /* 10s */
   nodedata->sink_interest_ttl = 100;
   nodedata->sink_interest_data_type = -1;
+
+  /* set the default values for the gradients (0 = derived from the interest period) */
+  nodedata->gradient_timeout = 0;
+  nodedata->reinforcement_period = 0;
   
   /* get params */
   list_init_traverse(params);
@@ -146,6 +183,21 @@ int bind(call_t *to, void *params) {
 	goto error;
       }
     }
+    if (!strcmp(param->key, "hello_imin")) {
+      if (get_param_time(param->value, &(nodedata->hello_imin))) {
+	goto error;
+      }
+    }
+    if (!strcmp(param->key, "hello_imax")) {
+      if (get_param_integer_range(param->value, &(nodedata->hello_imax), 0, 16)) {
+	goto error;
+      }
+    }
+    if (!strcmp(param->key, "hello_k")) {
+      if (get_param_integer(param->value, &(nodedata->hello_k))) {
+	goto error;
+      }
+    }
 	
     /* reading the parameter related to the interest dissemination protocol from the xml file */
     if (!strcmp(param->key, "sink_interest_status")) {
@@ -183,6 +235,26 @@ int bind(call_t *to, void *params) {
 	goto error;
       }
     }
+    if (!strcmp(param->key, "aggregation")) {
+      if (route_aggregation_set(nodedata, param->value)) {
+	goto error;
+      }
+    }
+    if (!strcmp(param->key, "aggregation_hold")) {
+      if (get_param_time(param->value, &(nodedata->aggregation_hold))) {
+	goto error;
+      }
+    }
+    if (!strcmp(param->key, "aggregation_max_size")) {
+      if (get_param_integer(param->value, &(nodedata->aggregation_max_size))) {
+	goto error;
+      }
+    }
+    if (!strcmp(param->key, "interest_aggregation_size")) {
+      if (get_param_integer(param->value, &(nodedata->interest_aggregation_size))) {
+	goto error;
+      }
+    }
     if (!strcmp(param->key, "sink_interest_data_type")) {
       if (get_param_integer(param->value, &(nodedata->sink_interest_data_type))) {
 	goto error;
@@ -212,6 +284,16 @@ int bind(call_t *to, void *params) {
     }
 	
     /* reading the parameter related to the real sizes of packets from the xml file */
+    if (!strcmp(param->key, "gradient_timeout")) {
+      if (get_param_time(param->value, &(nodedata->gradient_timeout))) {
+	goto error;
+      }
+    }
+    if (!strcmp(param->key, "reinforcement_period")) {
+      if (get_param_time(param->value, &(nodedata->reinforcement_period))) {
+	goto error;
+      }
+    }
     if (!strcmp(param->key, "hello_packet_real_size")) {
       if (get_param_integer(param->value, &(nodedata->hello_packet_real_size))) {
 	goto error;
@@ -222,6 +304,11 @@ int bind(call_t *to, void *params) {
 	goto error;
       }
     }	
+    if (!strcmp(param->key, "interest_entry_real_size")) {
+      if (get_param_integer(param->value, &(nodedata->interest_entry_real_size))) {
+	goto error;
+      }
+    }
 	
   }
     
@@ -233,11 +320,28 @@ int bind(call_t *to, void *params) {
   /* Check protocol status */
   nodedata->hello_status = (nodedata->hello_status > 0)? STATUS_ON : STATUS_OFF;
   nodedata->sink_interest_status = (nodedata->sink_interest_status > 0)? STATUS_ON : STATUS_OFF;
+  nodedata->aggregation_max_size = (nodedata->aggregation_max_size < 2)? 2 : (nodedata->aggregation_max_size > MAX_AGGREGATED_DATA)? MAX_AGGREGATED_DATA : nodedata->aggregation_max_size;
+  nodedata->interest_aggregation_size = (nodedata->interest_aggregation_size < 1)? 1 : (nodedata->interest_aggregation_size > MAX_AGGREGATED_INTERESTS)? MAX_AGGREGATED_INTERESTS : nodedata->interest_aggregation_size;
+
+  /* Gradients survive the loss of two consecutive interests, sinks reinforce once per interest */
+  if (nodedata->gradient_timeout == 0) {
+    nodedata->gradient_timeout = 3*nodedata->sink_interest_period;
+  }
+  if (nodedata->reinforcement_period == 0) {
+    nodedata->reinforcement_period = nodedata->sink_interest_period;
+  }
 	
   set_node_private_data(to, nodedata);
   return 0;
     
  error:
+  list_destroy(nodedata->neighbors);
+  list_destroy(nodedata->routing_table);
+  list_destroy(nodedata->interest_table);
+  list_destroy(nodedata->interest_pending);
+  list_destroy(nodedata->aggregation_table);
+  hashtable_destroy(nodedata->duplicate_table);
+  list_destroy(nodedata->gradient_table);
   free(nodedata);
   return -1;
 }
@@ -269,6 +373,10 @@ int unbind(call_t *to) {
   }
   
   list_destroy(nodedata->neighbors);    
+  sink_interest_pending_destroy(to);
+  route_aggregation_destroy(to);
+  route_duplicate_destroy(to);
+  gradient_destroy(to);
   free(nodedata);
   return 0;
 }
@@ -286,10 +394,7 @@ int bootstrap(call_t *to) {
         
   /* start the neighbor discovery protocol */
   if (nodedata->hello_status == STATUS_ON && (nodedata->hello_nbr > 0 || nodedata->hello_nbr == -1)) {
-    uint64_t hello_slot_time = get_time() + nodedata->hello_start;
-    uint64_t hello_tx_time = hello_slot_time + get_random_double() * nodedata->hello_period;
-    nodedata->previous_hello_slot_time = hello_slot_time; 
-	scheduler_add_callback(hello_tx_time, to, &from, neighbor_discovery_callback_aodv, NULL);
+    neighbor_hello_start(to, &from, neighbor_discovery_callback_aodv);
   }
 
   /* start the sink interest propagation protocol */
@@ -319,19 +424,15 @@ int set_header(call_t *to, call_t *from, packet_t *packet, destination_t *dst) {
   field_t *field_packet_header = field_create(INT, sizeof(struct packet_header), header);
   packet_add_field(packet, "packet_header", field_packet_header);
   
-  struct route *route = NULL;
+  struct gradient_entry *entry = NULL;
+  struct gradient *gradient = NULL;
   
-  /* check for a route to the closest sink */
-  if (dst->id == BROADCAST_ADDR) {
-    route = route_get_nexthop(to, -1);
-  }
-  /* check for a route to a particular sink */
-  else {
-    route = route_get_nexthop(to, dst->id);
-  }
+  /* check for a gradient towards the closest sink or a particular sink */
+  entry = gradient_get_closest(to, (dst->id == BROADCAST_ADDR) ? -1 : dst->id);
+  gradient = gradient_get_nexthop(to, entry);
 
-  /* if no route, return -1 */
-  if (route == NULL) {
+  /* if no gradient, return -1 */
+  if (gradient == NULL) {
     printf("[LOCALG_NET_SETHEADER] node %d no route to destination %d\n", to->object, dst->id);
     return -1;
   }
@@ -339,18 +440,22 @@ int set_header(call_t *to, call_t *from, packet_t *packet, destination_t *dst) {
   /* set routing header */
   header->src = to->object;
   header->dst = dst->id;
+  header->sink_id = entry->sink_id;
+  header->data_type = entry->data_type;
+  header->prevhop = to->object;
+  header->seq = nodedata->data_seq++;
   header->type = nodedata->node_type;
   header->packet_type = DATA_PACKET;
   header->hop = 0;
   
   /* Set mac header */
-  destination.id = route->nexthop_id;
+  destination.id = gradient->neighbor;
   destination.position.x = -1;
   destination.position.y = -1;
   destination.position.z = -1;
   
   /* Return the hop number to the upper layer */
-  dst->position.x = route->hop_to_sink;
+  dst->position.x = gradient->hop_to_sink;
   
   return SET_HEADER(&to0, to, packet, &destination);
 }
@@ -381,8 +486,7 @@ int get_header_real_size(call_t *to, call_t *from) {
 void tx(call_t *to, call_t* from, packet_t *packet) {
   struct nodedata *nodedata = get_node_private_data(to);
   
-  field_t *field_header = packet_retrieve_field(packet, "packet_header");
-  struct packet_header* header = (struct packet_header*) field_getValue(field_header);
+  struct packet_header* header = (struct packet_header*) packet_header_get(to, packet, HEADER_FIELD_PACKET);
   
   call_t to0   = {get_class_bindings_down(to)->elts[0], to->object};
   call_t from0 = {to->class, to->object};
@@ -408,8 +512,13 @@ void rx(call_t *to, call_t *from, packet_t *packet) {
   struct nodedata *nodedata = get_node_private_data(to);
   struct classdata *classdata = get_class_private_data(to);
   
-  field_t *field_header = packet_retrieve_field(packet, "packet_header");
-  struct packet_header* header = (struct packet_header*) field_getValue(field_header);
+  struct packet_header* header = (struct packet_header*) packet_header_get(to, packet, HEADER_FIELD_PACKET);
+  
+  struct hello_packet_header *hello_header = NULL;
+  struct sink_interest_packet_header *interest_header = NULL;
+  int upstream = -1;
+  int reinforcement = REINFORCEMENT_NONE;
+  int duplicate = 0;
   
   array_t *up = get_class_bindings_up(to);
   int i = up->size;
@@ -434,16 +543,25 @@ void rx(call_t *to, call_t *from, packet_t *packet) {
   switch(header->packet_type) {
   case HELLO_PACKET:         
     /* update local neighbor table */
-    neighbor_update(to, packet);
+    hello_header = (struct hello_packet_header*) packet_header_get(to, packet, HEADER_FIELD_HELLO);
+    neighbor_update(to, packet, header, hello_header);
     /* destroy hello packet */
     packet_dealloc(packet);
     break;
 
   case SINK_INTEREST_PACKET:
-    /* update routing table of sensor nodes ans schedule packet retransmission using a random backoff period */
-    if (nodedata->node_type == SENSOR_NODE) {
-      route_update_from_interest(to, packet);
-      scheduler_add_callback(get_time() + get_random_double() * nodedata->sink_interest_propagation_backoff, to, from, sink_interest_propagation, (void *)(packet));
+    interest_header = (struct sink_interest_packet_header*) packet_header_get(to, packet, HEADER_FIELD_SINK_INTEREST);
+    /* apply reinforcements and forward them towards the data sources */
+    if (interest_header->reinforcement != REINFORCEMENT_NONE) {
+      if (nodedata->node_type == SENSOR_NODE && (upstream = gradient_reinforce(to, header, interest_header)) != -1) {
+        struct gradient *gradient = gradient_get_nexthop(to, gradient_lookup(to, interest_header->sink_id, interest_header->data_type, 0));
+        sink_interest_reinforcement(to, upstream, interest_header->sink_id, interest_header->data_type, interest_header->seq, (gradient != NULL) ? gradient->hop_to_sink : interest_header->ttl_max, interest_header->reinforcement);
+      }
+      packet_dealloc(packet);
+    }
+    /* update gradients of sensor nodes and schedule the rebroadcast of new Interests using a random backoff period */
+    else if (nodedata->node_type == SENSOR_NODE) {
+      sink_interest_receive(to, packet, header, interest_header, gradient_update_from_interest);
     } 
     /* sink and anchor will destroy received packet */
     else {
@@ -457,6 +575,20 @@ void rx(call_t *to, call_t *from, packet_t *packet) {
     header->hop++;
 
     if (nodedata->node_type == SINK_NODE && (header->dst == -1 || header->dst == to->object)) {
+      /* reinforce the delivering neighbor, drop duplicates received over redundant paths */
+      duplicate = gradient_update_from_data(to, header, &reinforcement);
+      if (reinforcement != REINFORCEMENT_NONE) {
+        struct gradient_entry *entry = gradient_lookup(to, to->object, header->data_type, 0);
+        if (entry == NULL) {
+          packet_dealloc(packet);
+          break;
+        }
+        sink_interest_reinforcement(to, header->prevhop, to->object, header->data_type, entry->reinforcement_seq, 0, reinforcement);
+      }
+      if (duplicate) {
+        packet_dealloc(packet);
+        break;
+      }
 #ifdef ROUTING_LOG_DATA_RX
       printf("[ROUTING_LOG_DATA_RX]  DST %d has received a data packet from source node %d hops nbr = %d - forwarding to upper layer \n", to->object, header->src, header->hop);
 #endif
@@ -475,9 +607,9 @@ void rx(call_t *to, call_t *from, packet_t *packet) {
 		}   
 
     }
-    /* forward the data packet to the closest/particular sink */
+    /* forward the data packet to the closest/particular sink, after aggregation if enabled for its data type */
     else {
-      route_forward_data_packet(to, from, packet);
+      route_aggregate_data_packet(to, from, packet, header->sink_id, route_forward_data_packet);
     }
     break;
     
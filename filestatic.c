@@ -3,21 +3,40 @@
  *  \brief  Static routing extracted from file
  *  \author Elyes Ben Hamida and Guillaume Chelius
  *  \date   2007
+ *
+ *  The route file is either a text file of "id dst n_hop" lines, or its 
+ *  binary precompiled form, which is mapped and used without any copy.
+ *  The offline compiler is built from this file:
+ *    cc -DFILESTATIC_COMPILER -o filestatic_compiler filestatic.c
+ *    ./filestatic_compiler routing.data routing.bin
  **/
 #include <stdio.h>
-
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#ifdef FILESTATIC_COMPILER
+#include <stdlib.h>
+#include <string.h>
+typedef int nodeid_t;
+#else
 #include <kernel/modelutils.h>
+#endif
 
 #define UNUSED __attribute__((unused))
 
 /* ************************************************** */
 /* ************************************************** */
+#ifndef FILESTATIC_COMPILER
 model_t model =  {
   "Static routing",
   "Elyes Ben Hamida and Guillaume Chelius",
   "0.1",
   MODELTYPE_ROUTING
 };
+#endif
 
 
 /* ************************************************** */
@@ -32,12 +51,48 @@ struct routing_header {
   nodeid_t src;
 };
 
+/* Binary route file: the header, then the offsets (nodes + 1) and 
+ * the routes (nb_routes), in the byte order of the compiling host, 
+ * recorded in the header: files of the other byte order are rejected 
+ */
+#define BINARY_MAGIC "WSNETRT2"
+#define BINARY_BYTE_ORDER 0x01020304
+
+struct binary_header {
+  char magic[8];
+  uint32_t byte_order;
+  int32_t nodes;
+  int32_t route_size;
+  int32_t reserved;
+  int64_t nb_routes;
+};
+
+/* Routes of all the nodes, sorted by node then by destination: 
+ * the routes of node i are routes[offsets[i]..offsets[i+1]-1] 
+ */
 struct classdata {
-  FILE *file;
+  struct route *routes;
+  int64_t *offsets;
+  int nodes;
+  char *map;          /* mapped binary file, NULL for a text file */
+  long map_size;
 };
 
+/* Slot of the per-node open-addressing route map */
+struct route_slot {
+  nodeid_t dst;
+  int32_t index;      /* index in the node routes, -1 if the slot is empty */
+};
+
+/* The node routes are either indexed directly by destination (dense, 
+ * when the destinations are contiguous) or through the route map 
+ */
 struct nodedata {
-  void *routes;
+  struct route *routes;
+  long nb_routes;
+  int dense;
+  struct route_slot *slots;
+  unsigned long mask;
   int overhead;
 };
 
@@ -50,15 +105,355 @@ int routing_header_size = sizeof(nodeid_t) + sizeof(nodeid_t);
 
 /* ************************************************** */
 /* ************************************************** */
-unsigned long route_hash(void *key) { 
-  return (unsigned long) key;
+/* Stable merge sort of a slice by destination, with a scratch buffer 
+ * as long as the slice: the first route of a duplicated destination 
+ * stays first 
+ */
+void route_sort(struct route *routes, struct route *scratch, long nb_routes) {
+  long width, left, mid, right, i, j, k;
+
+  for (width = 1; width < nb_routes; width *= 2) {
+    for (left = 0; left < nb_routes; left += 2 * width) {
+      mid = (left + width < nb_routes) ? left + width : nb_routes;
+      right = (left + 2 * width < nb_routes) ? left + 2 * width : nb_routes;
+      for (i = left, j = mid, k = left; k < right; k++) {
+        if (i < mid && (j == right || routes[i].dst <= routes[j].dst)) {
+          scratch[k] = routes[i++];
+        } else {
+          scratch[k] = routes[j++];
+        }
+      }
+    }
+    for (k = 0; k < nb_routes; k++) {
+      routes[k] = scratch[k];
+    }
+  }
 }
 
-int route_equal(void *key0, void *key1) { 
-  return (int) (key0 == key1);
+/* Parse an integer, skipping the leading blanks */
+int parse_integer(char **p, char *end, int *value) {
+  int sign = 1;
+  int n = 0;
+
+  while (*p < end && (**p == ' ' || **p == '\t')) {
+    (*p)++;
+  }
+  if (*p < end && **p == '-') {
+    sign = -1;
+    (*p)++;
+  }
+  if (*p == end || **p < '0' || **p > '9') {
+    return -1;
+  }
+  while (*p < end && **p >= '0' && **p <= '9') {
+    n = n * 10 + (**p - '0');
+    (*p)++;
+  }
+  *value = sign * n;
+  return 0;
 }
 
+/* Parse the "id dst n_hop" lines of the routing file in a single pass, 
+ * sort the routes by node (counting sort) then by destination, and 
+ * keep the first route of a duplicated destination 
+ */
+int parse_routes(struct classdata *classdata, char *data, long size) {
+  char *p = data, *end = data + size;
+  long nb_routes = 0, max_routes = 1024, kept = 0, start, i;
+  int *ids = malloc(max_routes * sizeof(int));
+  struct route *routes = malloc(max_routes * sizeof(struct route));
+  int id, dst, n_hop;
+
+  classdata->nodes = 0;
+  while (1) {
+    /* skip blank lines */
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) {
+      p++;
+    }
+    if (p == end) {
+      break;
+    }
 
+    if (parse_integer(&p, end, &id) || parse_integer(&p, end, &dst) || parse_integer(&p, end, &n_hop) || id < 0) {
+      fprintf(stderr, "filestatic: unable to read route in init()\n");
+      goto error;
+    }
+    /* ignore the end of the line, as sscanf() did */
+    while (p < end && *p != '\n') {
+      p++;
+    }
+
+    if (nb_routes == max_routes) {
+      max_routes *= 2;
+      ids = realloc(ids, max_routes * sizeof(int));
+      routes = realloc(routes, max_routes * sizeof(struct route));
+    }
+    ids[nb_routes] = id;
+    routes[nb_routes].dst = dst;
+    routes[nb_routes].n_hop = n_hop;
+    nb_routes++;
+    if (id >= classdata->nodes) {
+      classdata->nodes = id + 1;
+    }
+  }
+
+  /* counting sort by node, stable: each slice keeps the file order */
+  classdata->offsets = calloc(classdata->nodes + 1, sizeof(int64_t));
+  classdata->routes = malloc((nb_routes + 1) * sizeof(struct route));
+  for (i = 0; i < nb_routes; i++) {
+    classdata->offsets[ids[i] + 1]++;
+  }
+  for (id = 0; id < classdata->nodes; id++) {
+    classdata->offsets[id + 1] += classdata->offsets[id];
+  }
+  for (i = nb_routes - 1; i >= 0; i--) {
+    classdata->routes[--classdata->offsets[ids[i] + 1]] = routes[i];
+  }
+  /* the decrements left offsets[id + 1] on the first route of node id */
+  for (id = 0; id < classdata->nodes; id++) {
+    classdata->offsets[id] = classdata->offsets[id + 1];
+  }
+  classdata->offsets[classdata->nodes] = nb_routes;
+
+  /* each slice is sorted by destination for the lookups (the parsed 
+   * routes are no longer needed and serve as scratch buffer), then 
+   * compacted on the first route of each destination 
+   */
+  for (id = 0; id < classdata->nodes; id++) {
+    start = classdata->offsets[id];
+    route_sort(classdata->routes + start, routes, classdata->offsets[id + 1] - start);
+    classdata->offsets[id] = kept;
+    for (i = start; i < classdata->offsets[id + 1]; i++) {
+      if (kept == classdata->offsets[id] || classdata->routes[i].dst != classdata->routes[kept - 1].dst) {
+        classdata->routes[kept++] = classdata->routes[i];
+      }
+    }
+  }
+  classdata->offsets[classdata->nodes] = kept;
+
+  free(ids);
+  free(routes);
+  return 0;
+
+ error:
+  free(ids);
+  free(routes);
+  return -1;
+}
+
+/* Use the routes of a mapped binary file in place, once checked: 
+ * the offsets must slice the routes without going past them 
+ */
+int attach_routes(struct classdata *classdata, char *data, long size) {
+  struct binary_header *header = (struct binary_header *) data;
+  int64_t *offsets = (int64_t *) (data + sizeof(struct binary_header));
+  long offsets_size;
+  int id;
+
+  if (memcmp(header->magic, BINARY_MAGIC, 8)) {
+    fprintf(stderr, "filestatic: unsupported binary file version\n");
+    return -1;
+  }
+  if (header->byte_order != BINARY_BYTE_ORDER) {
+    fprintf(stderr, "filestatic: binary file compiled with another byte order\n");
+    return -1;
+  }
+  if (header->nodes < 0 || header->nb_routes < 0 || header->route_size != sizeof(struct route)) {
+    return -1;
+  }
+  offsets_size = (header->nodes + 1) * sizeof(int64_t);
+  if (size != (long) (sizeof(struct binary_header) + offsets_size + header->nb_routes * sizeof(struct route))) {
+    return -1;
+  }
+  if (offsets[0] != 0 || offsets[header->nodes] != header->nb_routes) {
+    return -1;
+  }
+  for (id = 0; id < header->nodes; id++) {
+    if (offsets[id + 1] < offsets[id]) {
+      return -1;
+    }
+  }
+
+  classdata->nodes = header->nodes;
+  classdata->offsets = offsets;
+  classdata->routes = (struct route *) (data + sizeof(struct binary_header) + offsets_size);
+  classdata->map = data;
+  classdata->map_size = size;
+  return 0;
+}
+
+/* Load the routes of all the nodes from a text or binary file */
+int load_routes(struct classdata *classdata, char *filepath) {
+  struct stat file_stat;
+  char *data = NULL;
+  int fd = -1;
+
+  classdata->map = NULL;
+  classdata->routes = NULL;
+  classdata->offsets = NULL;
+
+  /* map file */
+  if ((fd = open(filepath, O_RDONLY)) == -1 || fstat(fd, &file_stat) == -1) {
+    fprintf(stderr, "filestatic: can not open file %s\n", filepath);
+    goto error;
+  }
+  if (file_stat.st_size > 0 && (data = mmap(NULL, file_stat.st_size, PROT_READ, MAP_SHARED, fd, 0)) == MAP_FAILED) {
+    data = NULL;
+    fprintf(stderr, "filestatic: can not map file %s\n", filepath);
+    goto error;
+  }
+  close(fd);
+  fd = -1;
+
+  /* binary file (any version): keep it mapped, the pages are shared between processes */
+  if (file_stat.st_size >= (long) sizeof(struct binary_header) && !memcmp(data, BINARY_MAGIC, 7)) {
+    if (attach_routes(classdata, data, file_stat.st_size)) {
+      fprintf(stderr, "filestatic: corrupted binary file %s\n", filepath);
+      goto error;
+    }
+    return 0;
+  }
+
+  /* text file: extract the routing tables of all the nodes */
+  if (parse_routes(classdata, data, (data != NULL) ? file_stat.st_size : 0)) {
+    goto error;
+  }
+  if (data != NULL) {
+    munmap(data, file_stat.st_size);
+  }
+  return 0;
+
+ error:
+  if (data != NULL) {
+    munmap(data, file_stat.st_size);
+  }
+  if (fd != -1) {
+    close(fd);
+  }
+  return -1;
+}
+
+/* Free the routes of all the nodes */
+void unload_routes(struct classdata *classdata) {
+  if (classdata->map != NULL) {
+    munmap(classdata->map, classdata->map_size);
+  } else {
+    free(classdata->routes);
+    free(classdata->offsets);
+  }
+}
+
+/* Slot of a destination in a route map */
+unsigned long route_slot_hash(nodeid_t dst, unsigned long mask) {
+  return ((uint32_t) dst * 2654435761u) & mask;
+}
+
+/* Index the routes of a node: directly if the destinations are 
+ * contiguous, otherwise in an open-addressing map at most half full 
+ */
+void index_routes(struct nodedata *nodedata) {
+  long i;
+
+  nodedata->dense = 1;
+  nodedata->slots = NULL;
+  nodedata->mask = 0;
+  for (i = 1; i < nodedata->nb_routes; i++) {
+    if ((long) nodedata->routes[i].dst != (long) nodedata->routes[0].dst + i) {
+      nodedata->dense = 0;
+      break;
+    }
+  }
+  if (nodedata->dense) {
+    return;
+  }
+
+  nodedata->mask = 1;
+  while (nodedata->mask < 2 * (unsigned long) nodedata->nb_routes) {
+    nodedata->mask <<= 1;
+  }
+  nodedata->slots = malloc(nodedata->mask * sizeof(struct route_slot));
+  nodedata->mask--;
+  for (i = 0; i <= (long) nodedata->mask; i++) {
+    nodedata->slots[i].index = -1;
+  }
+
+  for (i = 0; i < nodedata->nb_routes; i++) {
+    unsigned long slot = route_slot_hash(nodedata->routes[i].dst, nodedata->mask);
+    while (nodedata->slots[slot].index != -1 && nodedata->slots[slot].dst != nodedata->routes[i].dst) {
+      slot = (slot + 1) & nodedata->mask;
+    }
+    /* keep the first route of a duplicated destination */
+    if (nodedata->slots[slot].index == -1) {
+      nodedata->slots[slot].dst = nodedata->routes[i].dst;
+      nodedata->slots[slot].index = i;
+    }
+  }
+}
+
+/* Get the route of a node towards a destination */
+struct route *route_lookup(struct nodedata *nodedata, nodeid_t dst) {
+  unsigned long slot;
+
+  if (nodedata->nb_routes == 0) {
+    return NULL;
+  }
+
+  if (nodedata->dense) {
+    long i = (long) dst - (long) nodedata->routes[0].dst;
+    return (i >= 0 && i < nodedata->nb_routes) ? &(nodedata->routes[i]) : NULL;
+  }
+
+  slot = route_slot_hash(dst, nodedata->mask);
+  while (nodedata->slots[slot].index != -1) {
+    if (nodedata->slots[slot].dst == dst) {
+      return &(nodedata->routes[nodedata->slots[slot].index]);
+    }
+    slot = (slot + 1) & nodedata->mask;
+  }
+  return NULL;
+}
+
+
+/* ************************************************** */
+/* ************************************************** */
+#ifdef FILESTATIC_COMPILER
+/* ************************************************** */
+/* ************************************************** */
+/* Offline compiler: text route file to binary route file */
+int main(int argc, char *argv[]) {
+  struct classdata classdata;
+  struct binary_header header;
+  FILE *file;
+
+  if (argc != 3) {
+    fprintf(stderr, "usage: %s <text route file> <binary route file>\n", argv[0]);
+    return 1;
+  }
+  if (load_routes(&classdata, argv[1])) {
+    return 1;
+  }
+
+  memset(&header, 0, sizeof(struct binary_header));
+  memcpy(header.magic, BINARY_MAGIC, 8);
+  header.byte_order = BINARY_BYTE_ORDER;
+  header.nodes = classdata.nodes;
+  header.route_size = sizeof(struct route);
+  header.nb_routes = classdata.offsets[classdata.nodes];
+
+  if ((file = fopen(argv[2], "wb")) == NULL
+      || fwrite(&header, sizeof(struct binary_header), 1, file) != 1
+      || fwrite(classdata.offsets, sizeof(int64_t), classdata.nodes + 1, file) != (size_t) (classdata.nodes + 1)
+      || fwrite(classdata.routes, sizeof(struct route), header.nb_routes, file) != (size_t) header.nb_routes
+      || fclose(file) != 0) {
+    fprintf(stderr, "filestatic: can not write file %s\n", argv[2]);
+    return 1;
+  }
+
+  unload_routes(&classdata);
+  return 0;
+}
+
+#else
 /* ************************************************** */
 /* ************************************************** */
 int init(call_t *to, void *params) {
@@ -77,12 +472,12 @@ int init(call_t *to, void *params) {
     }
   }
   
-  /* open file */
-  if ((classdata->file = fopen(filepath, "r")) == NULL) {
-    fprintf(stderr, "filestatic: can not open file %s in init()\n", filepath);
+  /* extract the routing tables of all the nodes */
+  if (load_routes(classdata, filepath)) {
+    fprintf(stderr, "filestatic: can not load routes in init()\n");
     goto error;
   }
-    
+
   set_class_private_data(to, classdata);
   return 0;
 
@@ -94,10 +489,7 @@ int init(call_t *to, void *params) {
 int destroy(call_t *to) {
   struct classdata *classdata = get_class_private_data(to);
 
-  if (classdata->file != NULL) {
-    fclose(classdata->file);
-  }
-
+  unload_routes(classdata);
   free(classdata);
   return 0;
 }
@@ -108,47 +500,25 @@ int destroy(call_t *to) {
 int bind(call_t *to, void *params) {
   struct classdata *classdata = get_class_private_data(to);
   struct nodedata *nodedata = malloc(sizeof(struct nodedata));
-  char str[128];
-  int id, dst, n_hop;
-    
-  /* extract routing table from file */
-  nodedata->routes = hashtable_create(route_hash, route_equal, NULL, NULL);
     
-  /* extract routing table from file */
-  fseek(classdata->file, 0L, SEEK_SET);
-  while (fgets(str, 128, classdata->file) != NULL) {
-    if (sscanf(str, "%d %d %d\n",  &id, &dst, &n_hop) != 3) {
-      fprintf(stderr, "filestatic: unable to read route in bind()\n");
-      goto error;
-    }
-        
-    if (id == to->object) {
-      struct route *route = (struct route *) malloc(sizeof(struct route));
-      route->dst = dst;
-      route->n_hop = n_hop;
-      hashtable_insert(nodedata->routes, (void *) ((unsigned long) (route->dst)), (void *) route);
-    }
+  /* attach the routing table of the node, extracted in init() */
+  if (to->object < classdata->nodes) {
+    nodedata->routes = classdata->routes + classdata->offsets[to->object];
+    nodedata->nb_routes = classdata->offsets[to->object + 1] - classdata->offsets[to->object];
+  } else {
+    nodedata->routes = NULL;
+    nodedata->nb_routes = 0;
   }
+  index_routes(nodedata);
     
   nodedata->overhead = -1;
   set_node_private_data(to, nodedata);
   return 0;
-
- error:
-  free(classdata);
-  return -1;
 }
 
 int unbind(call_t *to) {
   struct nodedata *nodedata = get_node_private_data(to);
-  struct route *route;
-  int i = get_node_count();
-  while (i--) {
-    if ((route = (struct route *) hashtable_retrieve(nodedata->routes, (void *) ((unsigned long) i))) != NULL) {
-      free(route);
-    }
-  } 
-  hashtable_destroy(nodedata->routes); 
+  free(nodedata->slots);
   free(nodedata);
   return 0;
 }
@@ -175,7 +545,7 @@ int ioctl(call_t *to, int option, void *in, void **out) {
 /* ************************************************** */
 int set_header(call_t *to, call_t *from, packet_t *packet, destination_t *dst) {
   struct nodedata *nodedata = get_node_private_data(to);
-  struct route *route = hashtable_retrieve(nodedata->routes, (void *) ((unsigned long) (dst->id)));
+  struct route *route = route_lookup(nodedata, dst->id);
   call_t to0 = {get_class_bindings_down(to)->elts[0], to->object};
   destination_t n_hop;
 
@@ -244,7 +614,7 @@ void forward(call_t *to, call_t *from, packet_t *packet) {
   call_t to0 = {get_class_bindings_down(to)->elts[0], to->object};
   nodeid_t UNUSED *header_dst = (nodeid_t *) packet_retrieve_field_value_ptr(packet, "routing_header_dst");
   nodeid_t UNUSED *header_src = (nodeid_t *) packet_retrieve_field_value_ptr(packet, "routing_header_src");
-  struct route *route = hashtable_retrieve(nodedata->routes, (void *) ((unsigned long) (*header_dst)));
+  struct route *route = route_lookup(nodedata, *header_dst);
   destination_t destination;
 
   if (route == NULL) {
@@ -293,3 +663,4 @@ routing_methods_t methods = {rx,
                              set_header, 
                              get_header_size,
                              get_header_real_size};
+#endif
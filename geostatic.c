@@ -25,6 +25,27 @@ struct neighbor {
   uint64_t time;
 };
 
+/* Uniform grid over the node positions, shared by all the nodes */
+struct classdata {
+  double cell_size;     /* 0 means the range of the first node */
+  double min_x;
+  double min_y;
+  int cells_x;
+  int cells_y;
+  int *cell_start;      /* nodes of cell c are cell_nodes[cell_start[c]..cell_start[c+1]-1] */
+  nodeid_t *cell_nodes;
+};
+
+/* Neighbors closer to a destination than the node, sorted by 
+ * increasing distance to the destination (positions are static) 
+ */
+struct nexthop_cache {
+  nodeid_t dst;
+  int nb_candidates;
+  struct neighbor **candidates;
+  struct neighbor *dst_neighbor;   /* the destination itself, if neighbor */
+};
+
 struct nodedata {
   int overhead;
   int hop;       
@@ -35,6 +56,16 @@ struct nodedata {
   list_t *neighbors;
   nodeid_t curr_dst;
   struct neighbor* curr_nexthop;
+
+  void *nexthop_table;             /* nexthop caches, per destination */
+  list_t *nexthop_caches;
+  struct neighbor **random_candidates;
+};
+
+struct candidate {
+  struct neighbor *neighbor;
+  double dist;
+  int rank;
 };
 
 
@@ -48,33 +79,166 @@ int routing_header_size = sizeof(nodeid_t) + sizeof(nodeid_t) + sizeof(int);
 /* ************************************************** */
 
 int init(call_t *to, void *params) {
+  struct classdata *classdata = malloc(sizeof(struct classdata));
+  param_t *param;
+
+  /* default values */
+  classdata->cell_size = 0;
+  classdata->cell_start = NULL;
+  classdata->cell_nodes = NULL;
+
+  /* get parameters */
+  list_init_traverse(params);
+  while ((param = (param_t *) list_traverse(params)) != NULL) {
+    if (!strcmp(param->key, "cell_size")) {
+      if (get_param_double(param->value, &(classdata->cell_size))) {
+	goto error;
+      }
+    }
+  }
+
+  /* The grid itself is built at the first bootstrap, once 
+   * all the nodes have been created and positioned 
+   */
+  set_class_private_data(to, classdata);
   return 0;
+
+ error:
+  free(classdata);
+  return -1;
 }
 
 int destroy(call_t *to) {
+  struct classdata *classdata = get_class_private_data(to);
+
+  free(classdata->cell_start);
+  free(classdata->cell_nodes);
+  free(classdata);
   return 0;
 }
 
+/* ************************************************** */
+/* ************************************************** */
+/* Grid cell of a position */
+int get_cell(struct classdata *classdata, position_t *position) {
+  int cx = (int) ((position->x - classdata->min_x) / classdata->cell_size);
+  int cy = (int) ((position->y - classdata->min_y) / classdata->cell_size);
+
+  cx = (cx < 0) ? 0 : (cx >= classdata->cells_x) ? classdata->cells_x - 1 : cx;
+  cy = (cy < 0) ? 0 : (cy >= classdata->cells_y) ? classdata->cells_y - 1 : cy;
+  return cy * classdata->cells_x + cx;
+}
+
+/* Build the uniform grid index over all the node positions */
+void build_grid(call_t *to, double range) {
+  struct classdata *classdata = get_class_private_data(to);
+  int nodes = get_node_count();
+  double max_x, max_y;
+  int *cell_count;
+  nodeid_t i;
+  int c;
+
+  if (classdata->cell_size <= 0) {
+    classdata->cell_size = (range > 0) ? range : 1;
+  }
+
+  /* Bounding box of the nodes */
+  classdata->min_x = max_x = get_node_position(0)->x;
+  classdata->min_y = max_y = get_node_position(0)->y;
+  for (i = 1; i < nodes; i++) {
+    position_t *position = get_node_position(i);
+    if (position->x < classdata->min_x) classdata->min_x = position->x;
+    if (position->x > max_x) max_x = position->x;
+    if (position->y < classdata->min_y) classdata->min_y = position->y;
+    if (position->y > max_y) max_y = position->y;
+  }
+
+  /* Keep the number of cells in O(nodes) for sparse deployments */
+  while (((max_x - classdata->min_x) / classdata->cell_size + 1) 
+	 * ((max_y - classdata->min_y) / classdata->cell_size + 1) > 4.0 * nodes) {
+    classdata->cell_size *= 2;
+  }
+  classdata->cells_x = (int) ((max_x - classdata->min_x) / classdata->cell_size) + 1;
+  classdata->cells_y = (int) ((max_y - classdata->min_y) / classdata->cell_size) + 1;
+
+  /* Counting sort of the nodes by cell: nodes stay sorted by ID in each cell */
+  cell_count = calloc(classdata->cells_x * classdata->cells_y, sizeof(int));
+  classdata->cell_start = malloc((classdata->cells_x * classdata->cells_y + 1) * sizeof(int));
+  classdata->cell_nodes = malloc(nodes * sizeof(nodeid_t));
+  for (i = 0; i < nodes; i++) {
+    cell_count[get_cell(classdata, get_node_position(i))]++;
+  }
+  classdata->cell_start[0] = 0;
+  for (c = 0; c < classdata->cells_x * classdata->cells_y; c++) {
+    classdata->cell_start[c + 1] = classdata->cell_start[c] + cell_count[c];
+    cell_count[c] = classdata->cell_start[c];
+  }
+  for (i = 0; i < nodes; i++) {
+    classdata->cell_nodes[cell_count[get_cell(classdata, get_node_position(i))]++] = i;
+  }
+  free(cell_count);
+}
+
+int nodeid_compare(const void *id0, const void *id1) {
+  return *((const nodeid_t *) id0) - *((const nodeid_t *) id1);
+}
+
 /* ************************************************** */
 /* ************************************************** */
 /* Find all the neighbors (i.e. nodes in range) of the current node */
 int find_neighbors(call_t *to) {
   struct nodedata *nodedata = get_node_private_data(to);
+  struct classdata *classdata = get_class_private_data(to);
   struct neighbor *neighbor = NULL;    
+  position_t *position = get_node_position(to->object);
+  position_t corner;
+  nodeid_t *candidates;
   nodeid_t i;
   double dist = 0;
   int nb_neigh = 0;
+  int nb_candidates = 0;
+  int c0, c1, cx, cy, k;
+
+  if (classdata->cell_start == NULL) {
+    build_grid(to, nodedata->range);
+  }
 
-  /* Parse all the nodes in the simulation: and find the ones 
-   * that are in range of that node
+  /* Parse the nodes of the grid cells covering the range 
+   * of that node, and find the ones that are in range
    */
-  for(i = 0; i < get_node_count(); i++) {
+  corner.x = position->x - nodedata->range;
+  corner.y = position->y - nodedata->range;
+  c0 = get_cell(classdata, &corner);
+  corner.x = position->x + nodedata->range;
+  corner.y = position->y + nodedata->range;
+  c1 = get_cell(classdata, &corner);
+  for (cy = c0 / classdata->cells_x; cy <= c1 / classdata->cells_x; cy++) {
+    nb_candidates += classdata->cell_start[cy * classdata->cells_x + c1 % classdata->cells_x + 1] 
+      - classdata->cell_start[cy * classdata->cells_x + c0 % classdata->cells_x];
+  }
+  candidates = malloc((nb_candidates + 1) * sizeof(nodeid_t));
+  nb_candidates = 0;
+  for (cy = c0 / classdata->cells_x; cy <= c1 / classdata->cells_x; cy++) {
+    for (cx = c0 % classdata->cells_x; cx <= c1 % classdata->cells_x; cx++) {
+      int c = cy * classdata->cells_x + cx;
+      for (k = classdata->cell_start[c]; k < classdata->cell_start[c + 1]; k++) {
+	candidates[nb_candidates++] = classdata->cell_nodes[k];
+      }
+    }
+  }
+
+  /* Keep the neighbor list ordered by ID, as with a full scan */
+  qsort(candidates, nb_candidates, sizeof(nodeid_t), nodeid_compare);
+
+  for (k = 0; k < nb_candidates; k++) {
+    i = candidates[k];
+
     /* Do not include myself */
     if (i == to->object) {
       continue;
     }
 
-    dist = distance(get_node_position(to->object), get_node_position(i));
+    dist = distance(position, get_node_position(i));
     if (dist <= nodedata->range) {
       /* Add the node in the list of neighbors */
       neighbor = (struct neighbor *) malloc(sizeof(struct neighbor));
@@ -90,15 +254,85 @@ int find_neighbors(call_t *to) {
     }
   }
 
+  free(candidates);
   return nb_neigh;
 }
 
+unsigned long nexthop_hash(void *key) { 
+  return (unsigned long) key;
+}
+
+int nexthop_equal(void *key0, void *key1) { 
+  return (int) (key0 == key1);
+}
+
+/* Sort by distance to the destination, then by neighbor list order */
+int candidate_compare(const void *c0, const void *c1) {
+  const struct candidate *candidate0 = (const struct candidate *) c0;
+  const struct candidate *candidate1 = (const struct candidate *) c1;
+
+  if (candidate0->dist != candidate1->dist) {
+    return (candidate0->dist < candidate1->dist) ? -1 : 1;
+  }
+  return candidate0->rank - candidate1->rank;
+}
+
+/* Get (and build on first use) the next hop candidates towards a destination */
+struct nexthop_cache* get_nexthop_cache(call_t *to, nodeid_t dst) {
+  struct nodedata *nodedata = get_node_private_data(to);
+  struct nexthop_cache *cache = hashtable_retrieve(nodedata->nexthop_table, (void *) ((unsigned long) dst));
+  struct neighbor *neighbor = NULL;
+  struct candidate *candidates;
+  double dist;
+  int i = 0;
+
+  if (cache != NULL) {
+    return cache;
+  }
+
+  dist = distance(get_node_position(to->object), get_node_position(dst));
+  cache = (struct nexthop_cache *) malloc(sizeof(struct nexthop_cache));
+  cache->dst = dst;
+  cache->nb_candidates = 0;
+  cache->dst_neighbor = NULL;
+  candidates = malloc((list_getsize(nodedata->neighbors) + 1) * sizeof(struct candidate));
+
+  /* Keep the neighbors that are nearer from the destination 
+   * than the current node, whether they are alive or not */
+  list_init_traverse(nodedata->neighbors);    
+  while ((neighbor = (struct neighbor *) 
+	  list_traverse(nodedata->neighbors)) != NULL) {        
+    double d = distance(&(neighbor->position), get_node_position(dst));
+    if (neighbor->id == dst) {
+      cache->dst_neighbor = neighbor;
+    }
+    if (d < dist) {
+      candidates[cache->nb_candidates].neighbor = neighbor;
+      candidates[cache->nb_candidates].dist = d;
+      candidates[cache->nb_candidates].rank = i;
+      cache->nb_candidates++;
+    }
+    i++;
+  }
+  qsort(candidates, cache->nb_candidates, sizeof(struct candidate), candidate_compare);
+
+  cache->candidates = malloc((cache->nb_candidates + 1) * sizeof(struct neighbor *));
+  for (i = 0; i < cache->nb_candidates; i++) {
+    cache->candidates[i] = candidates[i].neighbor;
+  }
+  free(candidates);
+
+  hashtable_insert(nodedata->nexthop_table, (void *) ((unsigned long) dst), (void *) cache);
+  list_insert(nodedata->nexthop_caches, (void *) cache);
+  return cache;
+}
+
 /* Get the best next hop for a specific destination */
 struct neighbor* get_nexthop(call_t *to, nodeid_t dst) {
   struct nodedata *nodedata = get_node_private_data(to);
-  struct neighbor *neighbor = NULL, *n_hop = NULL;
-  double dist = distance(get_node_position(to->object), get_node_position(dst));
-  double d = dist;
+  struct neighbor *n_hop = NULL;
+  struct nexthop_cache *cache = NULL;
+  int i = 0;
 
   if (nodedata->curr_dst != dst 
       || nodedata->curr_nexthop == NULL || (!is_node_alive(nodedata->curr_nexthop->id))) {
@@ -121,54 +355,42 @@ struct neighbor* get_nexthop(call_t *to, nodeid_t dst) {
       return nodedata->curr_nexthop;
     }
         
-    /* Parse neighbors */
-    list_init_traverse(nodedata->neighbors);    
-    while ((neighbor = (struct neighbor *) 
-	    list_traverse(nodedata->neighbors)) != NULL) {        
-      /* Choose next hop (the one the nearest from the final dst) 
-       * and verify if it is still alive */
-      if ((d = distance(&(neighbor->position), get_node_position(dst))) < dist
-	  && is_node_alive(neighbor->id)) {
-	dist = d;
-	n_hop = neighbor;
+    /* Choose next hop (the one the nearest from the final dst) 
+     * and verify if it is still alive: the candidates are sorted, 
+     * so only the dead ones are skipped */
+    cache = get_nexthop_cache(to, dst);
+    for (i = 0; i < cache->nb_candidates; i++) {
+      if (is_node_alive(cache->candidates[i]->id)) {
+	n_hop = cache->candidates[i];
+	break;
       }
     }
   } else if (nodedata->random_counter == nodedata->random_nexthop) {
-    list_t *next_hops = list_create();
     int nh = 0;
-    double nexthop_dst = 0;
 
     /* Random geographic routing : we choose randomly among 
      * the neighbors that are nearer from the destination 
      * than the current node.
      */
-    list_init_traverse(nodedata->neighbors);    
-    while ((neighbor = (struct neighbor *) 
-	    list_traverse(nodedata->neighbors)) != NULL) {        
-      /* If the neighbor happens to be the final destination, 
-       * then we just choose it as the next hop */
-      if (neighbor->id == dst) {
-	n_hop = neighbor;
-	goto out;
-      }
+    cache = get_nexthop_cache(to, dst);
 
-      /* Store the neighbors that are nearer from the destination 
-       * and that are still alive */
-      nexthop_dst = distance(&(neighbor->position), get_node_position(dst));
-      if (nexthop_dst < dist && is_node_alive(neighbor->id)) {
-	list_insert(next_hops, (void *) neighbor);
+    /* If the neighbor happens to be the final destination, 
+     * then we just choose it as the next hop */
+    if (cache->dst_neighbor != NULL) {
+      n_hop = cache->dst_neighbor;
+      goto out;
+    }
+
+    /* Store the candidates that are still alive */
+    for (i = 0; i < cache->nb_candidates; i++) {
+      if (is_node_alive(cache->candidates[i]->id)) {
+	nodedata->random_candidates[nh++] = cache->candidates[i];
       }
     }
-    /* Choose next hop randomly among the list */
-    nh = list_getsize(next_hops);
+    /* Choose next hop randomly among them */
     if (nh > 0) {
-      int rnd = get_random_integer_range(1, nh);
-      while (rnd--) {
-	neighbor = (struct neighbor *)list_pop(next_hops);
-      }
-      n_hop = neighbor;
+      n_hop = nodedata->random_candidates[get_random_integer_range(1, nh) - 1];
     }
-    list_destroy(next_hops);
   } else /* nodedata->random_counter != nodedata->random_nexthop */ {
     /* Keep the current next hop */
     n_hop = nodedata->curr_nexthop;
@@ -196,6 +418,9 @@ int bind(call_t *to, void *params) {
   nodedata->neighbors = list_create();    
   nodedata->curr_dst = -1;
   nodedata->curr_nexthop = NULL;
+  nodedata->nexthop_table = hashtable_create(nexthop_hash, nexthop_equal, NULL, NULL);
+  nodedata->nexthop_caches = list_create();
+  nodedata->random_candidates = NULL;
 
   /* default values */
   nodedata->overhead = -1;
@@ -234,6 +459,9 @@ int bind(call_t *to, void *params) {
   return 0;
     
  error:
+  hashtable_destroy(nodedata->nexthop_table);
+  list_destroy(nodedata->nexthop_caches);
+  list_destroy(nodedata->neighbors);
   free(nodedata);
   return -1;
 }
@@ -241,6 +469,15 @@ int bind(call_t *to, void *params) {
 int unbind(call_t *to) {
   struct nodedata *nodedata = get_node_private_data(to);
   struct neighbor *neighbor;
+  struct nexthop_cache *cache;
+
+  while ((cache = (struct nexthop_cache *) list_pop(nodedata->nexthop_caches)) != NULL) {
+    free(cache->candidates);
+    free(cache);
+  }
+  list_destroy(nodedata->nexthop_caches);
+  hashtable_destroy(nodedata->nexthop_table);
+  free(nodedata->random_candidates);
 
   while ((neighbor = (struct neighbor *) list_pop(nodedata->neighbors)) != NULL) {
     free(neighbor);
@@ -263,6 +500,7 @@ int bootstrap(call_t *to) {
 
   /* Find all the node's neighbors (i.e. the one in range) */
   nb_neigh = find_neighbors(to);
+  nodedata->random_candidates = malloc((nb_neigh + 1) * sizeof(struct neighbor *));
   PRINT_ROUTING("Node %d has %d neighbors\n", to->object, nb_neigh);
         
   return 0;
@@ -5,6 +5,7 @@
  *  \date   2007
  **/
 #include <stdio.h>
+#include <math.h>
 #include <kernel/modelutils.h>
 
 
@@ -23,6 +24,18 @@ model_t model =  {
 #define HELLO_PACKET 0
 #define DATA_PACKET  1
 
+/* forwarding modes of a data packet */
+#define GREEDY_MODE    0
+#define PERIMETER_MODE 1
+
+/* planarization of the neighbor graph used in perimeter mode */
+#define PLANAR_NONE 0
+#define PLANAR_GG   1
+#define PLANAR_RNG  2
+
+/* uniform grid of the neighbor positions, its cells being hashed in buckets */
+#define GRID_BUCKETS 128
+
 
 /* ************************************************** */
 /* ************************************************** */
@@ -32,18 +45,61 @@ int routing_header_size =
   sizeof(nodeid_t)   +
   3 * sizeof(double) +
   sizeof(int)        +
-  sizeof(int);
-/* header dst, header dst_pos, header src, header src_pos, header hop, header type */
+  sizeof(int)        +
+  sizeof(int)        +
+  3 * sizeof(double) +
+  3 * sizeof(double) +
+  sizeof(nodeid_t)   +
+  sizeof(nodeid_t)   +
+  sizeof(nodeid_t)   +
+  sizeof(uint64_t);
+/* header dst, header dst_pos, header src, header src_pos, header hop, header type,
+ * header mode, header lp, header lf, header e0 (from, to), header prev, header interval */
+
+/* all the routing header travels in a single packet field */
+struct greedy_header {
+  nodeid_t dst;
+  position_t dst_pos;
+  nodeid_t src;
+  position_t src_pos;
+  int type;
+  int hop;
+  /* perimeter mode */
+  int mode;
+  position_t lp;     /* position where the packet entered perimeter mode */
+  position_t lf;     /* point where the packet entered the current face */
+  nodeid_t e0_from;  /* first edge traversed on the current face */
+  nodeid_t e0_to;
+  nodeid_t prev;     /* previous hop */
+  /* hello */
+  uint64_t interval; /* hello interval of the sender, 0 if it does not send hellos */
+};
 
 
 struct neighbor {
   int id;
   position_t position;
   uint64_t time;
+  uint64_t interval;       /* hello interval advertised by the neighbor */
+  int cell_x;              /* grid cell of the neighbor position */
+  int cell_y;
+  int planar_edge;         /* set when the edge to the neighbor belongs to the planar graph */
+  struct neighbor *next;   /* next neighbor of the same bucket */
 };
 
 struct nodedata {
-  list_t *neighbors;
+  /* neighbors, by id and by grid cell of their position */
+  void *neighbor_table;
+  struct neighbor *buckets[GRID_BUCKETS];
+  int nb_neighbors;
+  double cell_size;          /* side of the grid cells, a fraction of the radio range */
+  int min_x;                 /* cells holding neighbors, valid unless grid_bounds_dirty */
+  int max_x;
+  int min_y;
+  int max_y;
+  int grid_bounds_dirty;     /* set when a neighbor left the border of the cells */
+  int planarization;         /* PLANAR_GG, PLANAR_RNG or PLANAR_NONE (no perimeter mode) */
+  int planar_graph_dirty;    /* set when the neighborhood changed since the last planarization */
   int overhead;
 
   uint64_t start;
@@ -51,6 +107,15 @@ struct nodedata {
   uint64_t timeout;
   int hop;     
 
+  /* Trickle timer of the hellos, enabled when imax > 0 (Imin is the period) */
+  int imax;                  /* maximal number of doublings of the period */
+  int k;                     /* redundancy constant, 0 for no suppression */
+  uint64_t interval;
+  uint64_t interval_start;
+  int counter;               /* hellos from known neighbors heard in the interval */
+  int suppressed;            /* set when the hello of the previous interval was suppressed */
+  long epoch;                /* identifies the pending hello callback */
+
   int hello_packet_real_size;  
 
   /* stats */
@@ -60,13 +125,19 @@ struct nodedata {
   int data_rx;
   int data_noroute;
   int data_hop;
+  int data_perimeter;
 };
 
 
 /* ************************************************** */
 /* ************************************************** */
 int advert_callback(call_t *to, call_t *from, void *args);
+void hello_reset(call_t *to);
 void display_neighbors(call_t *to);
+unsigned long neighbor_hash(void *key);
+int neighbor_equal(void *key0, void *key1);
+struct greedy_header *add_greedy_header(packet_t *packet);
+struct greedy_header *get_greedy_header(packet_t *packet);
 
 
 /* ************************************************** */
@@ -85,9 +156,18 @@ int destroy(call_t *to) {
 int bind(call_t *to, void *params) {
   struct nodedata *nodedata = malloc(sizeof(struct nodedata));
   param_t *param;
+  int i;
 
   /* default values */
-  nodedata->neighbors = list_create();
+  nodedata->neighbor_table = hashtable_create(neighbor_hash, neighbor_equal, NULL, NULL);
+  for (i = 0; i < GRID_BUCKETS; i++) {
+    nodedata->buckets[i] = NULL;
+  }
+  nodedata->nb_neighbors = 0;
+  nodedata->cell_size = 25;  // a quarter of a 100m radio range
+  nodedata->grid_bounds_dirty = 1;
+  nodedata->planarization = PLANAR_GG;
+  nodedata->planar_graph_dirty = 1;
   nodedata->overhead = -1;
   nodedata->hello_tx = 0;
   nodedata->hello_rx = 0;
@@ -95,10 +175,18 @@ int bind(call_t *to, void *params) {
   nodedata->data_rx = 0;
   nodedata->data_noroute = 0;
   nodedata->data_hop = 0;
+  nodedata->data_perimeter = 0;
   nodedata->start = 0;
   nodedata->hop = 32;
   nodedata->period = 1000000000;
   nodedata->timeout = 2500000000ull;
+  nodedata->imax = 0;
+  nodedata->k = 0;
+  nodedata->interval = 0;
+  nodedata->interval_start = 0;
+  nodedata->counter = 0;
+  nodedata->suppressed = 0;
+  nodedata->epoch = 0;
   nodedata->hello_packet_real_size = 16;  // as in OLSR v2 RFC3626
  
   /* get params */
@@ -124,12 +212,43 @@ int bind(call_t *to, void *params) {
 	goto error;
       }
     }
+    if (!strcmp(param->key, "imax")) {
+      if (get_param_integer_range(param->value, &(nodedata->imax), 0, 16)) {
+	goto error;
+      }
+    }
+    if (!strcmp(param->key, "k")) {
+      if (get_param_integer(param->value, &(nodedata->k))) {
+	goto error;
+      }
+    }
+    if (!strcmp(param->key, "cell_size")) {
+      if (get_param_double(param->value, &(nodedata->cell_size))) {
+	goto error;
+      }
+    }
+    if (!strcmp(param->key, "planarization")) {
+      if (!strcmp(param->value, "gg")) {
+	nodedata->planarization = PLANAR_GG;
+      } else if (!strcmp(param->value, "rng")) {
+	nodedata->planarization = PLANAR_RNG;
+      } else if (!strcmp(param->value, "none")) {
+	nodedata->planarization = PLANAR_NONE;
+      } else {
+	goto error;
+      }
+    }
+  }
+
+  if (nodedata->cell_size <= 0) {
+    goto error;
   }
     
   set_node_private_data(to, nodedata);
   return 0;
     
  error:
+  hashtable_destroy(nodedata->neighbor_table);
   free(nodedata);
   return -1;
 }
@@ -137,10 +256,15 @@ int bind(call_t *to, void *params) {
 int unbind(call_t *to) {
   struct nodedata *nodedata = get_node_private_data(to);
   struct neighbor *neighbor;
-  while ((neighbor = (struct neighbor *) list_pop(nodedata->neighbors)) != NULL) {
-    free(neighbor);
+  int i;
+
+  for (i = 0; i < GRID_BUCKETS; i++) {
+    while ((neighbor = nodedata->buckets[i]) != NULL) {
+      nodedata->buckets[i] = neighbor->next;
+      free(neighbor);
+    }
   }
-  list_destroy(nodedata->neighbors);    
+  hashtable_destroy(nodedata->neighbor_table);
   free(nodedata);
   return 0;
 }
@@ -159,7 +283,12 @@ int bootstrap(call_t *to) {
   if (nodedata->period > 0) {
     call_t from = {-1, -1};
     uint64_t start = get_time() + nodedata->start + get_random_double() * nodedata->period;
-    scheduler_add_callback(start, to, &from, advert_callback, NULL);
+    if (nodedata->imax > 0) {
+      nodedata->interval = nodedata->period;
+      nodedata->interval_start = get_time() + nodedata->start;
+      start = nodedata->interval_start + (nodedata->interval + get_random_double() * nodedata->interval) / 2;
+    }
+    scheduler_add_callback(start, to, &from, advert_callback, (void *) nodedata->epoch);
   }
 
   return 0;
@@ -171,33 +300,396 @@ int ioctl(call_t *to, int option, void *in, void **out) {
 
 /* ************************************************** */
 /* ************************************************** */
-struct neighbor* get_nexthop(call_t *to, position_t *dst, int dst_id) {
+unsigned long neighbor_hash(void *key) { 
+  return (unsigned long) key;
+}
+
+int neighbor_equal(void *key0, void *key1) { 
+  return (int) (key0 == key1);
+}
+
+/* Hello interval advertised to the neighbors: the period, or the Trickle interval of the next hello */
+uint64_t hello_interval(call_t *to) {
   struct nodedata *nodedata = get_node_private_data(to);
-  struct neighbor *neighbor = NULL, *n_hop = NULL;
-  uint64_t clock = get_time();
-  double dist = distance(get_node_position(to->object), dst);
-  double d = dist;
-  
-  /* parse neighbors */
-  list_init_traverse(nodedata->neighbors);    
-  while ((neighbor = (struct neighbor *) list_traverse(nodedata->neighbors)) != NULL) {        
-    if ((nodedata->timeout > 0)
-	&& (clock - neighbor->time) >= nodedata->timeout ) {
+
+  if (nodedata->imax == 0) {
+    return nodedata->period;
+  }
+  return (nodedata->interval < (nodedata->period << nodedata->imax)) ? 2 * nodedata->interval : nodedata->interval;
+}
+
+int neighbor_timeout(call_t *to, struct neighbor *neighbor) {
+  struct nodedata *nodedata = get_node_private_data(to);
+  uint64_t timeout;
+
+  if (nodedata->timeout == 0) {
+    return 0;
+  }
+
+  /* the neighbor may miss as many of its advertised intervals as the timeout holds periods,
+   * and may be at the largest Trickle interval when its interval is unknown */
+  if (neighbor->interval > 0 && nodedata->period > 0) {
+    timeout = neighbor->interval * ((double) nodedata->timeout / nodedata->period);
+  } else {
+    timeout = nodedata->timeout << nodedata->imax;
+  }
+  return (get_time() - neighbor->time) >= timeout;
+}
+
+/* Grid cell of a coordinate: the grid does not depend on the node position */
+int get_cell(struct nodedata *nodedata, double coordinate) {
+  return (int) floor(coordinate / nodedata->cell_size);
+}
+
+int cell_bucket(int cell_x, int cell_y) {
+  return ((unsigned int) cell_x * 73856093u ^ (unsigned int) cell_y * 19349663u) % GRID_BUCKETS;
+}
+
+/* Extend the cells holding neighbors (none while min_x > max_x) with the cell of a neighbor */
+void grid_extend(struct nodedata *nodedata, struct neighbor *neighbor) {
+  if (nodedata->min_x > nodedata->max_x) {
+    nodedata->min_x = nodedata->max_x = neighbor->cell_x;
+    nodedata->min_y = nodedata->max_y = neighbor->cell_y;
+    return;
+  }
+  nodedata->min_x = (neighbor->cell_x < nodedata->min_x) ? neighbor->cell_x : nodedata->min_x;
+  nodedata->max_x = (neighbor->cell_x > nodedata->max_x) ? neighbor->cell_x : nodedata->max_x;
+  nodedata->min_y = (neighbor->cell_y < nodedata->min_y) ? neighbor->cell_y : nodedata->min_y;
+  nodedata->max_y = (neighbor->cell_y > nodedata->max_y) ? neighbor->cell_y : nodedata->max_y;
+}
+
+void grid_insert(struct nodedata *nodedata, struct neighbor *neighbor) {
+  int bucket;
+
+  neighbor->cell_x = get_cell(nodedata, neighbor->position.x);
+  neighbor->cell_y = get_cell(nodedata, neighbor->position.y);
+  bucket = cell_bucket(neighbor->cell_x, neighbor->cell_y);
+  neighbor->next = nodedata->buckets[bucket];
+  nodedata->buckets[bucket] = neighbor;
+  nodedata->planar_graph_dirty = 1;
+
+  if (!nodedata->grid_bounds_dirty) {
+    grid_extend(nodedata, neighbor);
+  }
+}
+
+void grid_remove(struct nodedata *nodedata, struct neighbor *neighbor) {
+  struct neighbor **prev = &(nodedata->buckets[cell_bucket(neighbor->cell_x, neighbor->cell_y)]);
+  while (*prev != neighbor) {
+    prev = &((*prev)->next);
+  }
+  *prev = neighbor->next;
+  nodedata->planar_graph_dirty = 1;
+
+  if (neighbor->cell_x == nodedata->min_x || neighbor->cell_x == nodedata->max_x 
+      || neighbor->cell_y == nodedata->min_y || neighbor->cell_y == nodedata->max_y) {
+    nodedata->grid_bounds_dirty = 1;
+  }
+}
+
+/* Recompute the cells holding neighbors once a neighbor left their border */
+void grid_bounds(struct nodedata *nodedata) {
+  struct neighbor *neighbor;
+  int i;
+
+  if (!nodedata->grid_bounds_dirty) {
+    return;
+  }
+  nodedata->min_x = nodedata->min_y = 1;
+  nodedata->max_x = nodedata->max_y = 0;
+  nodedata->grid_bounds_dirty = 0;
+  for (i = 0; i < GRID_BUCKETS; i++) {
+    for (neighbor = nodedata->buckets[i]; neighbor != NULL; neighbor = neighbor->next) {
+      grid_extend(nodedata, neighbor);
+    }
+  }
+}
+
+/* Whether a grid cell crosses the disc of a given radius around a position, in the plane */
+int cell_in_disc(struct nodedata *nodedata, int cell_x, int cell_y, position_t *center, double radius) {
+  double x = center->x, y = center->y;
+  double x0 = cell_x * nodedata->cell_size, y0 = cell_y * nodedata->cell_size;
+
+  /* closest point of the cell to the center */
+  x = (x < x0) ? x0 : (x > x0 + nodedata->cell_size) ? x0 + nodedata->cell_size : x;
+  y = (y < y0) ? y0 : (y > y0 + nodedata->cell_size) ? y0 + nodedata->cell_size : y;
+  return (x - center->x) * (x - center->x) + (y - center->y) * (y - center->y) <= radius * radius;
+}
+
+void delete_neighbor(call_t *to, struct neighbor *neighbor) {
+  struct nodedata *nodedata = get_node_private_data(to);
+  grid_remove(nodedata, neighbor);
+  hashtable_delete(nodedata->neighbor_table, (void *) ((unsigned long) neighbor->id));
+  nodedata->nb_neighbors--;
+  free(neighbor);
+  hello_reset(to);
+}
+
+/* Drop the neighbors which timed out */
+void expire_neighbors(call_t *to) {
+  struct nodedata *nodedata = get_node_private_data(to);
+  struct neighbor *neighbor, *next;
+  int i;
+
+  for (i = 0; i < GRID_BUCKETS; i++) {
+    for (neighbor = nodedata->buckets[i]; neighbor != NULL; neighbor = next) {
+      next = neighbor->next;
+      if (neighbor_timeout(to, neighbor)) {
+	delete_neighbor(to, neighbor);
+      }
+    }
+  }
+}
+
+
+/* ************************************************** */
+/* ************************************************** */
+/* Neighbor of a given id, if still alive */
+struct neighbor *get_neighbor(call_t *to, int id) {
+  struct nodedata *nodedata = get_node_private_data(to);
+  struct neighbor *neighbor = hashtable_retrieve(nodedata->neighbor_table, (void *) ((unsigned long) id));
+
+  if (neighbor != NULL && neighbor_timeout(to, neighbor)) {
+    delete_neighbor(to, neighbor);
+    return NULL;
+  }
+  return neighbor;
+}
+
+/* Closest neighbor to the destination in a bucket, among the neighbors of 
+ * a given cell or of any cell, dropping the neighbors which timed out 
+ */
+void bucket_nexthop(call_t *to, int bucket, int any_cell, int cell_x, int cell_y, 
+		    position_t *dst, double *dist, struct neighbor **n_hop) {
+  struct nodedata *nodedata = get_node_private_data(to);
+  struct neighbor *neighbor, *next;
+  double d;
+
+  for (neighbor = nodedata->buckets[bucket]; neighbor != NULL; neighbor = next) {
+    next = neighbor->next;
+    if (!any_cell && (neighbor->cell_x != cell_x || neighbor->cell_y != cell_y)) {
+      continue;
+    }
+    if (neighbor_timeout(to, neighbor)) {
+      delete_neighbor(to, neighbor);
       continue;
     }
         
     /* choose next hop */
-    if ((d = distance(&(neighbor->position), dst)) < dist) {
-      dist = d;
-      n_hop = neighbor;
+    if ((d = distance(&(neighbor->position), dst)) < *dist) {
+      *dist = d;
+      *n_hop = neighbor;
     }
-	
-	/* stop in case the exact destination was found */
-	if (neighbor->id == dst_id) {
-		n_hop = neighbor;
-		break;
+  }
+}
+
+struct neighbor* get_nexthop(call_t *to, position_t *dst, int dst_id) {
+  struct nodedata *nodedata = get_node_private_data(to);
+  struct neighbor *neighbor = NULL, *n_hop = NULL;
+  double dist;
+  int x, y, x0, x1, y0, y1, i;
+
+  /* stop in case the exact destination is a neighbor */
+  if ((neighbor = get_neighbor(to, dst_id)) != NULL) {
+    return neighbor;
+  }
+
+  dist = distance(get_node_position(to->object), dst);
+
+  /* a neighbor closer to the destination lies in the disc of radius dist around it 
+   * (in the plane, whatever the altitudes): only the cells holding neighbors which 
+   * cross this disc are parsed */
+  grid_bounds(nodedata);
+  x0 = (int) fmax(nodedata->min_x, floor((dst->x - dist) / nodedata->cell_size));
+  x1 = (int) fmin(nodedata->max_x, floor((dst->x + dist) / nodedata->cell_size));
+  y0 = (int) fmax(nodedata->min_y, floor((dst->y - dist) / nodedata->cell_size));
+  y1 = (int) fmin(nodedata->max_y, floor((dst->y + dist) / nodedata->cell_size));
+  if (x0 > x1 || y0 > y1) {
+    return NULL;
+  }
+
+  /* more cells than neighbors: parse the neighbors instead */
+  if ((double) (x1 - x0 + 1) * (y1 - y0 + 1) > nodedata->nb_neighbors) {
+    for (i = 0; i < GRID_BUCKETS; i++) {
+      bucket_nexthop(to, i, 1, 0, 0, dst, &dist, &n_hop);
+    }
+    return n_hop;
+  }
+
+  for (x = x0; x <= x1; x++) {
+    for (y = y0; y <= y1; y++) {
+      if (cell_in_disc(nodedata, x, y, dst, dist)) {
+	bucket_nexthop(to, cell_bucket(x, y), 0, x, y, dst, &dist, &n_hop);
+      }
+    }
+  }
+
+  return n_hop;
+}
+
+
+/* ************************************************** */
+/* ************************************************** */
+double planar_distance(position_t *position0, position_t *position1) {
+  return sqrt((position0->x - position1->x) * (position0->x - position1->x) 
+	      + (position0->y - position1->y) * (position0->y - position1->y));
+}
+
+double bearing(position_t *from, position_t *to) {
+  return atan2(to->y - from->y, to->x - from->x);
+}
+
+/* Gabriel graph: no witness in the circle of diameter uv.
+ * Relative neighborhood graph: no witness closer to both u and v than they are to each other */
+int planar_edge(call_t *to, struct neighbor *neighbor) {
+  struct nodedata *nodedata = get_node_private_data(to);
+  position_t *position = get_node_position(to->object);
+  struct neighbor *witness;
+  position_t middle;
+  double d = planar_distance(position, &(neighbor->position));
+  int i;
+
+  middle.x = (position->x + neighbor->position.x) / 2;
+  middle.y = (position->y + neighbor->position.y) / 2;
+  middle.z = position->z;
+
+  for (i = 0; i < GRID_BUCKETS; i++) {
+    for (witness = nodedata->buckets[i]; witness != NULL; witness = witness->next) {
+      if (witness == neighbor) {
+	continue;
+      }
+      if (nodedata->planarization == PLANAR_GG) {
+	if (planar_distance(&middle, &(witness->position)) < d / 2) {
+	  return 0;
 	}
-  }    
+      } else if (planar_distance(position, &(witness->position)) < d 
+		 && planar_distance(&(neighbor->position), &(witness->position)) < d) {
+	return 0;
+      }
+    }
+  }
+  return 1;
+}
+
+/* Planarize the neighbor graph, only when the neighborhood changed since last time */
+void planarize(call_t *to) {
+  struct nodedata *nodedata = get_node_private_data(to);
+  struct neighbor *neighbor;
+  int i;
+
+  if (!nodedata->planar_graph_dirty) {
+    return;
+  }
+  for (i = 0; i < GRID_BUCKETS; i++) {
+    for (neighbor = nodedata->buckets[i]; neighbor != NULL; neighbor = neighbor->next) {
+      neighbor->planar_edge = planar_edge(to, neighbor);
+    }
+  }
+  nodedata->planar_graph_dirty = 0;
+}
+
+/* Right-hand rule: first planar neighbor counterclockwise from a bearing */
+struct neighbor *right_hand_neighbor(call_t *to, double from_bearing) {
+  struct nodedata *nodedata = get_node_private_data(to);
+  position_t *position = get_node_position(to->object);
+  struct neighbor *neighbor, *n_hop = NULL;
+  double delta, best = 0;
+  int i;
+
+  for (i = 0; i < GRID_BUCKETS; i++) {
+    for (neighbor = nodedata->buckets[i]; neighbor != NULL; neighbor = neighbor->next) {
+      if (!neighbor->planar_edge) {
+	continue;
+      }
+      delta = fmod(bearing(position, &(neighbor->position)) - from_bearing + 4 * M_PI, 2 * M_PI);
+      if (delta <= 0) {
+	delta = 2 * M_PI;
+      }
+      if (n_hop == NULL || delta < best) {
+	best = delta;
+	n_hop = neighbor;
+      }
+    }
+  }
+  return n_hop;
+}
+
+/* Crossing point of segments [a,b] and [c,d] in the plane */
+int segment_intersection(position_t *a, position_t *b, position_t *c, position_t *d, position_t *cross) {
+  double rx = b->x - a->x, ry = b->y - a->y;
+  double sx = d->x - c->x, sy = d->y - c->y;
+  double denom = rx * sy - ry * sx, t, u;
+
+  if (denom == 0) {
+    return 0;
+  }
+  t = ((c->x - a->x) * sy - (c->y - a->y) * sx) / denom;
+  u = ((c->x - a->x) * ry - (c->y - a->y) * rx) / denom;
+  if (t < 0 || t > 1 || u < 0 || u > 1) {
+    return 0;
+  }
+  cross->x = a->x + t * rx;
+  cross->y = a->y + t * ry;
+  cross->z = a->z;
+  return 1;
+}
+
+/* GPSR perimeter mode: face traversal of the planar graph with the right-hand rule */
+struct neighbor *perimeter_nexthop(call_t *to, struct greedy_header *header) {
+  struct nodedata *nodedata = get_node_private_data(to);
+  position_t *position = get_node_position(to->object);
+  struct neighbor *n_hop, *prev;
+  position_t cross;
+  int new_face = 0, i;
+
+  if (nodedata->planarization == PLANAR_NONE) {
+    return NULL;
+  }
+
+  expire_neighbors(to);
+  planarize(to);
+
+  if (header->mode == GREEDY_MODE) {
+    /* entering perimeter mode: first edge counterclockwise from the line to the destination */
+    header->mode = PERIMETER_MODE;
+    header->lp = *position;
+    header->lf = *position;
+    if ((n_hop = right_hand_neighbor(to, bearing(position, &(header->dst_pos)))) == NULL) {
+      return NULL;
+    }
+    header->e0_from = to->object;
+    header->e0_to = n_hop->id;
+    new_face = 1;
+  } else {
+    /* next edge counterclockwise from the edge the packet came from */
+    prev = hashtable_retrieve(nodedata->neighbor_table, (void *) ((unsigned long) header->prev));
+    if (prev != NULL) {
+      n_hop = right_hand_neighbor(to, bearing(position, &(prev->position)));
+    } else {
+      n_hop = right_hand_neighbor(to, bearing(position, &(header->dst_pos)));
+    }
+    if (n_hop == NULL) {
+      return NULL;
+    }
+  }
+
+  /* change face when the edge crosses the line from lp to the destination closer than lf */
+  for (i = 0; i < nodedata->nb_neighbors; i++) {
+    if (!segment_intersection(position, &(n_hop->position), &(header->lp), &(header->dst_pos), &cross)
+	|| planar_distance(&cross, &(header->dst_pos)) >= planar_distance(&(header->lf), &(header->dst_pos))) {
+      break;
+    }
+    header->lf = cross;
+    n_hop = right_hand_neighbor(to, bearing(position, &(n_hop->position)));
+    header->e0_from = to->object;
+    header->e0_to = n_hop->id;
+    new_face = 1;
+  }
+
+  /* the first edge of the face is traversed again: the destination is unreachable */
+  if (!new_face && header->e0_from == to->object && header->e0_to == n_hop->id) {
+    return NULL;
+  }
 
   return n_hop;
 }
@@ -206,43 +698,76 @@ struct neighbor* get_nexthop(call_t *to, position_t *dst, int dst_id) {
 void display_neighbors(call_t *to) {
   struct nodedata *nodedata = get_node_private_data(to);
   struct neighbor *neighbor = NULL;
+  int i;
 
   /* parse neighbors */
-  list_init_traverse(nodedata->neighbors);    
   printf("[NEIGHBORS] Node %d : ", to->object);
-  while ((neighbor = (struct neighbor *) list_traverse(nodedata->neighbors)) != NULL) {        
-	printf("%d (%.3f), ", neighbor->id, distance(&(neighbor->position), get_node_position(to->object)));
-  }    
+  for (i = 0; i < GRID_BUCKETS; i++) {
+    for (neighbor = nodedata->buckets[i]; neighbor != NULL; neighbor = neighbor->next) {
+      printf("%d (%.3f), ", neighbor->id, distance(&(neighbor->position), get_node_position(to->object)));
+    }
+  }
   printf("\n");
 }
 
-void add_neighbor(call_t *to, packet_t *packet) {
+void add_neighbor(call_t *to, struct greedy_header *header) {
   struct nodedata *nodedata = get_node_private_data(to);
-  struct neighbor *neighbor = NULL;
+  struct neighbor *neighbor = hashtable_retrieve(nodedata->neighbor_table, (void *) ((unsigned long) header->src));
 
   /* check wether neighbor already exists */
-  list_init_traverse(nodedata->neighbors);      
-  while ((neighbor = (struct neighbor *) list_traverse(nodedata->neighbors)) != NULL) {      
-    if (neighbor->id == *((int*)packet_retrieve_field_value_ptr(packet,"routing_header_src"))) {
-      neighbor->position.x = *((double*)packet_retrieve_field_value_ptr(packet,"routing_header_src_pos_x"));
-      neighbor->position.y = *((double*)packet_retrieve_field_value_ptr(packet,"routing_header_src_pos_y"));
-      neighbor->position.z = *((double*)packet_retrieve_field_value_ptr(packet,"routing_header_src_pos_z"));
-      neighbor->time = get_time();
-      return;
+  if (neighbor != NULL) {
+    if (nodedata->imax > 0 && get_time() >= nodedata->interval_start) {
+      nodedata->counter++;
     }
-  }  
+    neighbor->time = get_time();
+    neighbor->interval = header->interval;
+    if (neighbor->position.x != header->src_pos.x 
+	|| neighbor->position.y != header->src_pos.y 
+	|| neighbor->position.z != header->src_pos.z) {
+      neighbor->position = header->src_pos;
+      /* the neighbor changes of bucket only when it changes of cell */
+      if (neighbor->cell_x != get_cell(nodedata, neighbor->position.x) 
+	  || neighbor->cell_y != get_cell(nodedata, neighbor->position.y)) {
+	grid_remove(nodedata, neighbor);
+	grid_insert(nodedata, neighbor);
+      } else {
+	nodedata->planar_graph_dirty = 1;
+      }
+    }
+    return;
+  }
 
   neighbor = (struct neighbor *) malloc(sizeof(struct neighbor));
-  neighbor->id = *((int*)packet_retrieve_field_value_ptr(packet,"routing_header_src"));
-  neighbor->position.x = *((double*)packet_retrieve_field_value_ptr(packet,"routing_header_src_pos_x"));
-  neighbor->position.y = *((double*)packet_retrieve_field_value_ptr(packet,"routing_header_src_pos_y"));
-  neighbor->position.z = *((double*)packet_retrieve_field_value_ptr(packet,"routing_header_src_pos_z"));
+  neighbor->id = header->src;
+  neighbor->position = header->src_pos;
   neighbor->time = get_time();
-  list_insert(nodedata->neighbors, (void *) neighbor);
+  neighbor->interval = header->interval;
+  grid_insert(nodedata, neighbor);
+  hashtable_insert(nodedata->neighbor_table, (void *) ((unsigned long) neighbor->id), (void *) neighbor);
+  nodedata->nb_neighbors++;
+  hello_reset(to);
   return;
 }
 
 
+/* ************************************************** */
+/* ************************************************** */
+struct greedy_header *add_greedy_header(packet_t *packet) {
+  struct greedy_header *header = malloc(sizeof(struct greedy_header));
+  field_t *field_header = field_create(INT, sizeof(struct greedy_header), header);
+  packet_add_field(packet, "greedy_header", field_header);
+  return header;
+}
+
+struct greedy_header *get_greedy_header(packet_t *packet) {
+  field_t *field_header = packet_retrieve_field(packet, "greedy_header");
+  if (field_header == NULL) {
+    return NULL;
+  }
+  return (struct greedy_header *) field_getValue(field_header);
+}
+
+
 /* ************************************************** */
 /* ************************************************** */
 int set_header(call_t *to, call_t *from, packet_t *packet, destination_t *dst) {
@@ -250,8 +775,27 @@ int set_header(call_t *to, call_t *from, packet_t *packet, destination_t *dst) {
   struct neighbor *n_hop = get_nexthop(to, &(dst->position), dst->id);
   destination_t destination;    
   call_t to0   = {get_class_bindings_down(to)->elts[0], to->object};
+  struct greedy_header greedy_header, *header;
   int next_hop;
 
+  /* routing header */
+  greedy_header.dst = dst->id;
+  greedy_header.dst_pos = dst->position;
+  greedy_header.src = to->object;
+  greedy_header.src_pos = *get_node_position(to->object);
+  greedy_header.type = DATA_PACKET;
+  greedy_header.hop = nodedata->hop;
+  greedy_header.mode = GREEDY_MODE;
+  greedy_header.prev = to->object;
+  greedy_header.interval = 0;
+
+  /* the source may already be a local minimum */
+  if (dst->id != BROADCAST_ADDR && n_hop == NULL) {
+    if ((n_hop = perimeter_nexthop(to, &greedy_header)) != NULL) {
+      nodedata->data_perimeter++;
+    }
+  }
+
   /* if no route, return -1 */
   if (dst->id != BROADCAST_ADDR && n_hop == NULL) {
     nodedata->data_noroute++;
@@ -265,56 +809,8 @@ int set_header(call_t *to, call_t *from, packet_t *packet, destination_t *dst) {
   }
   
   /* set routing header */
-  nodeid_t *routing_header_dst = malloc(sizeof(nodeid_t));
-  *routing_header_dst = dst->id;
-  field_t *field_routing_header_dst = field_create(INT, 8 * sizeof(nodeid_t), routing_header_dst);
-  packet_add_field(packet, "routing_header_dst", field_routing_header_dst);
-  //---------
-  double *routing_header_dst_pos_x = malloc(sizeof(double));
-  *routing_header_dst_pos_x = dst->position.x;
-  field_t *field_routing_header_dst_pos_x = field_create(DBLE, sizeof(double), routing_header_dst_pos_x);
-  packet_add_field(packet, "routing_header_dst_pos_x", field_routing_header_dst_pos_x);
-  //---------
-  double *routing_header_dst_pos_y = malloc(sizeof(double));
-  *routing_header_dst_pos_y = dst->position.y;
-  field_t *field_routing_header_dst_pos_y = field_create(DBLE, sizeof(double), routing_header_dst_pos_y);
-  packet_add_field(packet, "routing_header_dst_pos_y", field_routing_header_dst_pos_y);
-  //---------
-  double *routing_header_dst_pos_z = malloc(sizeof(double));
-  *routing_header_dst_pos_z = dst->position.z;
-  field_t *field_routing_header_dst_pos_z = field_create(DBLE, sizeof(double), routing_header_dst_pos_z);
-  packet_add_field(packet, "routing_header_dst_pos_z", field_routing_header_dst_pos_z);
-  //---------
-  nodeid_t *routing_header_src = malloc(sizeof(nodeid_t));
-  *routing_header_src = to->object;
-  field_t *field_routing_header_src = field_create(INT, sizeof(nodeid_t), routing_header_src);
-  packet_add_field(packet, "routing_header_src", field_routing_header_src);
-  //---------
-  double *routing_header_src_pos_x = malloc(sizeof(double));
-  *routing_header_src_pos_x = get_node_position(to->object)->x;
-  field_t *field_routing_header_src_pos_x = field_create(DBLE, sizeof(double), routing_header_src_pos_x);
-  packet_add_field(packet, "routing_header_src_pos_x", field_routing_header_src_pos_x);
-  //---------
-  double *routing_header_src_pos_y = malloc(sizeof(double));
-  *routing_header_src_pos_y = get_node_position(to->object)->y;
-  field_t *field_routing_header_src_pos_y = field_create(DBLE, sizeof(double), routing_header_src_pos_y);
-  packet_add_field(packet, "routing_header_src_pos_y", field_routing_header_src_pos_y);
-  //---------
-  double *routing_header_src_pos_z = malloc(sizeof(double));
-  *routing_header_src_pos_z = get_node_position(to->object)->z;
-  field_t *field_routing_header_src_pos_z = field_create(DBLE, sizeof(double), routing_header_src_pos_z);
-  packet_add_field(packet, "routing_header_src_pos_z", field_routing_header_src_pos_z);
-  //---------
-  int *routing_header_type = malloc(sizeof(int));
-  *routing_header_type = DATA_PACKET;
-  field_t *field_routing_header_type = field_create(INT, sizeof(int), routing_header_type);
-  packet_add_field(packet, "routing_header_type", field_routing_header_type);
-  //---------
-  int *routing_header_hop = malloc(sizeof(int));
-  *routing_header_hop = nodedata->hop;
-  field_t *field_routing_header_hop = field_create(INT, sizeof(int), routing_header_hop);
-  packet_add_field(packet, "routing_header_hop", field_routing_header_hop);
-  
+  header = add_greedy_header(packet);
+  *header = greedy_header;
   
   /* Set mac header */
   destination.id = next_hop;
@@ -349,88 +845,84 @@ int get_header_real_size(call_t *to, call_t *from) {
 
 /* ************************************************** */
 /* ************************************************** */
-int neighbor_timeout(void *data, void *arg) {
-  struct neighbor *neighbor = (struct neighbor *) data;
-  call_t *to = (call_t *) arg;
+/* Restart the Trickle timer from its smallest interval on a topology change */
+void hello_reset(call_t *to) {
   struct nodedata *nodedata = get_node_private_data(to);
-  if ((get_time() - neighbor->time) >= nodedata->timeout) {
-    return 1;
+  call_t from = {-1, -1};
+
+  if (nodedata->imax == 0 || nodedata->period == 0 || nodedata->interval == nodedata->period) {
+    return;
   }
-  return 0;
+  nodedata->epoch++;
+  nodedata->interval = nodedata->period;
+  nodedata->interval_start = get_time();
+  nodedata->counter = 0;
+  nodedata->suppressed = 0;
+  scheduler_add_callback(get_time() + (nodedata->interval + get_random_double() * nodedata->interval) / 2, to, &from, advert_callback, (void *) nodedata->epoch);
 }
 
 int advert_callback(call_t *to, call_t *from, void *args) {
   struct nodedata *nodedata = get_node_private_data(to);
   call_t to0   = {get_class_bindings_down(to)->elts[0], to->object};
   destination_t destination = {BROADCAST_ADDR, {-1, -1, -1}};
-  packet_t *packet = packet_create(to, nodedata->overhead + routing_header_size, nodedata->hello_packet_real_size*8);
+  packet_t *packet;
+  struct greedy_header *header;
+
+  /* outdated by a reset of the Trickle timer */
+  if (nodedata->imax > 0 && (long) args != nodedata->epoch) {
+    return 0;
+  }
+
+  /* Trickle suppression: enough neighbors already advertised themselves in the interval.
+   * Never twice in a row, so that the neighbors do not time the node out */
+  if (nodedata->imax > 0 && nodedata->k > 0 && nodedata->counter >= nodedata->k && !nodedata->suppressed) {
+    nodedata->suppressed = 1;
+    goto schedule;
+  }
+  nodedata->suppressed = 0;
 
   /* set mac header */
+  packet = packet_create(to, nodedata->overhead + routing_header_size, nodedata->hello_packet_real_size*8);
   if (SET_HEADER(&to0, to, packet, &destination) == -1) {
     packet_dealloc(packet);
     return -1;
   }
 
   /* set routing header */
-  nodeid_t *routing_header_dst = malloc(sizeof(nodeid_t));
-  *routing_header_dst = BROADCAST_ADDR;
-  field_t *field_routing_header_dst = field_create(INT, sizeof(nodeid_t), routing_header_dst);
-  packet_add_field(packet, "routing_header_dst", field_routing_header_dst);
-  //---------
-  double *routing_header_dst_pos_x = malloc(sizeof(double));
-  *routing_header_dst_pos_x = -1.0;
-  field_t *field_routing_header_dst_pos_x = field_create(DBLE, sizeof(double), routing_header_dst_pos_x);
-  packet_add_field(packet, "routing_header_dst_pos_x", field_routing_header_dst_pos_x);
-  //---------
-  double *routing_header_dst_pos_y = malloc(sizeof(double));
-  *routing_header_dst_pos_y = -1.0;
-  field_t *field_routing_header_dst_pos_y = field_create(DBLE, sizeof(double), routing_header_dst_pos_y);
-  packet_add_field(packet, "routing_header_dst_pos_y", field_routing_header_dst_pos_y);
-  //---------
-  double *routing_header_dst_pos_z = malloc(sizeof(double));
-  *routing_header_dst_pos_z = -1.0;
-  field_t *field_routing_header_dst_pos_z = field_create(DBLE, sizeof(double), routing_header_dst_pos_z);
-  packet_add_field(packet, "routing_header_dst_pos_z", field_routing_header_dst_pos_z);
-  //---------
-  nodeid_t *routing_header_src = malloc(sizeof(nodeid_t));
-  *routing_header_src = to->object;
-  field_t *field_routing_header_src = field_create(INT, sizeof(nodeid_t), routing_header_src);
-  packet_add_field(packet, "routing_header_src", field_routing_header_src);
-  //---------
-  double *routing_header_src_pos_x = malloc(sizeof(double));
-  *routing_header_src_pos_x = get_node_position(to->object)->x;
-  field_t *field_routing_header_src_pos_x = field_create(DBLE, sizeof(double), routing_header_src_pos_x);
-  packet_add_field(packet, "routing_header_src_pos_x", field_routing_header_src_pos_x);
-  //---------*((int*)packet_retrieve_field_value_ptr(packet,"routing_header_src"))
-  double *routing_header_src_pos_y = malloc(sizeof(double));
-  *routing_header_src_pos_y = get_node_position(to->object)->y;
-  field_t *field_routing_header_src_pos_y = field_create(DBLE, sizeof(double), routing_header_src_pos_y);
-  packet_add_field(packet, "routing_header_src_pos_y", field_routing_header_src_pos_y);
-  //---------
-  double *routing_header_src_pos_z = malloc(sizeof(double));
-  *routing_header_src_pos_z = get_node_position(to->object)->z;
-  field_t *field_routing_header_src_pos_z = field_create(DBLE, sizeof(double), routing_header_src_pos_z);
-  packet_add_field(packet, "routing_header_src_pos_z", field_routing_header_src_pos_z);
-  //---------
-  int *routing_header_type = malloc(sizeof(int));
-  *routing_header_type = HELLO_PACKET;
-  field_t *field_routing_header_type = field_create(INT, sizeof(int), routing_header_type);
-  packet_add_field(packet, "routing_header_type", field_routing_header_type);
-  //---------
-  int *routing_header_hop = malloc(sizeof(int));
-  *routing_header_hop = 1;
-  field_t *field_routing_header_hop = field_create(INT, sizeof(int), routing_header_hop);
-  packet_add_field(packet, "routing_header_hop", field_routing_header_hop);
+  header = add_greedy_header(packet);
+  header->dst = BROADCAST_ADDR;
+  header->dst_pos.x = -1.0;
+  header->dst_pos.y = -1.0;
+  header->dst_pos.z = -1.0;
+  header->src = to->object;
+  header->src_pos = *get_node_position(to->object);
+  header->type = HELLO_PACKET;
+  header->hop = 1;
+  header->mode = GREEDY_MODE;
+  header->prev = to->object;
+  header->interval = hello_interval(to);
 
   /* send hello */
   TX(&to0, to, packet);
   nodedata->hello_tx++;
 
+ schedule:
   /* check neighbors timeout  */
-  list_selective_delete(nodedata->neighbors, neighbor_timeout, (void *) to);
+  expire_neighbors(to);
 
   /* schedules hello */
-  scheduler_add_callback(get_time() + nodedata->period, to, from, advert_callback, NULL);
+  if (nodedata->imax == 0) {
+    scheduler_add_callback(get_time() + nodedata->period, to, from, advert_callback, NULL);
+  }
+  else if ((long) args == nodedata->epoch) {
+    /* next interval, doubled up to Imax, unless a lost neighbor reset the timer */
+    nodedata->interval_start += nodedata->interval;
+    if (nodedata->interval < (nodedata->period << nodedata->imax)) {
+      nodedata->interval *= 2;
+    }
+    nodedata->counter = 0;
+    scheduler_add_callback(nodedata->interval_start + (nodedata->interval + get_random_double() * nodedata->interval) / 2, to, from, advert_callback, (void *) nodedata->epoch);
+  }
 
   return 0;
 }
@@ -450,22 +942,33 @@ void tx(call_t *to, call_t* from, packet_t *packet) {
 
 /* ************************************************** */
 /* ************************************************** */
-void forward(call_t *to, call_t *from, packet_t *packet) {  
+void forward(call_t *to, call_t *from, packet_t *packet, struct greedy_header *header) {  
   struct nodedata *nodedata = get_node_private_data(to);
   call_t to0   = {get_class_bindings_down(to)->elts[0], to->object};
   call_t from0 = {to->class, to->object};
-  position_t dst_pos;
-  
-  dst_pos.x = *((double*)packet_retrieve_field_value_ptr(packet,"routing_header_dst_pos_x"));
-  dst_pos.y = *((double*)packet_retrieve_field_value_ptr(packet,"routing_header_dst_pos_y"));
-  dst_pos.z = *((double*)packet_retrieve_field_value_ptr(packet,"routing_header_dst_pos_z"));
-  
-  int dst = *((int*)packet_retrieve_field_value_ptr(packet,"routing_header_dst"));
-
-  
-  struct neighbor *n_hop = get_nexthop(to, &dst_pos, dst);
+  position_t *position = get_node_position(to->object);
+  struct neighbor *n_hop;
   destination_t destination;    
 
+  /* back to greedy mode once closer to the destination than where perimeter mode was entered */
+  if (header->mode == PERIMETER_MODE 
+      && distance(position, &(header->dst_pos)) < distance(&(header->lp), &(header->dst_pos))) {
+    header->mode = GREEDY_MODE;
+  }
+
+  if (header->mode == GREEDY_MODE) {
+    n_hop = get_nexthop(to, &(header->dst_pos), header->dst);
+  } else if ((n_hop = get_neighbor(to, header->dst)) != NULL) {
+    header->mode = GREEDY_MODE;
+  }
+
+  /* local minimum: route around the void along the faces of the planar graph */
+  if (n_hop == NULL) {
+    if ((n_hop = perimeter_nexthop(to, header)) != NULL) {
+      nodedata->data_perimeter++;
+    }
+  }
+
   /* delivers packet to application layer */
   if (n_hop == NULL) {
     /*  array_t *up = get_class_bindings_up(to);
@@ -490,14 +993,15 @@ void forward(call_t *to, call_t *from, packet_t *packet) {
     }
     
   /* update hop count */
-  (*((int*)packet_retrieve_field_value_ptr(packet,"routing_header_hop")))--;
-  if (*((int*)packet_retrieve_field_value_ptr(packet,"routing_header_hop")) == 0) {
+  if (--header->hop == 0) {
     nodedata->data_hop++;
     packet_dealloc(packet);
     return;
   }
     
 
+  header->prev = to->object;
+
   /* set mac header */
   destination.id = n_hop->id;
   destination.position.x = -1;
@@ -519,26 +1023,31 @@ void forward(call_t *to, call_t *from, packet_t *packet) {
 void rx(call_t *to, call_t *from, packet_t *packet) {
   struct nodedata *nodedata = get_node_private_data(to);
   array_t *up = get_class_bindings_up(to);
+  struct greedy_header *header = get_greedy_header(packet);
   int i = up->size;
 
-  switch(*((int*)packet_retrieve_field_value_ptr(packet,"routing_header_type"))) {
+  if (header == NULL) {
+    packet_dealloc(packet);
+    return;
+  }
+
+  switch(header->type) {
   case HELLO_PACKET:         
     nodedata->hello_rx++;
-    add_neighbor(to, packet);
+    add_neighbor(to, header);
     packet_dealloc(packet);
     break;
 
   case DATA_PACKET : 
     nodedata->data_rx++;
-    int dst = *((int*)packet_retrieve_field_value_ptr(packet,"routing_header_dst"));
-    if ( (dst != BROADCAST_ADDR) && (dst != to->object) ) {
-      forward(to, from, packet);
+    if ( (header->dst != BROADCAST_ADDR) && (header->dst != to->object) ) {
+      forward(to, from, packet, header);
       return;
     }
-       int hops = nodedata->hop - (*((int*)packet_retrieve_field_value_ptr(packet,"routing_header_hop"))) + 1;
+       int hops = nodedata->hop - header->hop + 1;
 
 //#ifdef ROUTING_LOG_DATA_RX
-			  printf("[ROUTING_LOG_DATA_RX]  DST %d has received a data packet from source node %d hops nbr = %d - forwarding to upper layer \n", to->object, *((int*)packet_retrieve_field_value_ptr(packet,"routing_header_src")), hops);
+			  printf("[ROUTING_LOG_DATA_RX]  DST %d has received a data packet from source node %d hops nbr = %d - forwarding to upper layer \n", to->object, header->src, hops);
 //#endif
 
 
@@ -38,6 +38,9 @@ int init(call_t *to, void *params) {
    classdata->current_rx_control_packet = 0;
    classdata->current_tx_control_packet_bytes = 0;
    classdata->current_rx_control_packet_bytes = 0;  
+
+   /* resolve the packet header handles */
+   packet_header_fields_init(classdata);
    
     /* Assign the initialized local variables to the node */
     set_class_private_data(to, classdata);
@@ -86,8 +89,11 @@ int bind(call_t *to, void *params) {
   for(i = 0; i < MAX_NEIGHBORS_SIZE; i++) {	
 	for(j = 0; j < MAX_NEIGHBORS_SIZE; j++){
 		nodedata->neighbors_2hops[i][j] = -1;
+		nodedata->topology_matrix[i][j] = 0;
 	}
   }
+  nodedata->olsr_topology_changed = 1;
+  nodedata->olsr_forwarding_mode = OLSR_SOURCE_ROUTING;
 
   /* set the default values for the hello protocol */
   nodedata->hello_status = STATUS_ON;
@@ -95,6 +101,15 @@ int bind(call_t *to, void *params) {
   nodedata->hello_start = 0;
   nodedata->hello_period = 1000000000ull; /* 1s */
   nodedata->hello_timeout = 3*nodedata->hello_period;  
+  nodedata->hello_imin = 0;
+  nodedata->hello_imax = 0;
+  nodedata->hello_k = 0;
+  nodedata->hello_interval = 0;
+  nodedata->hello_interval_start = 0;
+  nodedata->hello_counter = 0;
+  nodedata->hello_suppressed = 0;
+  nodedata->hello_epoch = 0;
+  nodedata->hello_callback = NULL;
 
   /* set the default values for the TC Packet */
   /* UPDATED by Dhafer 01-05-2015 */
@@ -151,6 +166,21 @@ int bind(call_t *to, void *params) {
 	goto error;
       }
     }
+    if (!strcmp(param->key, "hello_imin")) {
+      if (get_param_time(param->value, &(nodedata->hello_imin))) {
+	goto error;
+      }
+    }
+    if (!strcmp(param->key, "hello_imax")) {
+      if (get_param_integer_range(param->value, &(nodedata->hello_imax), 0, 16)) {
+	goto error;
+      }
+    }
+    if (!strcmp(param->key, "hello_k")) {
+      if (get_param_integer(param->value, &(nodedata->hello_k))) {
+	goto error;
+      }
+    }
 
  /* reading the parameter related to the TC packet from the xml file */
     if (!strcmp(param->key, "tc_status")) {
@@ -180,6 +210,13 @@ int bind(call_t *to, void *params) {
     }
 
 
+    /* reading the parameter related to the data forwarding mode from the xml file */
+    if (!strcmp(param->key, "forwarding_mode")) {
+      if (get_param_integer(param->value, &(nodedata->olsr_forwarding_mode))) {
+	goto error;
+      }
+    }
+
     /* reading the parameter related to the link quality estimator from the xml file */
     if (!strcmp(param->key, "rssi_smoothing1_nbr")) {
       if (get_param_integer(param->value, &(nodedata->rssi_smoothing1_nbr))) {
@@ -218,6 +255,7 @@ int bind(call_t *to, void *params) {
 
   /* Check protocol status */
   nodedata->hello_status = (nodedata->hello_status > 0)? STATUS_ON : STATUS_OFF;	
+  nodedata->olsr_forwarding_mode = (nodedata->olsr_forwarding_mode == OLSR_HOP_BY_HOP)? OLSR_HOP_BY_HOP : OLSR_SOURCE_ROUTING;
 	
   set_node_private_data(to, nodedata);
   
@@ -233,6 +271,7 @@ int bind(call_t *to, void *params) {
 int unbind(call_t *to) {
  struct nodedata *nodedata = get_node_private_data(to);
   struct neighbor *neighbor;
+  struct route_olsrv2 *route = NULL;
   
 #ifdef ROUTING_LOG_NODE_STATS
   int size_hello = (nodedata->hello_packet_real_size != -1) ? nodedata->hello_packet_real_size : (int)(nodedata->overhead + sizeof(struct packet_header)+sizeof(struct hello_packet_header));
@@ -241,7 +280,7 @@ int unbind(call_t *to) {
   //int size_rrep = (nodedata->rrep_packet_real_size != -1) ? nodedata->rrep_packet_real_size : (int)(nodedata->overhead + sizeof(struct packet_header)+sizeof(struct rrep_packet_header));
   int tx_total = nodedata->tx_nbr[0] + nodedata->tx_nbr[1] + nodedata->tx_nbr[2] + nodedata->tx_nbr[3] + nodedata->tx_nbr[4];
   int rx_total = nodedata->rx_nbr[0] + nodedata->rx_nbr[1] + nodedata->rx_nbr[2] + nodedata->rx_nbr[3] + nodedata->rx_nbr[4];
-  struct route_aodv *route = route_get_nexthop_to_destination(to, nodedata->sink_id);
+  route = route_get_nexthop_to_destination_olsrv2(to, nodedata->sink_id);
 
   if (route != NULL) {
     printf("[NETWORK_STATS] node %d type %d X %lf Y %lf Z %lf sink_dst %d nexthop_id %d hops %d neighbors %d routes %d tx_nbr %d rx_nbr %d init_path_delay_ms %lf final_path_delay_ms %lf Hello_packet %d %d %d Interest_packet %d %d %d Data_packet %d %d %d \n", to->object, nodedata->node_type, get_node_position(to->object)->x, get_node_position(to->object)->y, get_node_position(to->object)->z, nodedata->sink_id, route->nexthop_id, route->hop_to_dst , list_getsize(nodedata->neighbors), list_getsize(nodedata->routing_table), tx_total, rx_total, nodedata->path_establishment_delay, route->time*0.000001, nodedata->tx_nbr[0], nodedata->rx_nbr[0], size_hello, nodedata->tx_nbr[1], nodedata->rx_nbr[1], size_interest, nodedata->tx_nbr[2], nodedata->rx_nbr[2], nodedata->data_packet_size, nodedata->tx_nbr[3], nodedata->rx_nbr[3]);
@@ -259,8 +298,12 @@ int unbind(call_t *to) {
   while ((neighbor = (struct neighbor *) list_pop(nodedata->neighbors)) != NULL) {
     free(neighbor);
   }
+  while ((route = (struct route_olsrv2 *) list_pop(nodedata->routing_table)) != NULL) {
+    free(route);
+  }
 
   list_destroy(nodedata->neighbors);    
+  list_destroy(nodedata->routing_table);    
   free(nodedata);
   return 0;
 }
@@ -278,10 +321,7 @@ int bootstrap(call_t *to) {
         
   /* start the neighbor discovery protocol */
   if (nodedata->hello_status == STATUS_ON && (nodedata->hello_nbr > 0 || nodedata->hello_nbr == -1)) {
-    uint64_t hello_slot_time = get_time() + nodedata->hello_start;
-    uint64_t hello_tx_time = hello_slot_time + get_random_double() * nodedata->hello_period;
-    nodedata->previous_hello_slot_time = hello_slot_time; 
-	scheduler_add_callback(hello_tx_time, to, &from, neighbor_discovery_callback_olsrv2, NULL);
+    neighbor_hello_start(to, &from, neighbor_discovery_callback_olsrv2);
   }
 
   /* Broadcast the TC Packet */
@@ -321,28 +361,29 @@ int set_header(call_t *to, call_t *from, packet_t *packet, destination_t *dst) {
 		return -1;
   }
 
-  /* Running Dijkstra to get shortest path with dijkstra */
-  dijkstra(to, to->object, dst->id); 
-
-
   /* check for a route to the destination */
   if (dst->id != BROADCAST_ADDR) {
 
-	  if (nodedata->olsr_path[0] == -1) {
+	  /* the routing table is rebuilt by a single SPF run only when the topology has changed */
+	  route = route_get_nexthop_to_destination_olsrv2(to, dst->id);
+
+	  if (route == NULL) {
 #ifdef ROUTING_DEBUG	  
 		printf("[ROUTING_DATA_SETHEADER] node %d no route to destination %d ==> Packet discarded...\n", to->object, dst->id);
 #endif
 		return -1;
 	  }
-	  destination.id = nodedata->olsr_path[1];
-	  header->dst = nodedata->olsr_path[1];
+	  destination.id = route->nexthop_id;
+	  header->dst = route->nexthop_id;
 	  header->end_dst = dst->id;
 
-	  // add full route and index for the next nexthop node
+	  // add full route and index for the next nexthop node (source routing only)
 	  header->olsr_path_index = 1;
-	  for (i = 0; i < MAX_NEIGHBORS_SIZE ; i++) {
-	  	header->olsr_path[i] = nodedata->olsr_path[i];	  
-          }
+	  if (nodedata->olsr_forwarding_mode == OLSR_SOURCE_ROUTING) {
+	    for (i = 0; i < MAX_NEIGHBORS_SIZE ; i++) {
+	  	header->olsr_path[i] = route->path[i];	  
+	    }
+	  }
 #ifdef ROUTING_DEBUG
 	  printf("[ROUTING_DATA_SETHEADER] time=%fs  Node %d sending packet to Node %d through nexthop %d added to Header \n\n", get_time()*0.000000001,to->object, header->end_dst, header->dst);
 #endif
@@ -390,6 +431,10 @@ int get_header_real_size(call_t *to, call_t *from) {
 	/* get mac header overhead */
 	nodedata->overhead = GET_HEADER_REAL_SIZE(&to0, to);
   }
+  /* in hop-by-hop mode the data header only carries the final destination, not the whole path */
+  if (nodedata->olsr_forwarding_mode == OLSR_HOP_BY_HOP) {
+	return nodedata->overhead + sizeof(struct packet_header) - sizeof(((struct packet_header *) 0)->olsr_path);
+  }
   return nodedata->overhead + sizeof(struct packet_header);
 }
 
@@ -397,8 +442,7 @@ int get_header_real_size(call_t *to, call_t *from) {
 /* ************************************************** */
 void tx(call_t *to, call_t* from, packet_t *packet) {
   struct nodedata *nodedata = get_node_private_data(to);
-  field_t *field_header = packet_retrieve_field(packet, "packet_header");
-  struct packet_header* header = (struct packet_header*) field_getValue(field_header);
+  struct packet_header* header = (struct packet_header*) packet_header_get(to, packet, HEADER_FIELD_PACKET);
   call_t to0   = {get_class_bindings_down(to)->elts[0], to->object};
   call_t from0 = {to->class, to->object};
   
@@ -420,12 +464,10 @@ void tx(call_t *to, call_t* from, packet_t *packet) {
 void rx(call_t *to, call_t *from, packet_t *packet) {
   struct nodedata *nodedata = get_node_private_data(to);
   struct classdata *classdata = get_class_private_data(to);
-  field_t *field_rreq_packet_header, *field_rrep_header;
   
-  field_t *field_header = packet_retrieve_field(packet, "packet_header");
-  struct packet_header* header = (struct packet_header*) field_getValue(field_header);
+  struct packet_header* header = (struct packet_header*) packet_header_get(to, packet, HEADER_FIELD_PACKET);
   
-
+  struct hello_packet_header *hello_header;
   struct tc_packet_header *tc_header;
 
   array_t *up = get_class_bindings_up(to);
@@ -461,7 +503,8 @@ void rx(call_t *to, call_t *from, packet_t *packet) {
   switch(header->packet_type) {
   case HELLO_PACKET:         
 			/* update local neighbor table */
-			neighbor_update_from_olsrv2_hello(to, packet);		
+			hello_header = (struct hello_packet_header*) packet_header_get(to, packet, HEADER_FIELD_HELLO);
+			neighbor_update_from_olsrv2_hello(to, packet, header, hello_header);		
 			
 			/* Get the Unique entire 2hops neighbors*/
 			get_all_2hop_neighbors(to, Max);
@@ -487,12 +530,11 @@ void rx(call_t *to, call_t *from, packet_t *packet) {
 /* TC packet management 		  */
 
  case TC_PACKET:         
+			tc_header = (struct tc_packet_header*) packet_header_get(to, packet, HEADER_FIELD_TC);
+
 			/* update topolgy from TC packet */
-			route_update_from_tc(to, packet);
+			route_update_from_tc(to, header, tc_header);
 			//display_topology(to);
-			
-			field_t *field_tc_header = packet_retrieve_field(packet, "tc_packet_header");
-			struct tc_packet_header* tc_header = (struct tc_packet_header*) field_getValue(field_tc_header);
 
 			
 			/* When TC_Packet received no transmit to upper layers */
@@ -553,9 +595,11 @@ void rx(call_t *to, call_t *from, packet_t *packet) {
 			/* forward the data packet to the closest/particular sink */
 			else {
 
-                         //   - update packet header dst field based on nexthop_index++
-				header->olsr_path_index++;				
-				header->dst = header->olsr_path[header->olsr_path_index];
+                         //   - update packet header dst field based on nexthop_index++ (source routing)
+                         //     or on the local routing table (hop-by-hop)
+				if (nodedata->olsr_forwarding_mode == OLSR_SOURCE_ROUTING) {
+					header->olsr_path_index++;
+				}
 				
 			 // route_forward_olsrv2_data_packet_to_destination(to, from, packet);
   				route_forward_olsrv2_data_packet_to_destination(to, from, packet);
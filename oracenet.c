@@ -38,6 +38,9 @@ int init(call_t *to, void *params) {
    classdata->current_rx_control_packet = 0;
    classdata->current_tx_control_packet_bytes = 0;
    classdata->current_rx_control_packet_bytes = 0;  
+
+   /* resolve the packet header handles */
+   packet_header_fields_init(classdata);
    
     /* Assign the initialized local variables to the node */
     set_class_private_data(to, classdata);
@@ -72,8 +75,22 @@ int bind(call_t *to, void *params) {
   nodedata->neighbors = list_create();
   nodedata->routing_table = list_create();
   nodedata->interest_table = list_create();
+  nodedata->interest_pending = list_create();
+  nodedata->interest_flush_scheduled = 0;
+  nodedata->interest_aggregation_size = MAX_AGGREGATED_INTERESTS;
+  nodedata->aggregation_table = list_create();
+  nodedata->duplicate_table = hashtable_create(route_duplicate_hash, route_duplicate_equal, NULL, free);
+  for (i=0; i<MAX_DATA_TYPES; i++) {
+	nodedata->aggregation_function[i] = AGGREGATION_OFF;
+  }
+  nodedata->aggregation_hold = 100000000ull; /* 100ms */
+  nodedata->aggregation_max_size = MAX_AGGREGATED_DATA;
+  nodedata->pending_table = list_create();
+  nodedata->pending_queue_size = 16;
+  nodedata->pending_timeout = 5000000000ull; /* 5s */
   nodedata->path_establishment_delay = -1;
   nodedata->data_seq = 0;
+  nodedata->load_split_threshold = 0.0;
   for (i=0; i<5; i++) {
 	nodedata->rx_nbr[i] = 0;
 	nodedata->tx_nbr[i] = 0;
@@ -83,6 +100,7 @@ int bind(call_t *to, void *params) {
   /* set the default values for the real sizes of packets */
   nodedata->hello_packet_real_size     = 13;
   nodedata->interest_packet_real_size = 13;
+  nodedata->interest_entry_real_size = 8;
   
   /* set the default values for the hello protocol */
   nodedata->hello_status = STATUS_ON;
@@ -90,6 +108,23 @@ int bind(call_t *to, void *params) {
   nodedata->hello_start = 0;
   nodedata->hello_period = 1000000000ull; /* 1s */
   nodedata->hello_timeout = 3*nodedata->hello_period;
+  nodedata->hello_imin = 0;
+  nodedata->hello_imax = 0;
+  nodedata->hello_k = 0;
+  nodedata->hello_interval = 0;
+  nodedata->hello_interval_start = 0;
+  nodedata->hello_counter = 0;
+  nodedata->hello_suppressed = 0;
+  nodedata->hello_epoch = 0;
+  nodedata->hello_callback = NULL;
+  nodedata->last_tx_time = 0;
+  nodedata->delayed_hello = 0;
+  nodedata->hello_window_start = 0;
+  nodedata->hello_seq = 0;
+  nodedata->hello_piggyback_unicast = STATUS_OFF;
+  nodedata->overheard_nbr = 0;
+  nodedata->overheard_period = 100000000ull; /* 100ms */
+  nodedata->overheard_scheduled = 0;
 
   /* set the default values for the link quality estimator */
   nodedata->rssi_smoothing1_nbr = 1;
@@ -97,6 +132,8 @@ int bind(call_t *to, void *params) {
   nodedata->lqe_w = 10;
   nodedata->lqe_threshold = 0.8;
   nodedata->rssi_smoothing_factor = 0.9;
+  nodedata->lqe_estimator = LQE_PRR;
+  nodedata->lqe_alpha = 0.9;
 
   /* set the default values for the SINK interest propagation protocol */
   nodedata->sink_interest_status = STATUS_OFF;
@@ -113,7 +150,6 @@ int bind(call_t *to, void *params) {
   
   for (i=0; i<MAX_NEIGHBORS_SIZE; i++) {
 	nodedata->nbr_received_hello[i] = -1;
-	nodedata->last_seq[i] = -1;
   }
   
   /* get params */
@@ -128,6 +164,11 @@ int bind(call_t *to, void *params) {
     }
 	
     /* reading the parameter related to the hello protocol from the xml file */
+    if (!strcmp(param->key, "hello_piggyback_unicast")) {
+      if (get_param_integer(param->value, &(nodedata->hello_piggyback_unicast))) {
+	goto error;
+      }
+    }
     if (!strcmp(param->key, "hello_status")) {
       if (get_param_integer(param->value, &(nodedata->hello_status))) {
 	goto error;
@@ -153,6 +194,31 @@ int bind(call_t *to, void *params) {
 	goto error;
       }
     }
+    if (!strcmp(param->key, "load_split_threshold")) {
+      if (get_param_double_range(param->value, &(nodedata->load_split_threshold), 0.0, 1.0)) {
+	goto error;
+      }
+    }
+    if (!strcmp(param->key, "overheard_period")) {
+      if (get_param_time(param->value, &(nodedata->overheard_period))) {
+	goto error;
+      }
+    }
+    if (!strcmp(param->key, "hello_imin")) {
+      if (get_param_time(param->value, &(nodedata->hello_imin))) {
+	goto error;
+      }
+    }
+    if (!strcmp(param->key, "hello_imax")) {
+      if (get_param_integer_range(param->value, &(nodedata->hello_imax), 0, 16)) {
+	goto error;
+      }
+    }
+    if (!strcmp(param->key, "hello_k")) {
+      if (get_param_integer(param->value, &(nodedata->hello_k))) {
+	goto error;
+      }
+    }
 	
     /* reading the parameter related to the interest dissemination protocol from the xml file */
     if (!strcmp(param->key, "sink_interest_status")) {
@@ -190,6 +256,26 @@ int bind(call_t *to, void *params) {
 	goto error;
       }
     }
+    if (!strcmp(param->key, "aggregation")) {
+      if (route_aggregation_set(nodedata, param->value)) {
+	goto error;
+      }
+    }
+    if (!strcmp(param->key, "aggregation_hold")) {
+      if (get_param_time(param->value, &(nodedata->aggregation_hold))) {
+	goto error;
+      }
+    }
+    if (!strcmp(param->key, "aggregation_max_size")) {
+      if (get_param_integer(param->value, &(nodedata->aggregation_max_size))) {
+	goto error;
+      }
+    }
+    if (!strcmp(param->key, "interest_aggregation_size")) {
+      if (get_param_integer(param->value, &(nodedata->interest_aggregation_size))) {
+	goto error;
+      }
+    }
     if (!strcmp(param->key, "sink_interest_data_type")) {
       if (get_param_integer(param->value, &(nodedata->sink_interest_data_type))) {
 	goto error;
@@ -207,8 +293,13 @@ int bind(call_t *to, void *params) {
 	goto error;
       }
     }
+    if (!strcmp(param->key, "rssi_smoothing_factor")) {
+      if (get_param_double_range(param->value, &(nodedata->rssi_smoothing_factor), 0.0, 1.0)) {
+	goto error;
+      }
+    }
     if (!strcmp(param->key, "lqe_w")) {
-      if (get_param_integer(param->value, &(nodedata->lqe_w))) {
+      if (get_param_integer_range(param->value, &(nodedata->lqe_w), 1, 64)) {
 	goto error;
       }
     }
@@ -217,6 +308,16 @@ int bind(call_t *to, void *params) {
 	goto error;
       }
     }
+    if (!strcmp(param->key, "lqe_estimator")) {
+      if (get_param_integer(param->value, &(nodedata->lqe_estimator))) {
+	goto error;
+      }
+    }
+    if (!strcmp(param->key, "lqe_alpha")) {
+      if (get_param_double_range(param->value, &(nodedata->lqe_alpha), 0.0, 1.0)) {
+	goto error;
+      }
+    }
 	
     /* reading the parameter related to the real sizes of packets from the xml file */
     if (!strcmp(param->key, "hello_packet_real_size")) {
@@ -229,6 +330,23 @@ int bind(call_t *to, void *params) {
 	goto error;
       }
     }	
+    if (!strcmp(param->key, "interest_entry_real_size")) {
+      if (get_param_integer(param->value, &(nodedata->interest_entry_real_size))) {
+	goto error;
+      }
+    }
+
+    /* reading the parameter related to the data packets waiting for a route from the xml file */
+    if (!strcmp(param->key, "pending_queue_size")) {
+      if (get_param_integer(param->value, &(nodedata->pending_queue_size))) {
+	goto error;
+      }
+    }
+    if (!strcmp(param->key, "pending_timeout")) {
+      if (get_param_time(param->value, &(nodedata->pending_timeout))) {
+	goto error;
+      }
+    }
 	
   }
     
@@ -240,6 +358,12 @@ int bind(call_t *to, void *params) {
   /* Check protocol status */
   nodedata->hello_status = (nodedata->hello_status > 0)? STATUS_ON : STATUS_OFF;
   nodedata->sink_interest_status = (nodedata->sink_interest_status > 0)? STATUS_ON : STATUS_OFF;
+  nodedata->aggregation_max_size = (nodedata->aggregation_max_size < 2)? 2 : (nodedata->aggregation_max_size > MAX_AGGREGATED_DATA)? MAX_AGGREGATED_DATA : nodedata->aggregation_max_size;
+  nodedata->interest_aggregation_size = (nodedata->interest_aggregation_size < 1)? 1 : (nodedata->interest_aggregation_size > MAX_AGGREGATED_INTERESTS)? MAX_AGGREGATED_INTERESTS : nodedata->interest_aggregation_size;
+  nodedata->pending_queue_size = (nodedata->pending_queue_size < 1)? 1 : (nodedata->pending_queue_size > MAX_PENDING_SIZE)? MAX_PENDING_SIZE : nodedata->pending_queue_size;
+  if (nodedata->lqe_estimator != LQE_EWMA && nodedata->lqe_estimator != LQE_WMEWMA) {
+    nodedata->lqe_estimator = LQE_PRR;
+  }
 	
   set_node_private_data(to, nodedata);
   return 0;
@@ -278,6 +402,14 @@ int unbind(call_t *to) {
   }
   
   list_destroy(nodedata->neighbors);    
+  sink_interest_pending_destroy(to);
+  route_aggregation_destroy(to);
+
+  /* free the data packets still waiting for a route */
+  route_pending_destroy(to);
+
+  /* free the duplicate detection windows */
+  route_duplicate_destroy(to);
   free(nodedata);
   return 0;
 }
@@ -291,18 +423,32 @@ int unbind(call_t *to) {
 int ioctl(call_t *to, int option, void *in, void **out) {
   struct nodedata *nodedata = get_node_private_data(to);
   packet_t *packet;
-  field_t *field_header;
+  struct packet_header *header;
+  struct overheard_record record;
 
-  // extract packet which was filtered by MAC layer to update our neighbor table
-  packet = (packet_t *) in;
-  
   switch (option) {
-  case 1: // MAC_NOTIFY_FILTERED_DATA
-	field_header = packet_retrieve_field(packet, "packet_header");
-	struct packet_header* header = (struct packet_header*) field_getValue(field_header);
+  case 1: // MAC_NOTIFY_FILTERED_DATA: the packet filtered by the MAC layer, only a small record of it is kept
+	packet = (packet_t *) in;
+	header = (struct packet_header*) packet_header_get(to, packet, HEADER_FIELD_PACKET);
 	//printf("[ORACENET-IOCTL] data packet from node %d was filtered at node %d at time %fs \n", header->src, to->object, get_time()*0.000000001);
-        oracenet_neighbor_crosslayer_update(to, packet, header->prevhop);
+	record.sender = header->prevhop;
+	record.type = header->type;
+	record.hello_seq = header->hello_seq;
+	record.hop_to_sink = header->hello_hop_to_sink;
+	record.sink_prr = header->hello_prr;
+	record.hello_interval = header->hello_interval;
+	record.rxdbm = packet->rxdBm;
+	record.time = get_time();
         packet_dealloc(packet);
+        oracenet_neighbor_crosslayer_record(to, &record);
+	break;
+
+  case 2: // MAC_NOTIFY_FILTERED_RECORD: the MAC layer hands over a struct overheard_record
+        oracenet_neighbor_crosslayer_record(to, (struct overheard_record *) in);
+	break;
+
+  case 3: // MAC_NOTIFY_TX_FAILURE: the MAC layer gave up the transmission towards the nexthop pointed by in
+        route_link_failure_oracenet(to, *((int *) in));
 	break;
 
   default:
@@ -324,16 +470,10 @@ int bootstrap(call_t *to) {
   
   /* get mac header overhead */
   nodedata->overhead = GET_HEADER_SIZE(&to0, to);
-  nodedata->delayed_hello = 0;
   /* start the neighbor discovery protocol */
   if (nodedata->hello_status == STATUS_ON && (nodedata->hello_nbr > 0 || nodedata->hello_nbr == -1)) {
-    uint64_t hello_slot_time = get_time() + nodedata->hello_start;
-    uint64_t hello_tx_time = hello_slot_time + get_random_double() * nodedata->hello_period;
-    nodedata->previous_hello_slot_time = hello_slot_time; 
-	/* Schedule the HELLO BDCAST Only when there was no any TX for nodedata->period */
-	
-	scheduler_add_callback(hello_tx_time, to, &from, neighbor_discovery_callback_oracenet, NULL);
-	
+    /* Schedule the HELLO BDCAST Only when there was no any TX for nodedata->period */
+    neighbor_hello_start(to, &from, neighbor_discovery_callback_oracenet);
   }
 
   /* start the sink interest propagation protocol */
@@ -366,17 +506,29 @@ int set_header(call_t *to, call_t *from, packet_t *packet, destination_t *dst) {
   
   /* check for a route to the closest sink */
   if (dst->id == BROADCAST_ADDR) {
-    route = route_get_nexthop_to_destination_oracenet(to, -1);
+    route = route_select_oracenet(to, -1);
   }
   /* check for a route to a particular sink */
   else {
-    route = route_get_nexthop_to_destination_oracenet(to, dst->id); 
+    route = route_select_oracenet(to, dst->id); 
   }
   
-  /* if no route, return -1 */
+  /* if no route, the packet waits in tx() for an interest or a data packet from the destination */
   if (route == NULL) {
-    printf("[ROUTING_DATA_SETHEADER] node %d no route to destination %d\n", to->object, dst->id);
-    return -1;
+#ifdef ROUTING_DEBUG
+    printf("[ROUTING_DATA_SETHEADER] node %d no route to destination %d ==> data packet buffered\n", to->object, dst->id);
+#endif
+    header->src = to->object;
+    header->dst = dst->id;
+    header->nexthop = PENDING_ADDR;
+    header->prevhop = to->object;
+    header->lqe = 1.0;
+    header->E2E_PRR = 1.0;
+    header->seq = nodedata->data_seq++;
+    header->type = nodedata->node_type;
+    header->packet_type = DATA_PACKET;
+    header->hop = 0;
+    return 0;
   }
 
   while((neighbor = (struct neighbor *) list_traverse(nodedata->neighbors)) != NULL) { 
@@ -400,6 +552,9 @@ int set_header(call_t *to, call_t *from, packet_t *packet, destination_t *dst) {
 
   route->hop_to_dst = 0;
   route->dst = dst->id;
+
+  /* the data packet carries the hello fields */
+  oracenet_hello_piggyback(to, header, route->hop_to_sink, route->E2E_PRR, 0);
   
   
  #ifdef ROUTING_DEBUG	  
@@ -445,11 +600,16 @@ int get_header_real_size(call_t *to, call_t *from) {
 void tx(call_t *to, call_t* from, packet_t *packet) {
   struct nodedata *nodedata = get_node_private_data(to);
   
-  field_t *field_header = packet_retrieve_field(packet, "packet_header");
-  struct packet_header* header = (struct packet_header*) field_getValue(field_header);
+  struct packet_header* header = (struct packet_header*) packet_header_get(to, packet, HEADER_FIELD_PACKET);
   
   call_t to0   = {get_class_bindings_down(to)->elts[0], to->object};
   call_t from0 = {to->class, to->object};
+
+  /* keep the data packet until a route towards its destination is known */
+  if (header->nexthop == PENDING_ADDR) {
+    route_pending_insert(to, packet, header->dst);
+    return;
+  }
   
   TX(&to0, &from0, packet);
 
@@ -472,8 +632,10 @@ void rx(call_t *to, call_t *from, packet_t *packet) {
   struct nodedata *nodedata = get_node_private_data(to);
   struct classdata *classdata = get_class_private_data(to);
   
-  field_t *field_header = packet_retrieve_field(packet, "packet_header");
-  struct packet_header* header = (struct packet_header*) field_getValue(field_header);
+  /* each header is retrieved once and handed down to the table updates */
+  struct packet_header* header = (struct packet_header*) packet_header_get(to, packet, HEADER_FIELD_PACKET);
+  struct hello_packet_header *hello_header;
+  struct sink_interest_packet_header *interest_header;
 
   array_t *up = get_class_bindings_up(to);
   int i = up->size;
@@ -503,7 +665,8 @@ void rx(call_t *to, call_t *from, packet_t *packet) {
   switch(header->packet_type) {
   case HELLO_PACKET:       
      /* update local neighbor table */
-    oracenet_neighbor_update(to, packet);
+    hello_header = (struct hello_packet_header*) packet_header_get(to, packet, HEADER_FIELD_HELLO);
+    oracenet_neighbor_update(to, packet, header, hello_header);
     packet_dealloc(packet);
 
     break;
@@ -511,13 +674,17 @@ void rx(call_t *to, call_t *from, packet_t *packet) {
   case SINK_INTEREST_PACKET:
     /* update routing table of sensor nodes and schedule packet retransmission using a random backoff period */
     if (nodedata->node_type == SENSOR_NODE) {
-      route_update_from_interest(to, packet);
-      scheduler_add_callback(get_time() + get_random_double() * nodedata->sink_interest_propagation_backoff, to, from, sink_interest_propagation, (void *)(packet));
-	
-      /* Update the last sending time to optimize Hello brdcasts */
-      nodedata->last_tx_time = get_time(); 
+      /* the advert stands for a hello of its sender */
+      oracenet_neighbor_piggyback_update(to, packet, header, header->src);
       /* LQE parameters Calculations */
-      route_update_oracenet_prr_from_adv(to, packet, header->prevhop);
+      route_update_oracenet_prr_from_adv(to, header, header->prevhop);
+
+      /* update the routes towards each carried sink and schedule the rebroadcast of new Interests */
+      interest_header = (struct sink_interest_packet_header*) packet_header_get(to, packet, HEADER_FIELD_SINK_INTEREST);
+      sink_interest_receive(to, packet, header, interest_header, route_update_from_oracenet_interest);
+
+      /* send the data packets waiting for a route towards any sink */
+      route_pending_flush_oracenet(to, BROADCAST_ADDR);
     }
     /* sink and anchor will destroy received packet */
     else {
@@ -529,25 +696,20 @@ void rx(call_t *to, call_t *from, packet_t *packet) {
     
     prevhop = header->prevhop;
     /* Neighbor table update based on the data packet */
-    neighbor_update_from_oracenet_data_packet(to, packet, prevhop);
+    neighbor_update_from_oracenet_data_packet(to, packet, header);
 
     /* Check if the same data packet is allready received, if yes, packet is dropped */
-    if (nodedata->last_seq[header->src] >= header->seq){
+    if (route_duplicate_check(to, header->src, header->seq)) {
 		packet_dealloc(packet);
 		break;
 	  }
     
-    nodedata->last_seq[header->src] = header->seq;
-    
     /* check if data packet has arrived to destination and forwards to upper layers */
     
 
     header->hop++;
     
-    route_update_from_oracenet_data_packet(to, packet, prevhop);
-
-     /* LQE parameters Calculations */
-    nodedata->last_tx_time = get_time();
+    route_update_from_oracenet_data_packet(to, header, prevhop);
  
     if (header->dst == -1 || header->dst == to->object) {
 
@@ -577,11 +739,11 @@ void rx(call_t *to, call_t *from, packet_t *packet) {
     /* forward the data packet to the closest/particular sink */
 
  /* LQE parameters Update are done inside "route_forward_oracenet_data_packet" fct */
-      route_forward_oracenet_data_packet(to, from, packet);
-
 #ifdef ROUTING_LOG_DATA_FORWARDING  
-  printf("[ROUTING_LOG_DATA_FORWARDING] node %d received a data packet from source node %d => forwarding packet towards DST %d through nexthop %d\n", to->object, header->src, header->dst, header->nexthop);
+  printf("[ROUTING_LOG_DATA_FORWARDING] node %d received a data packet from source node %d => forwarding packet towards DST %d\n", to->object, header->src, header->dst);
 #endif
+      /* the packet may be held and merged into an aggregate: do not use it afterwards */
+      route_aggregate_data_packet(to, from, packet, header->dst, route_forward_oracenet_data_packet);
 	//route_show_oracenet(to); 
     }
 
@@ -34,6 +34,39 @@
 #define STATUS_ON 1
 #define STATUS_OFF 0
 
+/* Macro definitions for the OLSRv2 data forwarding modes.*/
+#define OLSR_SOURCE_ROUTING 0
+#define OLSR_HOP_BY_HOP 1
+
+/* Macro definitions for the RREQ rebroadcast suppression modes.*/
+#define RREQ_SUPPRESSION_OFF 0
+#define RREQ_SUPPRESSION_COUNTER 1
+#define RREQ_SUPPRESSION_DISTANCE 2
+
+/* Number of extra hops waited for by an expanding ring search attempt (TIMEOUT_BUFFER of RFC 3561).*/
+#define RREQ_TIMEOUT_BUFFER 2
+
+/* Macro definitions for the link quality estimators (ORACENET).*/
+#define LQE_PRR 0
+#define LQE_EWMA 1
+#define LQE_WMEWMA 2
+
+/* Macro definitions for the interest reinforcements (Directed Diffusion).*/
+#define REINFORCEMENT_NEGATIVE -1
+#define REINFORCEMENT_NONE 0
+#define REINFORCEMENT_POSITIVE 1
+
+/* Macro definitions for the in-network data aggregation functions (Directed Diffusion, ORACENET).*/
+#define AGGREGATION_OFF 0
+#define AGGREGATION_CONCAT 1
+#define AGGREGATION_MIN 2
+#define AGGREGATION_MAX 3
+#define AGGREGATION_AVG 4
+#define AGGREGATION_COUNT 5
+
+/* Maximal number of Interests carried by a single Interest packet.*/
+#define MAX_AGGREGATED_INTERESTS 8
+
 /* Macro definitions for packet types.*/
 #define HELLO_PACKET               0
 #define SINK_INTEREST_PACKET       1
@@ -44,12 +77,48 @@
 #define RE_PACKET		   6 		// Route Explore Packet: Added for ORACE-NET Protocol
 #define ADVERT_PACKET		   7 		// Route Explore Packet: Added for ORACE-NET Protocol
 
+/* Handles of the packet header fields, resolved to field names at init() (see packet_header_fields_init).*/
+#define HEADER_FIELD_PACKET                   0
+#define HEADER_FIELD_HELLO                    1
+#define HEADER_FIELD_TC                       2
+#define HEADER_FIELD_SINK_INTEREST            3
+#define HEADER_FIELD_SINK_INTEREST_AGGREGATE  4
+#define HEADER_FIELD_RREQ                     5
+#define HEADER_FIELD_RREP                     6
+#define HEADER_FIELD_DATA_AGGREGATE           7
+#define HEADER_FIELDS_NBR                     8
+
 /* Global Macro definitions.*/
 
 #define MAX_NEIGHBORS_SIZE         1000
+#define MAX_PRECURSORS_SIZE        16
+#define MAX_PENDING_SIZE           32
+#define MAX_GRADIENTS_SIZE         8
+#define MAX_DATA_TYPES             16
+#define MAX_AGGREGATED_DATA        16
+#define MAX_OVERHEARD_SIZE         64
+#define DUPLICATE_WINDOW_SIZE      64
+#define MAX_ORACENET_NEXTHOPS      3
+
+/* Network header destination of a data packet waiting for a route.*/
+#define PENDING_ADDR               -2
 
 /* UPDATED by Dhafer 01-05-2015 */
 
+/** \brief A structure for a packet overheard and filtered by the MAC layer, kept until the next cross-layer batch (ORACENET)
+ *  \struct overheard_record
+ **/
+struct overheard_record {
+  int sender;             	/*!< Last sender of the overheard packet */
+  int type;               	/*!< Node type of the sender */
+  int hello_seq;          	/*!< Beacon number piggybacked on the packet (-1 if none or unknown) */
+  int hop_to_sink;        	/*!< Number of hops of the sender towards the sink (-1 if unknown) */
+  double sink_prr;        	/*!< E2E PRR of the sender towards the sink */
+  uint64_t hello_interval;	/*!< Hello interval of the sender (0 if unknown) */
+  double rxdbm;           	/*!< Received power of the overheard packet */
+  uint64_t time;          	/*!< Reception time of the overheard packet */
+};
+
 /* ************************************************** */
 /* ************************************************** */
 /** \brief A structure containing the GLOBAL node entity variables and parameters
@@ -67,6 +136,8 @@ struct classdata {
   int global_rx_control_packet;              	/*!< Defines the total number of received packets. */
   int global_tx_control_packet_bytes;    	/*!< Defines the total amount of transmitted packets (bytes). */
   int global_rx_control_packet_bytes;   	/*!< Defines the total amount of received packets (bytes). */
+  /* packet header access */
+  char *header_fields[HEADER_FIELDS_NBR];     	/*!< Defines the field name of each packet header, indexed by handle. */
 };
  
  
@@ -80,7 +151,23 @@ struct nodedata {
   position_t node_position;                   	/*!< Defines the node position. */
   void *neighbors;                            	/*!< Defines the local node neighbor table. */
   void *routing_table;                        	/*!< Defines the local node route table. */
+  void *route_index[MAX_NEIGHBORS_SIZE];	/*!< Defines the route table entries indexed by destination ID (AODV, OLSRv2). */
+  void *pending_table;                        	/*!< Defines the data packets waiting for a route, per destination. */
+  int pending_queue_size;                     	/*!< Defines the maximal number of waiting packets per destination. */
+  uint64_t pending_timeout;                   	/*!< Defines the maximal waiting time of a packet without route. */
   void *interest_table;                       	/*!< Defines the local node interest packet table. */
+  void *interest_pending;                     	/*!< Defines the received Interests waiting for their rebroadcast. */
+  int interest_flush_scheduled;               	/*!< Set when the rebroadcast of the pending Interests is scheduled. */
+  int interest_aggregation_size;              	/*!< Defines the maximal number of Interests per rebroadcast packet. */
+  void *gradient_table;                       	/*!< Defines the gradients per (sink, data type) (Directed Diffusion). */
+  void *gradient_index[MAX_NEIGHBORS_SIZE];   	/*!< Defines the gradient entries of each sink, indexed by sink ID. */
+  uint64_t gradient_timeout;                  	/*!< Defines the lifetime of a gradient which is not refreshed. */
+  uint64_t reinforcement_period;              	/*!< Defines the period between two positive reinforcements of a sink. */
+  void *aggregation_table;                    	/*!< Defines the data packets held for aggregation, per (destination, data type). */
+  void *duplicate_table;                      	/*!< Defines the data packets already received, per source (Directed Diffusion, ORACENET). */
+  int aggregation_function[MAX_DATA_TYPES];   	/*!< Defines the aggregation function of each data type. */
+  uint64_t aggregation_hold;                  	/*!< Defines the holding time of the first packet of an aggregate. */
+  int aggregation_max_size;                   	/*!< Defines the maximal number of packets merged in an aggregate. */
 
   int MPR_set[MAX_NEIGHBORS_SIZE];		/*! MPRs nodes : Updated by Dhafer BEN ARBIA 2-5-2015 */
   int olsr_path[MAX_NEIGHBORS_SIZE]; 		/*< Whole route from src to dst >*/
@@ -93,8 +180,11 @@ struct nodedata {
   int tc_1st_hop_neighbors[MAX_NEIGHBORS_SIZE];
 
   int topology_matrix[MAX_NEIGHBORS_SIZE][MAX_NEIGHBORS_SIZE];  /* Connectivity Matrix */
+  int olsr_topology_changed;			/* Set when the connectivity matrix changed since the last SPF run */
+  int olsr_forwarding_mode;			/* Data forwarding mode: OLSR_SOURCE_ROUTING or OLSR_HOP_BY_HOP */
 
   void *rreq_table;                           	/*!< Defines the local node RREQ packet table. */
+  void *rreq_backoff_table;                   	/*!< Defines the RREQ packets waiting for their rebroadcast backoff. */
   void *rrep_table;                           	/*!< Defines the local node RREP packet table. */
   int overhead;                               	/*!< Defines the total size of the lower-layer protocol headers. */
   int sink_id;                                	/*!< Defines the ID the sink (necessary for AODV). */
@@ -102,6 +192,7 @@ struct nodedata {
   /* Parameters related to the real sizes of packets  */
   int hello_packet_real_size;              	/*!< Defines the real size of a hello packet (in bytes). */
   int interest_packet_real_size;          	/*!< Defines the real size of an interest packet (in bytes). */
+  int interest_entry_real_size;          	/*!< Defines the real size of each Interest aggregated behind the first one (in bytes). */
   int rreq_packet_real_size;               	/*!< Defines the real size of a RREQ packet (in bytes). */
   int rrep_packet_real_size;               	/*!< Defines the real size of a RREP packet (in bytes). */
   
@@ -112,6 +203,16 @@ struct nodedata {
   uint64_t hello_period;                       	/*!< Defines the periodicity of the hello packet transmission. */
   uint64_t hello_timeout;                     	/*!< Defines the timeout related to the manegement of the local neighbors table. */
   uint64_t previous_hello_slot_time;
+  /* Trickle timer of the HELLO protocol (RFC 6206), enabled when hello_imax > 0 */
+  uint64_t hello_imin;                          /*!< Defines the minimal hello interval (hello_period if 0). */
+  int hello_imax;                               /*!< Defines the maximal number of doublings of the minimal hello interval. */
+  int hello_k;                                  /*!< Defines the redundancy constant: hello suppressed after k consistent hellos (0 for never). */
+  uint64_t hello_interval;                      /*!< Current hello interval. */
+  uint64_t hello_interval_start;                /*!< Start time of the current hello interval. */
+  int hello_counter;                            /*!< Number of consistent hellos received in the current interval. */
+  int hello_suppressed;                         /*!< Set when the hello of the previous interval was suppressed. */
+  long hello_epoch;                             /*!< Identifies the pending hello callback, the others being outdated by a reset. */
+  int (*hello_callback)(call_t *, call_t *, void *); /*!< Hello callback of the routing protocol. */
 /* UPDATED By Dhafer BEN ARBIA 2-5-2015 */ 
 /* Parameters of the TC packet  */
   int tc_packet_real_size;
@@ -150,10 +251,16 @@ struct nodedata {
   int nbr_received_hello[MAX_NEIGHBORS_SIZE]; 		/* nbr of received hello packet / node */
   float prr[MAX_NEIGHBORS_SIZE];              		/* PRR estimate -> Link quality */
   uint64_t last_tx_time; 				/* Needed to optimize Hello Bcast when a Data_Tx or ADV_Tx is done in that period*/
-  int delayed_hello;					/* Used to calculate LQE parameters */
-  int expected_hello;					/* LQE for ORACENET Based on Time */
+  int delayed_hello;					/* Number of hellos suppressed thanks to a piggybacking data or advert packet */
+  uint64_t hello_window_start;				/* Time of the last hello decision: one beacon (hello or piggybacked) is due per window */
+  int hello_seq;					/* Beacon number, shared by the hellos and the piggybacked hellos */
+  int hello_piggyback_unicast;				/* Whether unicast data packets stand for the hello (the MAC layer reports the overheard frames) */
   int data_seq;
-  int last_seq[MAX_NEIGHBORS_SIZE];
+  double load_split_threshold;				/* Relative E2E PRR gap under which the data packets are split over the ranked nexthops (0 to disable) */
+  struct overheard_record overheard[MAX_OVERHEARD_SIZE];	/* Packets overheard by the MAC layer, applied to the neighbor table in batches */
+  int overheard_nbr;					/* Number of buffered overheard packets */
+  uint64_t overheard_period;				/* Period of the cross-layer batches (0 to apply every overheard packet at once) */
+  int overheard_scheduled;				/* Whether a cross-layer batch is scheduled */
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
   /* Parameters of the AODV protocol  */
@@ -166,16 +273,28 @@ struct nodedata {
   uint64_t rrep_propagation_backoff;           	/*!< Defines the probability of the RREP dissemination protocol. */
   int rreq_seq;                                	/*!< Defines the sequence number of RREQ packets. */
   int rreq_ttl;                                	/*!< Defines the TTL number of RREQ packets. */
+  int rreq_ttl_start;                          	/*!< Defines the TTL of the first expanding ring search (0 to disable the search). */
+  int rreq_ttl_increment;                      	/*!< Defines the TTL increment between two expanding ring searches. */
+  int rreq_ttl_threshold;                      	/*!< Defines the TTL above which the RREQ is sent with rreq_ttl. */
+  int rreq_suppression_mode;                   	/*!< Defines the RREQ rebroadcast suppression mode (off, counter or distance based). */
+  int rreq_counter_threshold;                  	/*!< Defines the number of heard copies cancelling a RREQ rebroadcast. */
+  double rreq_distance_threshold;              	/*!< Defines the distance to the closest sender under which a RREQ rebroadcast is cancelled. */
   int rrep_seq;                                	/*!< Defines the sequence number of RREP packets. */
   int rreq_data_type;                          	/*!< Defines the data types requested by RREQ packets. */
   uint64_t previous_rreq_slot_time;
+  uint64_t route_lifetime;                     	/*!< Defines the lifetime of an unused route (0 for no expiry). */
+  uint64_t rreq_discovery_timeout;             	/*!< Defines the waiting time of the first route discovery attempt. */
+  int rreq_retries;                            	/*!< Defines the maximal number of route discovery retries. */
+  int local_repair_status;                     	/*!< Defines the status of the local route repair on nexthop loss. */
   
   /* Parameters of the link quality estimation (LQE) */
   int rssi_smoothing1_nbr;                     	/*!< Defines the nbr of required measurements to smooth RSSI values (1). */
   int rssi_smoothing2_nbr;                     	/*!< Defines the nbr of required measurements to smooth RSSI values (2). */
-  int rssi_smoothing_factor;                   	/*!< Defines the factor for the smoothing of RSSI measurements. */
-  int lqe_w;                                   	/*!< Defines the history size of LQE algorithm. */
+  double rssi_smoothing_factor;                	/*!< Defines the factor for the smoothing of RSSI measurements. */
+  int lqe_w;                                   	/*!< Defines the history size of LQE algorithm (beacons, at most 64). */
   double lqe_threshold;                        	/*!< Defines the threshold for selection of the most reliable radio links. */
+  int lqe_estimator;                           	/*!< Defines the link quality estimator: windowed PRR, EWMA or WMEWMA (ORACENET). */
+  double lqe_alpha;                            	/*!< Defines the smoothing factor of the EWMA and WMEWMA estimators (ORACENET). */
   
   /* Local variable for stats */
   int rx_nbr[5];    				/*!< Defines the number of received packets. */
@@ -207,6 +326,11 @@ struct neighbor {
   int neighbors_2hop[MAX_NEIGHBORS_SIZE]; /* Second hop neighbors */
   int neighbors_2hop_nbr; 		  /* Number of second hop neighbors */
   double prr;			/* LQE for ORACENET */
+  uint64_t lqe_bitmap;		/* Received beacons among the last lqe_w ones, bit 0 is the last beacon (ORACENET) */
+  int lqe_slots;		/* Beacons accounted in the current LQE window (ORACENET) */
+  int lqe_rx;			/* Beacons received in the current LQE window (ORACENET) */
+  double sink_prr;		/* E2E PRR towards the sink advertised by the neighbor (ORACENET) */
+  uint64_t hello_interval;	/*!<  Hello interval advertised by the neighbor (0 if unknown) */
 
 };
 
@@ -240,6 +364,9 @@ struct route_aodv {
   uint64_t time;         /*!< Time related to the last route update */
   int seq_rreq;          /*!< Sequence number related to the last route update */
   int seq_rrep;          /*!< Sequence number related to the last route update */
+  uint64_t lifetime;     /*!< Expiry time of the route (0 for no expiry) */
+  int precursors[MAX_PRECURSORS_SIZE]; /*!< Upstream neighbors using this route */
+  int precursors_nbr;    /*!< Number of precursors */
 };
 
 /** \brief A structure for the route table management (ORACENET)
@@ -271,6 +398,69 @@ struct route_olsrv2 {
 };
 
 
+/** \brief A structure for the sliding window of the data packets already received from a given source (Directed Diffusion, ORACENET)
+ *  \struct duplicate_window
+ **/
+struct duplicate_window {
+  int src;                                 /*!< Source node ID */
+  int last_seq;                            /*!< Highest sequence number received */
+  uint64_t bitmap;                         /*!< Received sequence numbers, bit i is last_seq - i */
+};
+
+/** \brief A structure for the data packets waiting for a route towards a given destination (AODV, ORACENET)
+ *  \struct pending_destination
+ **/
+struct pending_destination {
+  int dst;                                 /*!< Final destination of the waiting packets */
+  packet_t *packets[MAX_PENDING_SIZE];     /*!< Ring buffer of the waiting data packets */
+  uint64_t times[MAX_PENDING_SIZE];        /*!< Buffering time of each waiting packet */
+  int first;                               /*!< Index of the oldest waiting packet */
+  int size;                                /*!< Number of waiting packets */
+  int rreq_nbr;                            /*!< Number of network-wide route discovery attempts */
+  int rreq_ttl;                            /*!< TTL of the current route discovery attempt */
+  uint64_t rreq_timeout;                   /*!< Current route discovery timeout (doubled at each attempt) */
+  uint64_t rreq_deadline;                  /*!< End of the route discovery in progress (0 if none) */
+};
+
+
+/** \brief A structure for the data packets held for aggregation towards a given destination (Directed Diffusion, ORACENET)
+ *  \struct data_aggregation
+ **/
+struct data_aggregation {
+  int dst;                                 /*!< Destination (sink) of the aggregate */
+  int data_type;                           /*!< Data type of the aggregate */
+  packet_t *packet;                        /*!< Aggregate being built (NULL if none) */
+  uint64_t deadline;                       /*!< Forwarding time of the aggregate */
+  void (*forward)(call_t *, call_t *, packet_t *);  /*!< Protocol forwarding function */
+};
+
+
+/** \brief A structure for a gradient towards a neighbor (Directed Diffusion)
+ *  \struct gradient
+ **/
+struct gradient {
+  int neighbor;                 /*!< Neighbor node ID (nexthop towards the sink) */
+  int hop_to_sink;              /*!< Number of hops to the sink through this neighbor */
+  uint64_t expiry;              /*!< End of validity of the gradient */
+  uint64_t reinforced_until;    /*!< End of the positive reinforcement of the gradient */
+};
+
+/** \brief A structure for the gradients related to a given (sink, data type) (Directed Diffusion)
+ *  \struct gradient_entry
+ **/
+struct gradient_entry {
+  int sink_id;                                  /*!< Sink node ID */
+  int data_type;                                /*!< Requested data type */
+  struct gradient gradients[MAX_GRADIENTS_SIZE];  /*!< Gradients towards the neighbors */
+  int gradients_nbr;                            /*!< Number of gradients */
+  int best;                                     /*!< Index of the selected gradient (-1 if none) */
+  uint64_t next_expiry;                         /*!< Next time the selected gradient may change by expiry */
+  int upstream;                                 /*!< Last neighbor which sent data (reinforced neighbor at the sink) */
+  int reinforcement_seq;                        /*!< Sequence number of the last reinforcement */
+  uint64_t reinforcement_time;                  /*!< Time of the last positive reinforcement sent by the sink */
+  struct gradient_entry *next;                  /*!< Next entry of the same sink */
+};
+
 /** \brief A structure for the interest propagation management (Directed Diffusion)
  *  \struct interest
  **/
@@ -292,6 +482,18 @@ struct rreq {
   uint64_t time;   /*!<  Time related to the last RREQ update */
 };
 
+/** \brief A structure for the RREQ packets heard during the rebroadcast backoff (AODV)
+ *  \struct rreq_backoff
+ **/
+struct rreq_backoff {
+  int src;             /*!<  src node ID */
+  int dst;             /*!<  dst node ID */
+  int data_type;   /*!<   data type*/
+  int seq;            /*!<  Sequence number of the RREQ */
+  int copies;       /*!<  Number of copies heard since the first reception */
+  double distance;  /*!<  Distance to the closest sender of a copy */
+};
+
 /** \brief A structure for the RREP propagation management (AODV)
  *  \struct rrep
  **/
@@ -318,6 +520,7 @@ struct packet_header {
   nodeid_t dst;                     	/*!<  destination node ID */
   int type;                            	/*!<  source node type */
   int packet_type;                	/*!<  packet type (hello, interest, RREQ, RREP, DATA) */
+  int data_type;                  	/*!<  data type of a data packet (Directed Diffusion) */
   int olsr_path[MAX_NEIGHBORS_SIZE];    /*< Whole route from src to dst >*/
   int olsr_path_index;
   int hop;
@@ -328,6 +531,11 @@ struct packet_header {
   double retx_nbr;			/*!< Nbr of Retransmissions */
   double E2E_PRR;			/*!< End to End Packet Reception Rate */
   double E2E_ReTx;			/*!< End to End Number of Retranmissions */
+/* Hello fields piggybacked on data and advert packets (ORACENET) */
+  int hello_seq;			/*!< Beacon number of the last sender, -1 if the packet does not stand for a hello */
+  int hello_hop_to_sink;		/*!< Number of hops of the last sender towards the sink */
+  double hello_prr;			/*!< E2E PRR of the last sender towards the sink */
+  uint64_t hello_interval;		/*!< Hello interval of the last sender */
 };
 
 /** \brief A structure defining the header of hello packets
@@ -340,6 +548,7 @@ struct hello_packet_header {
   int first_hop_neighbors[MAX_NEIGHBORS_SIZE]; 		/*!< List of boradcasted 1 hops neighbors : UDATED By Dhafer BEN ARBIA 3-5-2015 */
   int link_type;		  /*!< Neighbor link type : Uni-directional, Bi-directional or MPR : UDATED By Dhafer BEN ARBIA 3-5-2015*/
   int hop;
+  uint64_t interval;			/*!< Hello interval of the sender, within which its next hello is sent */
 /* LQE Header fields */
   int retx; 				/* retreansmission number */
   int prr;				/* PRR: */
@@ -369,9 +578,41 @@ struct sink_interest_packet_header {
   int ttl_max;            /*!< Initial Time-To-Live to limit packet propagation */
   int data_type;         /*!< Requested Data Type (e.g. RSSI measurements, temperature values, etc.) */
   uint64_t time;         /*!< TX time instant */
+  int reinforcement;     /*!< Exploratory interest or positive/negative reinforcement */
   position_t position;  /*!< Neighbor position (if known) */
 };
 
+/** \brief A structure defining the Interests aggregated behind the first one in an interest packet
+ *  \struct sink_interest_aggregate_header
+ **/
+struct sink_interest_aggregate_header {
+  int interests_nbr;                                                              /*!< Number of aggregated Interests */
+  struct sink_interest_packet_header interests[MAX_AGGREGATED_INTERESTS - 1];    /*!< Aggregated Interests */
+};
+
+/** \brief A structure for the Interests waiting for their rebroadcast (Directed Diffusion, ORACENET)
+ *  \struct pending_interest
+ **/
+struct pending_interest {
+  struct packet_header header;                  /*!< Packet header of the retained copy */
+  struct sink_interest_packet_header interest;  /*!< Retained copy of the Interest */
+};
+
+/** \brief A structure defining the header of aggregated data packets (Directed Diffusion, ORACENET)
+ *  \struct data_aggregate_header
+ **/
+struct data_aggregate_header {
+  int function;                        /*!< Aggregation function */
+  int count;                           /*!< Number of merged readings */
+  double value;                        /*!< Aggregated value (min, max, avg or count) */
+  double min;                          /*!< Minimal merged reading */
+  double max;                          /*!< Maximal merged reading */
+  double sum;                          /*!< Sum of the merged readings */
+  int sources_nbr;                     /*!< Number of recorded sources */
+  int sources[MAX_AGGREGATED_DATA];    /*!< Source of each merged packet */
+  int seqs[MAX_AGGREGATED_DATA];       /*!< Sequence number of each merged packet */
+};
+
 /** \brief A structure defining the header of RREQ packets
  *  \struct rreq_packet_header
  **/
@@ -16,6 +16,174 @@ typedef int bool;
 #define true 1
 #define false 0
 
+/** \brief Function to decide whether a periodic hello packet has to be built and sent.
+ *  \fn int neighbor_hello_should_send(call_t *to)
+ *  \param c is a pointer to the called entity
+ *  \return 1 if the hello packet has to be sent, 0 otherwise
+ **/
+int neighbor_hello_should_send(call_t *to) {
+  struct nodedata *nodedata = get_node_private_data(to);
+
+  /* Trickle suppression: enough consistent hellos were heard in the current interval.
+   * Never twice in a row, so that the neighbors do not time the node out */
+  if (nodedata->hello_imax > 0 && nodedata->hello_k > 0 && nodedata->hello_counter >= nodedata->hello_k && !nodedata->hello_suppressed) {
+    nodedata->hello_suppressed = 1;
+    return 0;
+  }
+  nodedata->hello_suppressed = 0;
+
+  return (nodedata->hello_status == STATUS_ON);
+}
+
+/** \brief Function to start the hello protocol, either periodic or driven by a Trickle timer (when hello_imax > 0).
+ *  \fn void neighbor_hello_start(call_t *to, call_t *from, int (*callback)(call_t *, call_t *, void *))
+ *  \param c is a pointer to the called entity
+ *  \param from is a pointer to the calling entity
+ *  \param callback is the hello callback of the routing protocol
+ **/
+void neighbor_hello_start(call_t *to, call_t *from, int (*callback)(call_t *, call_t *, void *)) {
+  struct nodedata *nodedata = get_node_private_data(to);
+  uint64_t hello_slot_time = get_time() + nodedata->hello_start;
+
+  nodedata->hello_callback = callback;
+  nodedata->hello_counter = 0;
+  if (nodedata->hello_imin == 0) {
+    nodedata->hello_imin = nodedata->hello_period;
+  }
+
+  if (nodedata->hello_imax > 0) {
+    /* first Trickle interval, hello sent in its second half */
+    nodedata->hello_interval = nodedata->hello_imin;
+    nodedata->hello_interval_start = hello_slot_time;
+    scheduler_add_callback(hello_slot_time + (nodedata->hello_interval + get_random_double() * nodedata->hello_interval) / 2, to, from, callback, (void *) nodedata->hello_epoch);
+  }
+  else {
+    nodedata->previous_hello_slot_time = hello_slot_time;
+    scheduler_add_callback(hello_slot_time + get_random_double() * nodedata->hello_period, to, from, callback, NULL);
+  }
+}
+
+/** \brief Function to schedule the next hello packet transmission, at the next slot or in the next (doubled) Trickle interval.
+ *  \fn void neighbor_hello_schedule(call_t *to, call_t *from, int (*callback)(call_t *, call_t *, void *))
+ *  \param c is a pointer to the called entity
+ *  \param from is a pointer to the calling entity
+ *  \param callback is the hello callback of the routing protocol
+ **/
+void neighbor_hello_schedule(call_t *to, call_t *from, int (*callback)(call_t *, call_t *, void *)) {
+  struct nodedata *nodedata = get_node_private_data(to);
+
+  if (nodedata->hello_imax > 0) {
+    nodedata->hello_interval_start += nodedata->hello_interval;
+    if (nodedata->hello_interval < (nodedata->hello_imin << nodedata->hello_imax)) {
+      nodedata->hello_interval *= 2;
+    }
+    nodedata->hello_counter = 0;
+    scheduler_add_callback(nodedata->hello_interval_start + (nodedata->hello_interval + get_random_double() * nodedata->hello_interval) / 2, to, from, callback, (void *) nodedata->hello_epoch);
+  }
+  else {
+    nodedata->previous_hello_slot_time += nodedata->hello_period;
+    scheduler_add_callback(nodedata->previous_hello_slot_time + get_random_double() * nodedata->hello_period, to, from, callback, NULL);
+  }
+}
+
+/** \brief Function to check that a hello callback has not been outdated by a reset of the Trickle timer.
+ *  \fn int neighbor_hello_is_pending(call_t *to, void *args)
+ *  \param c is a pointer to the called entity
+ *  \param args is the argument the hello callback was scheduled with
+ *  \return 1 if the callback is still valid, 0 otherwise
+ **/
+int neighbor_hello_is_pending(call_t *to, void *args) {
+  struct nodedata *nodedata = get_node_private_data(to);
+
+  return (nodedata->hello_imax == 0 || (long) args == nodedata->hello_epoch);
+}
+
+/** \brief Function to count a hello packet bringing no topology change (Trickle consistent transmission).
+ *  \fn void neighbor_hello_consistent(call_t *to)
+ *  \param c is a pointer to the called entity
+ **/
+void neighbor_hello_consistent(call_t *to) {
+  struct nodedata *nodedata = get_node_private_data(to);
+
+  if (nodedata->hello_imax > 0 && get_time() >= nodedata->hello_interval_start) {
+    nodedata->hello_counter++;
+  }
+}
+
+/** \brief Function to reset the Trickle timer to its minimal interval on a topology change (new or lost neighbor).
+ *  \fn void neighbor_hello_reset(call_t *to)
+ *  \param c is a pointer to the called entity
+ **/
+void neighbor_hello_reset(call_t *to) {
+  struct nodedata *nodedata = get_node_private_data(to);
+  call_t from = {-1, -1};
+
+  if (nodedata->hello_imax == 0 || nodedata->hello_callback == NULL || nodedata->hello_interval == nodedata->hello_imin) {
+    return;
+  }
+  if (nodedata->hello_status != STATUS_ON || (nodedata->hello_nbr <= 0 && nodedata->hello_nbr != -1)) {
+    return;
+  }
+
+  /* outdate the pending callback and start a new interval */
+  nodedata->hello_epoch++;
+  nodedata->hello_interval = nodedata->hello_imin;
+  nodedata->hello_interval_start = get_time();
+  nodedata->hello_counter = 0;
+  nodedata->hello_suppressed = 0;
+  scheduler_add_callback(get_time() + (nodedata->hello_interval + get_random_double() * nodedata->hello_interval) / 2, to, &from, nodedata->hello_callback, (void *) nodedata->hello_epoch);
+
+#ifdef ROUTING_LOG_HELLO
+  printf("[ROUTING_LOG_HELLO] Time %lfs node %d has reset its hello interval \n", get_time()*0.000000001, to->object);
+#endif
+}
+
+/** \brief Function to get the hello interval advertised to the neighbors: the hello period, or the Trickle interval of the next hello.
+ *  \fn uint64_t neighbor_hello_interval(call_t *to)
+ *  \param c is a pointer to the called entity
+ *  \return the advertised hello interval
+ **/
+uint64_t neighbor_hello_interval(call_t *to) {
+  struct nodedata *nodedata = get_node_private_data(to);
+
+  if (nodedata->hello_imax == 0) {
+    return nodedata->hello_period;
+  }
+
+  /* the next hello is sent in the next interval, doubled up to the maximal one */
+  return (nodedata->hello_interval < (nodedata->hello_imin << nodedata->hello_imax)) ? 2*nodedata->hello_interval : nodedata->hello_interval;
+}
+
+/** \brief Function to get the timeout of a neighbor entry, scaled with the hello interval advertised by the neighbor.
+ *  \fn uint64_t neighbor_hello_timeout(call_t *to, struct neighbor *neighbor)
+ *  \param c is a pointer to the called entity
+ *  \param neighbor is a pointer to the neighbor entry
+ *  \return the neighbor entry timeout
+ **/
+uint64_t neighbor_hello_timeout(call_t *to, struct neighbor *neighbor) {
+  struct nodedata *nodedata = get_node_private_data(to);
+
+  /* the neighbor may miss as many of its advertised intervals as the hello timeout holds hello periods */
+  if (neighbor->hello_interval > 0 && nodedata->hello_period > 0) {
+    return neighbor->hello_interval * ((double) nodedata->hello_timeout / nodedata->hello_period);
+  }
+
+  /* unknown interval: the neighbor may be at the maximal Trickle interval */
+  return nodedata->hello_timeout << nodedata->hello_imax;
+}
+
+/** \brief Function to decide whether a periodic TC packet has to be built and sent (OLSRv2).
+ *  \fn int tc_should_send(call_t *to)
+ *  \param c is a pointer to the called entity
+ *  \return 1 if the TC packet has to be sent, 0 otherwise
+ **/
+int tc_should_send(call_t *to) {
+  struct nodedata *nodedata = get_node_private_data(to);
+
+  /* a node without neighbors has no link to advertise */
+  return (nodedata->tc_status == STATUS_ON && list_getsize(nodedata->neighbors) > 0);
+}
+
 /** \brief Callback function for the periodic hello packet transmission in Directed Diffusion (to be used with the scheduler_add_callback function).
  *  \fn int neighbor_discovery_callback_directed_diffusion(call_t *to, void *args)
  *  \param c is a pointer to the called entity
@@ -31,63 +199,72 @@ int neighbor_discovery_callback_directed_diffusion(call_t *to, call_t *from, voi
   call_t from0 = {to->class, to->object};
   destination_t destination = {BROADCAST_ADDR, {-1, -1, -1}};
   
-  /* create a hello packet */
-  packet_t *packet = packet_create(to, nodedata->overhead + sizeof(struct packet_header)+sizeof(struct hello_packet_header), nodedata->hello_packet_real_size*8);
+  /* outdated by a reset of the Trickle timer */
+  if (!neighbor_hello_is_pending(to, args)) {
+    return 0;
+  }
+
+  /* build the hello packet only if it has to be sent */
+  if (neighbor_hello_should_send(to)) {
+    /* create a hello packet */
+    packet_t *packet = packet_create(to, nodedata->overhead + sizeof(struct packet_header)+sizeof(struct hello_packet_header), nodedata->hello_packet_real_size*8);
   
-  /* extract the network and hello headers */
-  struct packet_header *header = malloc(sizeof(struct packet_header));
-  field_t *field_packet_header = field_create(INT, sizeof(struct packet_header), header);
-  packet_add_field(packet, "packet_header", field_packet_header);
+    /* extract the network and hello headers */
+    struct packet_header *header = malloc(sizeof(struct packet_header));
+    field_t *field_packet_header = field_create(INT, sizeof(struct packet_header), header);
+    packet_add_field(packet, "packet_header", field_packet_header);
   
-  struct hello_packet_header *hello_header = malloc(sizeof(struct hello_packet_header));
-  field_t *field_hello_header = field_create(INT, sizeof(struct hello_packet_header), hello_header);
-  packet_add_field(packet, "hello_packet_header", field_hello_header);
+    struct hello_packet_header *hello_header = malloc(sizeof(struct hello_packet_header));
+    field_t *field_hello_header = field_create(INT, sizeof(struct hello_packet_header), hello_header);
+    packet_add_field(packet, "hello_packet_header", field_hello_header);
   
-  /* compute the nexthop node ID for the specified destination */
-  struct route *route = route_get_nexthop(to, -1);
+    /* compute the nexthop node ID for the specified destination */
+    struct route *route = route_get_nexthop(to, -1);
 
-  /* set mac header */
-  if (SET_HEADER(&to0, to, packet, &destination) == -1) {
-    packet_dealloc(packet);
-    return -1;
-  }
+    /* set mac header */
+    if (SET_HEADER(&to0, to, packet, &destination) == -1) {
+      packet_dealloc(packet);
+      return -1;
+    }
   
-  /* set basic packet header */
-  header->src = to->object;
-  header->dst = BROADCAST_ADDR;
-  header->type = nodedata->node_type;
-  header->packet_type = HELLO_PACKET;
+    /* set basic packet header */
+    header->src = to->object;
+    header->dst = BROADCAST_ADDR;
+    header->type = nodedata->node_type;
+    header->packet_type = HELLO_PACKET;
   
-  /* set hello packet header */
-  if (nodedata->node_type == SINK_NODE) {
-    hello_header->sink_id = to->object;
-    hello_header->hop_to_sink = 0;  
-  }
-  else if (route != NULL) {
-    hello_header->sink_id = route->sink_id;
-    hello_header->hop_to_sink = route->hop_to_sink;
-  }
-  else  {
-    hello_header->sink_id = -1;
-    hello_header->hop_to_sink = -1;
-  }
-  hello_header->position.x = get_node_position(to->object)->x;
-  hello_header->position.y = get_node_position(to->object)->y;
-  hello_header->position.z = get_node_position(to->object)->z;
+    /* set hello packet header */
+    if (nodedata->node_type == SINK_NODE) {
+      hello_header->sink_id = to->object;
+      hello_header->hop_to_sink = 0;  
+    }
+    else if (route != NULL) {
+      hello_header->sink_id = route->sink_id;
+      hello_header->hop_to_sink = route->hop_to_sink;
+    }
+    else  {
+      hello_header->sink_id = -1;
+      hello_header->hop_to_sink = -1;
+    }
+    hello_header->position.x = get_node_position(to->object)->x;
+    hello_header->position.y = get_node_position(to->object)->y;
+    hello_header->position.z = get_node_position(to->object)->z;
+    hello_header->interval = neighbor_hello_interval(to);
   
-  /* send / push hello packet to the immediately lower-layer simulation module (e.g. MAC) */
-  TX(&to0, &from0, packet);
+    /* send / push hello packet to the immediately lower-layer simulation module (e.g. MAC) */
+    TX(&to0, &from0, packet);
 
-  /* update local stats */
-  nodedata->tx_nbr[header->packet_type]++;
+    /* update local stats */
+    nodedata->tx_nbr[header->packet_type]++;
   
-  /* update global stats */
-  classdata->current_tx_control_packet++;
-  classdata->current_tx_control_packet_bytes += (packet->real_size/8);
+    /* update global stats */
+    classdata->current_tx_control_packet++;
+    classdata->current_tx_control_packet_bytes += (packet->real_size/8);
 
 #ifdef ROUTING_LOG_HELLO
-  printf("[ROUTING_LOG_HELLO] Time %lfs node %d has sent a hello packet (%d %d) \n", get_time()*0.000000001, to->object, hello_header->sink_id, hello_header->hop_to_sink);
+    printf("[ROUTING_LOG_HELLO] Time %lfs node %d has sent a hello packet (%d %d) \n", get_time()*0.000000001, to->object, hello_header->sink_id, hello_header->hop_to_sink);
 #endif
+  }
 
   /* update nbr of transmitted hello packets */
   if (nodedata->hello_nbr > 0) {
@@ -96,8 +273,7 @@ int neighbor_discovery_callback_directed_diffusion(call_t *to, call_t *from, voi
   
   /* schedules next hello packet transmission */
   if (nodedata->hello_nbr > 0 || nodedata->hello_nbr == -1) {
-    nodedata->previous_hello_slot_time += nodedata->hello_period;
-    scheduler_add_callback(nodedata->previous_hello_slot_time + get_random_double() * nodedata->hello_period, to, from,neighbor_discovery_callback_directed_diffusion, NULL);
+    neighbor_hello_schedule(to, from, neighbor_discovery_callback_directed_diffusion);
   }
   return 0;
 }
@@ -119,56 +295,65 @@ int neighbor_discovery_callback_aodv(call_t *to, call_t *from, void *args) {
   call_t from0 = {to->class, to->object};
   destination_t destination = {BROADCAST_ADDR, {-1, -1, -1}};
  
-  /* create a hello packet */
-  packet_t *packet = packet_create(to, nodedata->overhead + sizeof(struct packet_header)+sizeof(struct hello_packet_header), nodedata->hello_packet_real_size*8);
- 
-  /* extract hello and network headers */
-   struct packet_header *header = malloc(sizeof(struct packet_header));
-  field_t *field_packet_header = field_create(INT, sizeof(struct packet_header), header);
-  packet_add_field(packet, "packet_header", field_packet_header);
-  
-  struct hello_packet_header *hello_header = malloc(sizeof(struct hello_packet_header));
-  field_t *field_hello_header = field_create(INT, sizeof(struct hello_packet_header), hello_header);
-  packet_add_field(packet, "hello_packet_header", field_hello_header);
-  
-  /* set mac header */
-  if (SET_HEADER(&to0, to, packet, &destination) == -1) {
-    packet_dealloc(packet);
-    return -1;
+  /* outdated by a reset of the Trickle timer */
+  if (!neighbor_hello_is_pending(to, args)) {
+    return 0;
   }
+
+  /* build the hello packet only if it has to be sent */
+  if (neighbor_hello_should_send(to)) {
+    /* create a hello packet */
+    packet_t *packet = packet_create(to, nodedata->overhead + sizeof(struct packet_header)+sizeof(struct hello_packet_header), nodedata->hello_packet_real_size*8);
+ 
+    /* extract hello and network headers */
+     struct packet_header *header = malloc(sizeof(struct packet_header));
+    field_t *field_packet_header = field_create(INT, sizeof(struct packet_header), header);
+    packet_add_field(packet, "packet_header", field_packet_header);
+  
+    struct hello_packet_header *hello_header = malloc(sizeof(struct hello_packet_header));
+    field_t *field_hello_header = field_create(INT, sizeof(struct hello_packet_header), hello_header);
+    packet_add_field(packet, "hello_packet_header", field_hello_header);
+  
+    /* set mac header */
+    if (SET_HEADER(&to0, to, packet, &destination) == -1) {
+      packet_dealloc(packet);
+      return -1;
+    }
   
-  /* set basic packet header */
-  header->src = to->object;
-  header->dst = BROADCAST_ADDR;
-  header->type = nodedata->node_type;
-  header->packet_type = HELLO_PACKET;
+    /* set basic packet header */
+    header->src = to->object;
+    header->dst = BROADCAST_ADDR;
+    header->type = nodedata->node_type;
+    header->packet_type = HELLO_PACKET;
   
-  /* set hello packet header */
-  if (nodedata->node_type == SINK_NODE) {
-    hello_header->sink_id = to->object;
-    hello_header->hop_to_sink = -1;  
-  }
-  else  {
-    hello_header->sink_id = -1;
-    hello_header->hop_to_sink = -1;
-  }
-  hello_header->position.x = get_node_position(to->object)->x;
-  hello_header->position.y = get_node_position(to->object)->y;
-  hello_header->position.z = get_node_position(to->object)->z;
+    /* set hello packet header */
+    if (nodedata->node_type == SINK_NODE) {
+      hello_header->sink_id = to->object;
+      hello_header->hop_to_sink = -1;  
+    }
+    else  {
+      hello_header->sink_id = -1;
+      hello_header->hop_to_sink = -1;
+    }
+    hello_header->position.x = get_node_position(to->object)->x;
+    hello_header->position.y = get_node_position(to->object)->y;
+    hello_header->position.z = get_node_position(to->object)->z;
+    hello_header->interval = neighbor_hello_interval(to);
   
-  /* send / push hello packet to the immediately lower-layer simulation module (e.g. MAC) */
-  TX(&to0, &from0, packet);
+    /* send / push hello packet to the immediately lower-layer simulation module (e.g. MAC) */
+    TX(&to0, &from0, packet);
 
-  /* update local stats */
-  nodedata->tx_nbr[header->packet_type]++;
+    /* update local stats */
+    nodedata->tx_nbr[header->packet_type]++;
   
-  /* update global stats */
-  classdata->current_tx_control_packet ++;
-  classdata->current_tx_control_packet_bytes += (packet->real_size/8);
+    /* update global stats */
+    classdata->current_tx_control_packet ++;
+    classdata->current_tx_control_packet_bytes += (packet->real_size/8);
   
 #ifdef ROUTING_LOG_HELLO
-  printf("[ROUTING_LOG_HELLO] Time %lfs node %d has sent a hello packet (%d %d) \n", get_time()*0.000000001, to->object, hello_header->sink_id, hello_header->hop_to_sink);
+    printf("[ROUTING_LOG_HELLO] Time %lfs node %d has sent a hello packet (%d %d) \n", get_time()*0.000000001, to->object, hello_header->sink_id, hello_header->hop_to_sink);
 #endif
+  }
 
   /* update nbr of transmitted hello packets */
   if (nodedata->hello_nbr > 0) {
@@ -177,16 +362,16 @@ int neighbor_discovery_callback_aodv(call_t *to, call_t *from, void *args) {
   
   /* schedules next hello packet transmission */
   if (nodedata->hello_nbr > 0 || nodedata->hello_nbr == -1) {
-    nodedata->previous_hello_slot_time += nodedata->hello_period;
-    scheduler_add_callback(nodedata->previous_hello_slot_time + get_random_double() * nodedata->hello_period, to, from, neighbor_discovery_callback_aodv, NULL);
+    neighbor_hello_schedule(to, from, neighbor_discovery_callback_aodv);
   }
   return 0;
 }
 
 /*## ORACENET Discovery Callback*/
 
-/** \brief Callback function for the periodic hello packet transmission in AODV (to be used with the scheduler_add_callback function).
- *  \fn int neighbor_discovery_callback_aodv(call_t *to, void *args)
+/** \brief Callback function for the periodic hello packet transmission in ORACENET (to be used with the scheduler_add_callback function).
+ *  The hello is suppressed when a data or advert packet already carried the hello fields since the last hello decision.
+ *  \fn int neighbor_discovery_callback_oracenet(call_t *to, void *args)
  *  \param c is a pointer to the called entity
  *  \param args is a pointer to the arguments of the function
  *  \return 0 if success, -1 otherwise
@@ -195,77 +380,96 @@ int neighbor_discovery_callback_oracenet(call_t *to, call_t *from, void *args) {
   struct nodedata *nodedata = get_node_private_data(to);
   struct classdata *classdata = get_class_private_data(to);
  
- /* Variables needed to consider the delayed Hello in the PRR calculations */
-  uint64_t hello_slot_time = get_time() + nodedata->hello_start;
-  uint64_t hello_tx_time = hello_slot_time + get_random_double() * nodedata->hello_period;
- 
   /* get a pointer to the lower-layers modules */
   call_t to0   = {get_class_bindings_down(to)->elts[0], to->object};
   call_t from0 = {to->class, to->object};
   destination_t destination = {BROADCAST_ADDR, {-1, -1, -1}};
+  int should_send;
  
-  /* create a hello packet */
-  packet_t *packet = packet_create(to, nodedata->overhead + sizeof(struct packet_header)+sizeof(struct hello_packet_header), nodedata->hello_packet_real_size*8);
- 
-  /* extract hello and network headers */
-   struct packet_header *header = malloc(sizeof(struct packet_header));
-  field_t *field_packet_header = field_create(INT, sizeof(struct packet_header), header);
-  packet_add_field(packet, "packet_header", field_packet_header);
-  
-  struct hello_packet_header *hello_header = malloc(sizeof(struct hello_packet_header));
-  field_t *field_hello_header = field_create(INT, sizeof(struct hello_packet_header), hello_header);
-  packet_add_field(packet, "hello_packet_header", field_hello_header);
-  
-  /* set mac header */
-  if (SET_HEADER(&to0, to, packet, &destination) == -1) {
-    packet_dealloc(packet);
-    return -1;
-  }
-  
-  /* set basic packet header */
-  header->src = to->object;
-  header->dst = BROADCAST_ADDR;
-  header->type = nodedata->node_type;
-  header->packet_type = HELLO_PACKET;
-  
-  /* set hello packet header */
-  if (nodedata->node_type == SINK_NODE) {
-    hello_header->sink_id = to->object;
-    hello_header->hop_to_sink = -1;  
+  /* outdated by a reset of the Trickle timer */
+  if (!neighbor_hello_is_pending(to, args)) {
+    return 0;
   }
-  else  {
-    hello_header->sink_id = -1;
-    hello_header->hop_to_sink = -1;
+
+  /* a data or advert packet already stood for the hello of this window */
+  should_send = neighbor_hello_should_send(to);
+  if (should_send && nodedata->last_tx_time > nodedata->hello_window_start) {
+    nodedata->delayed_hello++;
+#ifdef ROUTING_LOG_HELLO
+    printf("[ROUTING_LOG_HELLO] Time %lfs node %d delayed a hello packet broadcast (piggybacked) \n", get_time()*0.000000001, to->object);
+#endif
   }
-  hello_header->position.x = get_node_position(to->object)->x;
-  hello_header->position.y = get_node_position(to->object)->y;
-  hello_header->position.z = get_node_position(to->object)->z;
+  /* build the hello packet only if it has to be sent */
+  else if (should_send) {
+    /* create a hello packet */
+    packet_t *packet = packet_create(to, nodedata->overhead + sizeof(struct packet_header)+sizeof(struct hello_packet_header), nodedata->hello_packet_real_size*8);
+ 
+    /* extract hello and network headers */
+    struct packet_header *header = malloc(sizeof(struct packet_header));
+    field_t *field_packet_header = field_create(INT, sizeof(struct packet_header), header);
+    packet_add_field(packet, "packet_header", field_packet_header);
+  
+    struct hello_packet_header *hello_header = malloc(sizeof(struct hello_packet_header));
+    field_t *field_hello_header = field_create(INT, sizeof(struct hello_packet_header), hello_header);
+    packet_add_field(packet, "hello_packet_header", field_hello_header);
+
+    /* compute the nexthop node ID towards the closest sink */
+    struct route *route = route_get_nexthop_to_destination_oracenet(to, -1);
+  
+    /* set mac header */
+    if (SET_HEADER(&to0, to, packet, &destination) == -1) {
+      packet_dealloc(packet);
+      return -1;
+    }
   
-  /* send / push hello packet to the immediately lower-layer simulation module (e.g. MAC) */
-  //if ((hello_tx_time - nodedata->last_tx_time) > nodedata->hello_period){
-  //	printf("### #HELLO BDCAST DONE");
-  	TX(&to0, &from0, packet);
-	/* update local stats */
-	  nodedata->tx_nbr[header->packet_type]++;
-	  
-	  /* update global stats */
-	  classdata->current_tx_control_packet ++;
-	  classdata->current_tx_control_packet_bytes += (packet->real_size/8);
+    /* set basic packet header */
+    header->src = to->object;
+    header->dst = BROADCAST_ADDR;
+    header->prevhop = to->object;
+    header->type = nodedata->node_type;
+    header->packet_type = HELLO_PACKET;
+  
+    /* set hello packet header, the same fields being piggybacked on data and advert packets */
+    if (nodedata->node_type == SINK_NODE) {
+      hello_header->sink_id = to->object;
+      hello_header->hop_to_sink = 0;  
+      header->hello_prr = 1.0;
+    }
+    else if (route != NULL) {
+      hello_header->sink_id = route->sink_id;
+      hello_header->hop_to_sink = route->hop_to_sink;
+      header->hello_prr = route->E2E_PRR;
+    }
+    else  {
+      hello_header->sink_id = -1;
+      hello_header->hop_to_sink = -1;
+      header->hello_prr = 0.0;
+    }
+    hello_header->position.x = get_node_position(to->object)->x;
+    hello_header->position.y = get_node_position(to->object)->y;
+    hello_header->position.z = get_node_position(to->object)->z;
+    hello_header->interval = neighbor_hello_interval(to);
+    header->hello_seq = nodedata->hello_seq++;
+    header->hello_hop_to_sink = hello_header->hop_to_sink;
+    header->hello_interval = hello_header->interval;
+  
+    /* send / push hello packet to the immediately lower-layer simulation module (e.g. MAC) */
+    TX(&to0, &from0, packet);
+
+    /* update local stats */
+    nodedata->tx_nbr[header->packet_type]++;
 	  
-#ifdef ROUTING_LOG_HELLO
-	  printf("[ROUTING_LOG_HELLO] Time %lfs node %d has sent a hello packet (%d %d) \n", get_time()*0.000000001, to->object, hello_header->sink_id, hello_header->hop_to_sink);
-#endif
-  //}
-  //else{
-  //	  printf("### #HELLO BDCAST DELAYED");
-   /* If this node will delay its HELLO BCAST, it has to notify all its neighbors by incrementing their delayed hello from this node */
+    /* update global stats */
+    classdata->current_tx_control_packet ++;
+    classdata->current_tx_control_packet_bytes += (packet->real_size/8);
 	  
-  //        nodedata->delayed_hello++;
 #ifdef ROUTING_LOG_HELLO
-	  printf("[ROUTING_LOG_HELLO] Time %lfs node %d delayed a hello packet broadcast (%d %d) \n", get_time()*0.000000001, to->object, hello_header->sink_id, hello_header->hop_to_sink);
+    printf("[ROUTING_LOG_HELLO] Time %lfs node %d has sent a hello packet (%d %d) \n", get_time()*0.000000001, to->object, hello_header->sink_id, hello_header->hop_to_sink);
 #endif
- // }
-  
+  }
+
+  /* a new window starts for the next hello */
+  nodedata->hello_window_start = get_time();
 
   /* update nbr of transmitted hello packets */
   if (nodedata->hello_nbr > 0) {
@@ -274,8 +478,7 @@ int neighbor_discovery_callback_oracenet(call_t *to, call_t *from, void *args) {
   
   /* schedules next hello packet transmission */
   if (nodedata->hello_nbr > 0 || nodedata->hello_nbr == -1) {
-    nodedata->previous_hello_slot_time += nodedata->hello_period;
-    scheduler_add_callback(nodedata->previous_hello_slot_time + get_random_double() * nodedata->hello_period, to, from, neighbor_discovery_callback_aodv, NULL);
+    neighbor_hello_schedule(to, from, neighbor_discovery_callback_oracenet);
   }
   return 0;
 }
@@ -386,78 +589,82 @@ int neighbor_discovery_callback_olsrv2(call_t *to, call_t *from, void *args) {
   call_t from0 = {to->class, to->object};
   destination_t destination = {BROADCAST_ADDR, {-1, -1, -1}};
  
-  /* create a hello packet */
-  packet_t *packet = packet_create(to, nodedata->overhead + sizeof(struct packet_header)+sizeof(struct hello_packet_header), nodedata->hello_packet_real_size*8);
+  /* outdated by a reset of the Trickle timer */
+  if (!neighbor_hello_is_pending(to, args)) {
+    return 0;
+  }
+
+  /* build the hello packet only if it has to be sent */
+  if (neighbor_hello_should_send(to)) {
+    /* create a hello packet */
+    packet_t *packet = packet_create(to, nodedata->overhead + sizeof(struct packet_header)+sizeof(struct hello_packet_header), nodedata->hello_packet_real_size*8);
  
-  /* extract hello and network headers */
-   struct packet_header *header = malloc(sizeof(struct packet_header));
-  field_t *field_packet_header = field_create(INT, sizeof(struct packet_header), header);
-  packet_add_field(packet, "packet_header", field_packet_header);
-  
-  struct hello_packet_header *hello_header = malloc(sizeof(struct hello_packet_header));
-  field_t *field_hello_header = field_create(INT, sizeof(struct hello_packet_header), hello_header);
-  packet_add_field(packet, "hello_packet_header", field_hello_header);
+    /* extract hello and network headers */
+     struct packet_header *header = malloc(sizeof(struct packet_header));
+    field_t *field_packet_header = field_create(INT, sizeof(struct packet_header), header);
+    packet_add_field(packet, "packet_header", field_packet_header);
+  
+    struct hello_packet_header *hello_header = malloc(sizeof(struct hello_packet_header));
+    field_t *field_hello_header = field_create(INT, sizeof(struct hello_packet_header), hello_header);
+    packet_add_field(packet, "hello_packet_header", field_hello_header);
    
-  int i = 0;
+    int i = 0;
 
-  /* set mac header */
-  if (SET_HEADER(&to0, to, packet, &destination) == -1) {
-    packet_dealloc(packet);
-    return -1;
-  }
+    /* set mac header */
+    if (SET_HEADER(&to0, to, packet, &destination) == -1) {
+      packet_dealloc(packet);
+      return -1;
+    }
   
-  /* set basic packet header */
-  header->src = to->object;
-  header->dst = BROADCAST_ADDR;
-  header->type = nodedata->node_type;
-  header->packet_type = HELLO_PACKET;
-
-	
-	for(i=0; i< MAX_NEIGHBORS_SIZE; i++){
-		hello_header->first_hop_neighbors[i] = -1;
-	}
+    /* set basic packet header */
+    header->src = to->object;
+    header->dst = BROADCAST_ADDR;
+    header->type = nodedata->node_type;
+    header->packet_type = HELLO_PACKET;
 
-i = 0;
+    for(i=0; i< MAX_NEIGHBORS_SIZE; i++){
+      hello_header->first_hop_neighbors[i] = -1;
+    }
 
+    i = 0;
 
- while((neighbor = (struct neighbor *) list_traverse(nodedata->neighbors)) != NULL) {
- 
- 
-/* Add neighbors in the HELLO packet Header */
-	
-  hello_header->first_hop_neighbors[i] = neighbor->id;
+    /* Add neighbors in the HELLO packet Header */
+    while((neighbor = (struct neighbor *) list_traverse(nodedata->neighbors)) != NULL) {
+      hello_header->first_hop_neighbors[i] = neighbor->id;
 
-  printf("[ROUTING_LOG_HELLO] %d added in the HELLO_OLSRv2 packet header \n", hello_header->first_hop_neighbors[i], to->object);
+      printf("[ROUTING_LOG_HELLO] %d added in the HELLO_OLSRv2 packet header \n", hello_header->first_hop_neighbors[i], to->object);
 
-  i = i + 1;
-}
+      i = i + 1;
+    }
 
-  /* set hello packet header */
-  if (nodedata->node_type == SINK_NODE) {
-    hello_header->sink_id = to->object;
-    hello_header->hop_to_sink = -1;  
-  }
-  else  {
-    hello_header->sink_id = -1;
-    hello_header->hop_to_sink = -1;
-  }
-  hello_header->position.x = get_node_position(to->object)->x;
-  hello_header->position.y = get_node_position(to->object)->y;
-  hello_header->position.z = get_node_position(to->object)->z;
+    /* set hello packet header */
+    if (nodedata->node_type == SINK_NODE) {
+      hello_header->sink_id = to->object;
+      hello_header->hop_to_sink = -1;  
+    }
+    else  {
+      hello_header->sink_id = -1;
+      hello_header->hop_to_sink = -1;
+    }
+    hello_header->position.x = get_node_position(to->object)->x;
+    hello_header->position.y = get_node_position(to->object)->y;
+    hello_header->position.z = get_node_position(to->object)->z;
+    hello_header->interval = neighbor_hello_interval(to);
   
-  /* send / push hello packet to the immediately lower-layer simulation module (e.g. MAC) */
-  TX(&to0, &from0, packet);
+    /* send / push hello packet to the immediately lower-layer simulation module (e.g. MAC) */
+    TX(&to0, &from0, packet);
 
-  /* update local stats */
-  nodedata->tx_nbr[header->packet_type]++;
+    /* update local stats */
+    nodedata->tx_nbr[header->packet_type]++;
   
-  /* update global stats */
-  classdata->current_tx_control_packet ++;
-  classdata->current_tx_control_packet_bytes += (packet->real_size/8);
+    /* update global stats */
+    classdata->current_tx_control_packet ++;
+    classdata->current_tx_control_packet_bytes += (packet->real_size/8);
   
 #ifdef ROUTING_LOG_HELLO
-  printf("[ROUTING_LOG_HELLO] Time %lfs node %d has sent a hello packet (%d %d) \n", get_time()*0.000000001, to->object, hello_header->sink_id, hello_header->hop_to_sink);
+    printf("[ROUTING_LOG_HELLO] Time %lfs node %d has sent a hello packet (%d %d) \n", get_time()*0.000000001, to->object, hello_header->sink_id, hello_header->hop_to_sink);
 #endif
+  }
 
   /* update nbr of transmitted hello packets */
   if (nodedata->hello_nbr > 0) {
@@ -466,8 +673,7 @@ i = 0;
   
   /* schedules next hello packet transmission */
   if (nodedata->hello_nbr > 0 || nodedata->hello_nbr == -1) {
-    nodedata->previous_hello_slot_time += nodedata->hello_period;
-    scheduler_add_callback(nodedata->previous_hello_slot_time + get_random_double() * nodedata->hello_period, to, from, neighbor_discovery_callback_olsrv2, NULL);
+    neighbor_hello_schedule(to, from, neighbor_discovery_callback_olsrv2);
   }
   return 0;
 }
@@ -490,70 +696,66 @@ int tc_broadcast_olsrv2(call_t *to, call_t *from, void *args) {
   call_t from0 = {to->class, to->object};
   destination_t destination = {BROADCAST_ADDR, {-1, -1, -1}};
  
-  /* create a TC packet */
-  packet_t *packet = packet_create(to, nodedata->overhead + sizeof(struct packet_header)+sizeof(struct tc_packet_header), nodedata->tc_packet_real_size*8);
+  /* build the TC packet only if it has to be sent */
+  if (tc_should_send(to)) {
+    /* create a TC packet */
+    packet_t *packet = packet_create(to, nodedata->overhead + sizeof(struct packet_header)+sizeof(struct tc_packet_header), nodedata->tc_packet_real_size*8);
  
-  /* extract tc and network headers */
-  struct packet_header *header = malloc(sizeof(struct packet_header));
-  field_t *field_packet_header = field_create(INT, sizeof(struct packet_header), header);
-  packet_add_field(packet, "packet_header", field_packet_header);
-  
-  struct tc_packet_header *tc_header = malloc(sizeof(struct tc_packet_header));
-  field_t *field_tc_header = field_create(INT, sizeof(struct tc_packet_header), tc_header);
-  packet_add_field(packet, "tc_packet_header", field_tc_header);
+    /* extract tc and network headers */
+    struct packet_header *header = malloc(sizeof(struct packet_header));
+    field_t *field_packet_header = field_create(INT, sizeof(struct packet_header), header);
+    packet_add_field(packet, "packet_header", field_packet_header);
+  
+    struct tc_packet_header *tc_header = malloc(sizeof(struct tc_packet_header));
+    field_t *field_tc_header = field_create(INT, sizeof(struct tc_packet_header), tc_header);
+    packet_add_field(packet, "tc_packet_header", field_tc_header);
    
-  int i = 0;
+    int i = 0;
 
-  /* set mac header */
-  if (SET_HEADER(&to0, to, packet, &destination) == -1) {
-    packet_dealloc(packet);
-    return -1;
-  }
+    /* set mac header */
+    if (SET_HEADER(&to0, to, packet, &destination) == -1) {
+      packet_dealloc(packet);
+      return -1;
+    }
   
-  /* set basic packet header */
-  header->src = to->object;
-  header->dst = BROADCAST_ADDR;
-  header->type = nodedata->node_type;
-  header->packet_type = TC_PACKET;
+    /* set basic packet header */
+    header->src = to->object;
+    header->dst = BROADCAST_ADDR;
+    header->type = nodedata->node_type;
+    header->packet_type = TC_PACKET;
 
-  tc_header->seq = nodedata->tc_seq++;
-
-  /* initialization of 1st hop and mpr table before receiving the new values from the TC header */	
-	for(i=0; i< MAX_NEIGHBORS_SIZE; i++){
-		tc_header->first_hop_neighbors[i] = -1;
-		
-	}
-/* Add MPRs in the TC packet Header */
-	for(i=0; i< MAX_NEIGHBORS_SIZE; i++){
-		tc_header->mpr[i] = nodedata->MPR_set[i];
-		
-	}
+    tc_header->seq = nodedata->tc_seq++;
 
-	i = 0;
+    /* initialization of 1st hop and mpr table before receiving the new values from the TC header */	
+    for(i=0; i< MAX_NEIGHBORS_SIZE; i++){
+      tc_header->first_hop_neighbors[i] = -1;
+    }
 
-	
+    /* Add MPRs in the TC packet Header */
+    for(i=0; i< MAX_NEIGHBORS_SIZE; i++){
+      tc_header->mpr[i] = nodedata->MPR_set[i];
+    }
 
-	while((neighbor = (struct neighbor *) list_traverse(nodedata->neighbors)) != NULL) { 
- 
-/* Add 1st hop neighbors in the TC packet Header */
-	
-  tc_header->first_hop_neighbors[i] = neighbor->id;
+    i = 0;
 
+    /* Add 1st hop neighbors in the TC packet Header */
+    while((neighbor = (struct neighbor *) list_traverse(nodedata->neighbors)) != NULL) { 
+      tc_header->first_hop_neighbors[i] = neighbor->id;
 
-  printf("[ROUTING_LOG_TC] First hop %d added in the TC_OLSRv2 packet header of %d\n", tc_header->first_hop_neighbors[i], to->object);
-  i = i + 1;
-}
+      printf("[ROUTING_LOG_TC] First hop %d added in the TC_OLSRv2 packet header of %d\n", tc_header->first_hop_neighbors[i], to->object);
+      i = i + 1;
+    }
 
-  
-  /* send / push hello packet to the immediately lower-layer simulation module (e.g. MAC) */
-  TX(&to0, &from0, packet);
+    /* send / push hello packet to the immediately lower-layer simulation module (e.g. MAC) */
+    TX(&to0, &from0, packet);
 
-  /* update local stats */
-  nodedata->tx_nbr[header->packet_type]++;
+    /* update local stats */
+    nodedata->tx_nbr[header->packet_type]++;
   
-  /* update global stats */
-  classdata->current_tx_control_packet ++;
-  classdata->current_tx_control_packet_bytes += (packet->real_size/8);
+    /* update global stats */
+    classdata->current_tx_control_packet ++;
+    classdata->current_tx_control_packet_bytes += (packet->real_size/8);
+  }
 
   /* update nbr of transmitted hello packets */
   if (nodedata->tc_nbr > 0) {
@@ -570,118 +772,20 @@ int tc_broadcast_olsrv2(call_t *to, call_t *from, void *args) {
 }
 
 /** \brief Function to update the local node neighbor table in Directed Diffusion according to a received hello packet.
- *  \fn int neighbor_update(call_t *to, packet_t *packet)
+ *  \fn int neighbor_update(call_t *to, packet_t *packet, struct packet_header *header, struct hello_packet_header *hello_header)
  *  \param c is a pointer to the called entity
  *  \param packet is a pointer to the received packet
+ *  \param header is a pointer to the packet header of the received packet
+ *  \param hello_header is a pointer to the hello header of the received packet
  *  \return 0 if success, -1 otherwise
  **/
-int neighbor_update(call_t *to, packet_t *packet) {
-  struct nodedata *nodedata = get_node_private_data(to);
-  
-  /* extract the network and hello headers */
-  field_t *field_header = packet_retrieve_field(packet, "packet_header");
-  struct packet_header* header = (struct packet_header*) field_getValue(field_header);
-  field_t *field_hello_header = packet_retrieve_field(packet, "hello_packet_header");
-  struct hello_packet_header* hello_header = (struct hello_packet_header*) field_getValue(field_hello_header);
-  
-  struct neighbor *neighbor = NULL;
-  int current_slot, update = 0;
-
-
-   /* clear the neighbor table from dead/unavailable neighbors */ 
-  list_selective_delete(nodedata->neighbors, neighbor_timeout_management, (void *)to);
- 
-  /* check if neighbor node already exist and update related information */
-  list_init_traverse(nodedata->neighbors);
-  
-  while((neighbor = (struct neighbor *) list_traverse(nodedata->neighbors)) != NULL) {
-  
-    /* update the entry information if the neighbor already exist */
-    if (neighbor->id == header->src) {
-      neighbor->type = header->type;
-      neighbor->hop_to_sink = hello_header->hop_to_sink;
-      current_slot = floor( (get_time()-nodedata->hello_start) / nodedata->hello_period );
-      neighbor->rx_nbr++;
-      neighbor->loss_nbr += (current_slot - neighbor->slot - 1);
-      neighbor->lqe = (neighbor->rx_nbr*1.0 / ((neighbor->rx_nbr + neighbor->loss_nbr)*1.0));
-      neighbor->rxdbm = nodedata->rssi_smoothing_factor * neighbor->rxdbm + (1 - nodedata->rssi_smoothing_factor) * packet->rxdBm;
-      neighbor->time = get_time();
-      neighbor->slot = current_slot;
-      neighbor->position.x = hello_header->position.x;
-      neighbor->position.y = hello_header->position.y;
-      neighbor->position.z = hello_header->position.z;
-      update = 1;
-      break;
-    }
-    
-  }
-  
-  /* if the neighbor does not exist, create a new entry in the local neighborhood table */
-  if (update == 0) {
-    neighbor = (struct neighbor *) malloc(sizeof(struct neighbor));
-    neighbor->id = header->src;
-    neighbor->type = header->type;
-    neighbor->hop_to_sink = hello_header->hop_to_sink;
-    neighbor->slot_init = floor((get_time()-nodedata->hello_start) / nodedata->hello_period );
-    neighbor->slot = neighbor->slot_init;
-    neighbor->rx_nbr = 1;
-    neighbor->loss_nbr = neighbor->slot;
-    neighbor->lqe = neighbor->rx_nbr / (neighbor->rx_nbr + neighbor->loss_nbr);
-    neighbor->rxdbm = packet->rxdBm;
-    neighbor->time = get_time();
-    neighbor->position.x = hello_header->position.x;
-    neighbor->position.y = hello_header->position.y;
-    neighbor->position.z = hello_header->position.z;
-    list_insert(nodedata->neighbors, (void *) neighbor);
-    
-    /* set the path establishment time */
-    if (neighbor->type == SINK_NODE && nodedata->path_establishment_delay == -1) {
-      nodedata->path_establishment_delay = get_time() * 0.000001;
-      route_update_global_stats(to, nodedata->path_establishment_delay);
-    }
-    
-#ifdef ROUTING_LOG_HELLO
-    printf("[ROUTING_LOG_HELLO] Time %lfs node %d has discovered the neighbor %d \n", get_time()*0.000000001, to->object, neighbor->id);
-#endif
-  }
-
-  /* update the route table if the neighbor has a good LQE */ 
-  if (neighbor->lqe >= nodedata->lqe_threshold) {
-    route_update_from_hello(to, header, hello_header, neighbor->lqe);
-  }
-
-  return 0;
-}
-
-/** ## ORACENET  Neighbor Update **/
-
-int oracenet_neighbor_update(call_t *to, packet_t *packet) {
+int neighbor_update(call_t *to, packet_t *packet, struct packet_header *header, struct hello_packet_header *hello_header) {
   struct nodedata *nodedata = get_node_private_data(to);
   
-
-  /* extract the network and hello headers */
-  field_t *field_header = packet_retrieve_field(packet, "packet_header");
-  struct packet_header* header = (struct packet_header*) field_getValue(field_header);
-  field_t *field_hello_header = packet_retrieve_field(packet, "hello_packet_header");
-  struct hello_packet_header* hello_header = (struct hello_packet_header*) field_getValue(field_hello_header);
   
   struct neighbor *neighbor = NULL;
   int current_slot, update = 0;
-  double current_prr;
-  double time_to_test;
-  
- 
-  /* Value of the Current nodedata->prr */
-   while((neighbor = (struct neighbor *) list_traverse(nodedata->neighbors)) != NULL) {
-  
-    /* update the entry information if the neighbor already exist, needed to update the route from Hello packets*/
-    if ((neighbor->id == header->src) && (get_time() > nodedata->hello_start)) {
-	current_prr = neighbor->prr;
-    } 
-    else{
-	current_prr = 0.000000;
-    }
-   }
+
 
    /* clear the neighbor table from dead/unavailable neighbors */ 
   list_selective_delete(nodedata->neighbors, neighbor_timeout_management, (void *)to);
@@ -695,16 +799,18 @@ int oracenet_neighbor_update(call_t *to, packet_t *packet) {
     if (neighbor->id == header->src) {
       neighbor->type = header->type;
       neighbor->hop_to_sink = hello_header->hop_to_sink;
-      current_slot = floor((get_time() - nodedata->hello_start) / (int)(nodedata->hello_period) );
+      current_slot = floor( (get_time()-nodedata->hello_start) / nodedata->hello_period );
       neighbor->rx_nbr++;
-      nodedata->expected_hello = floor((get_time() - nodedata->hello_start) / nodedata->hello_period) + 1;
-      neighbor->prr = (double)(neighbor->rx_nbr)/ (nodedata->expected_hello - nodedata->delayed_hello);
+      neighbor->loss_nbr += (current_slot - neighbor->slot - 1);
+      neighbor->lqe = (neighbor->rx_nbr*1.0 / ((neighbor->rx_nbr + neighbor->loss_nbr)*1.0));
       neighbor->rxdbm = nodedata->rssi_smoothing_factor * neighbor->rxdbm + (1 - nodedata->rssi_smoothing_factor) * packet->rxdBm;
       neighbor->time = get_time();
       neighbor->slot = current_slot;
       neighbor->position.x = hello_header->position.x;
       neighbor->position.y = hello_header->position.y;
       neighbor->position.z = hello_header->position.z;
+      neighbor->hello_interval = hello_header->interval;
+      neighbor_hello_consistent(to);
       update = 1;
       break;
     }
@@ -717,17 +823,21 @@ int oracenet_neighbor_update(call_t *to, packet_t *packet) {
     neighbor->id = header->src;
     neighbor->type = header->type;
     neighbor->hop_to_sink = hello_header->hop_to_sink;
-    neighbor->slot_init = floor((get_time()-nodedata->hello_start) / (int)(nodedata->hello_period) ); 
+    neighbor->slot_init = floor((get_time()-nodedata->hello_start) / nodedata->hello_period );
     neighbor->slot = neighbor->slot_init;
     neighbor->rx_nbr = 1;
-    nodedata->expected_hello = floor((get_time() - nodedata->hello_start) / nodedata->hello_period) + 1;
-    neighbor->prr = (double)(neighbor->rx_nbr)/ (nodedata->expected_hello - nodedata->delayed_hello);
+    neighbor->loss_nbr = neighbor->slot;
+    neighbor->lqe = neighbor->rx_nbr / (neighbor->rx_nbr + neighbor->loss_nbr);
     neighbor->rxdbm = packet->rxdBm;
     neighbor->time = get_time();
     neighbor->position.x = hello_header->position.x;
     neighbor->position.y = hello_header->position.y;
     neighbor->position.z = hello_header->position.z;
+    neighbor->hello_interval = hello_header->interval;
     list_insert(nodedata->neighbors, (void *) neighbor);
+
+    /* a new neighbor is a topology change */
+    neighbor_hello_reset(to);
     
     /* set the path establishment time */
     if (neighbor->type == SINK_NODE && nodedata->path_establishment_delay == -1) {
@@ -736,187 +846,414 @@ int oracenet_neighbor_update(call_t *to, packet_t *packet) {
     }
     
 #ifdef ROUTING_LOG_HELLO
-    printf("[ROUTING_LOG_HELLO] Time %lfs node %d has discovered the neighbor %d with PRR %lf \n", get_time()*0.000000001, to->object, neighbor->id, neighbor->prr);
+    printf("[ROUTING_LOG_HELLO] Time %lfs node %d has discovered the neighbor %d \n", get_time()*0.000000001, to->object, neighbor->id);
 #endif
   }
-  /* Update the route table if the neighbor has new better PRR */
-   if (neighbor->prr > 0.000000) {
-	route_update_oracenet_prr_from_hello(to, packet, header->src); 
-   }
+
+  /* update the route table if the neighbor has a good LQE */ 
+  if (neighbor->lqe >= nodedata->lqe_threshold) {
+    route_update_from_hello(to, header, hello_header, neighbor->lqe);
+  }
 
   return 0;
 }
 
-/* ## ORACENET Neighbor Update from MAC layer */
+/** \brief Function to reset the link quality estimator state of a neighbor entry (ORACENET).
+ *  \fn void lqe_init(call_t *to, struct neighbor *neighbor)
+ *  \param c is a pointer to the called entity
+ *  \param neighbor is a pointer to the neighbor entry
+ **/
+void lqe_init(call_t *to, struct neighbor *neighbor) {
+  neighbor->lqe_bitmap = 0;
+  neighbor->lqe_slots = 0;
+  neighbor->lqe_rx = 0;
+  neighbor->prr = 0.0;
+}
 
-int oracenet_neighbor_crosslayer_update(call_t *to, packet_t *packet, int prevhop) {
+/** \brief Windowed PRR estimator: ratio of received beacons among the last lqe_w ones, kept in a bitmap.
+ *  \fn double lqe_update_prr(call_t *to, struct neighbor *neighbor, int lost)
+ *  \param c is a pointer to the called entity
+ *  \param neighbor is a pointer to the neighbor entry
+ *  \param lost is the number of beacons lost before the received one
+ *  \return the new link quality estimate
+ **/
+double lqe_update_prr(call_t *to, struct neighbor *neighbor, int lost) {
+  struct nodedata *nodedata = get_node_private_data(to);
+  uint64_t mask = (nodedata->lqe_w >= 64) ? ~0ull : ((1ull << nodedata->lqe_w) - 1);
+
+  /* shift the lost beacons and the received one in, the oldest ones fall out of the window */
+  if (lost + 1 >= nodedata->lqe_w) {
+    neighbor->lqe_bitmap = 1;
+  }
+  else {
+    neighbor->lqe_bitmap = ((neighbor->lqe_bitmap << (lost + 1)) | 1) & mask;
+  }
+  neighbor->lqe_slots = (neighbor->lqe_slots + lost + 1 > nodedata->lqe_w) ? nodedata->lqe_w : neighbor->lqe_slots + lost + 1;
+  neighbor->lqe_rx = __builtin_popcountll(neighbor->lqe_bitmap);
+
+  return neighbor->lqe_rx * 1.0 / neighbor->lqe_slots;
+}
+
+/** \brief EWMA estimator: every beacon, lost or received, is smoothed in with the lqe_alpha factor.
+ *  \fn double lqe_update_ewma(call_t *to, struct neighbor *neighbor, int lost)
+ *  \param c is a pointer to the called entity
+ *  \param neighbor is a pointer to the neighbor entry
+ *  \param lost is the number of beacons lost before the received one
+ *  \return the new link quality estimate
+ **/
+double lqe_update_ewma(call_t *to, struct neighbor *neighbor, int lost) {
+  struct nodedata *nodedata = get_node_private_data(to);
+
+  /* the first beacon seeds the estimate */
+  if (neighbor->lqe_slots == 0) {
+    neighbor->lqe_slots = 1;
+    return 1.0;
+  }
+
+  /* lost times est = alpha * est, then est = alpha * est + (1 - alpha) */
+  return neighbor->prr * pow(nodedata->lqe_alpha, lost + 1) + (1 - nodedata->lqe_alpha);
+}
+
+/** \brief WMEWMA estimator: the PRR of each window of lqe_w beacons is smoothed in with the lqe_alpha factor.
+ *  \fn double lqe_update_wmewma(call_t *to, struct neighbor *neighbor, int lost)
+ *  \param c is a pointer to the called entity
+ *  \param neighbor is a pointer to the neighbor entry
+ *  \param lost is the number of beacons lost before the received one
+ *  \return the new link quality estimate
+ **/
+double lqe_update_wmewma(call_t *to, struct neighbor *neighbor, int lost) {
+  struct nodedata *nodedata = get_node_private_data(to);
+  double window_prr;
+
+  neighbor->lqe_slots += lost + 1;
+  neighbor->lqe_rx++;
+
+  /* window in progress: keep the last estimate, or the PRR of the first window so far */
+  if (neighbor->lqe_slots < nodedata->lqe_w) {
+    return (neighbor->rx_nbr > neighbor->lqe_rx) ? neighbor->prr : neighbor->lqe_rx * 1.0 / neighbor->lqe_slots;
+  }
+
+  /* window over: the first one seeds the estimate (no beacon was received before it) */
+  window_prr = neighbor->lqe_rx * 1.0 / neighbor->lqe_slots;
+  if (neighbor->rx_nbr > neighbor->lqe_rx) {
+    window_prr = nodedata->lqe_alpha * neighbor->prr + (1 - nodedata->lqe_alpha) * window_prr;
+  }
+  neighbor->lqe_slots = 0;
+  neighbor->lqe_rx = 0;
+
+  return window_prr;
+}
+
+/** \brief Function to feed the link quality estimator selected by lqe_estimator with a received beacon (ORACENET).
+ *  \fn void lqe_update(call_t *to, struct neighbor *neighbor, int lost)
+ *  \param c is a pointer to the called entity
+ *  \param neighbor is a pointer to the neighbor entry
+ *  \param lost is the number of beacons lost before the received one
+ **/
+void lqe_update(call_t *to, struct neighbor *neighbor, int lost) {
+  struct nodedata *nodedata = get_node_private_data(to);
+
+  switch (nodedata->lqe_estimator) {
+  case LQE_EWMA:
+    neighbor->prr = lqe_update_ewma(to, neighbor, lost);
+    break;
+  case LQE_WMEWMA:
+    neighbor->prr = lqe_update_wmewma(to, neighbor, lost);
+    break;
+  default:
+    neighbor->prr = lqe_update_prr(to, neighbor, lost);
+    break;
+  }
+}
+
+/** \brief Function to account a beacon (hello, or hello fields piggybacked on a data or advert packet) in the link quality estimate of its sender (ORACENET).
+ *  \fn void oracenet_neighbor_prr_update(call_t *to, struct neighbor *neighbor, int hello_seq)
+ *  \param c is a pointer to the called entity
+ *  \param neighbor is a pointer to the sender entry in the neighbor table
+ *  \param hello_seq is the beacon number carried by the packet (-1 if the packet does not stand for a hello)
+ **/
+void oracenet_neighbor_prr_update(call_t *to, struct neighbor *neighbor, int hello_seq) {
+  int lost = 0;
+
+  /* not a beacon, or a beacon already accounted */
+  if (hello_seq < 0 || hello_seq <= neighbor->slot) {
+    return;
+  }
+
+  /* the beacon numbers skipped since the last reception are lost beacons: 
+   * the suppressed hellos do not consume any number and do not bias the PRR */
+  if (neighbor->slot < 0) {
+    neighbor->slot_init = hello_seq;
+  }
+  else {
+    lost = hello_seq - neighbor->slot - 1;
+  }
+  neighbor->loss_nbr += lost;
+  neighbor->rx_nbr++;
+  neighbor->slot = hello_seq;
+  lqe_update(to, neighbor, lost);
+}
+
+/** \brief Function to look up the local neighbor entry of a node, created if needed (ORACENET).
+ *  \fn struct neighbor *oracenet_neighbor_lookup(call_t *to, int id, int type, double rxdbm, uint64_t time)
+ *  \param c is a pointer to the called entity
+ *  \param id is the neighbor node ID
+ *  \param type is the neighbor node type
+ *  \param rxdbm is the received power of the packet sent by the neighbor
+ *  \param time is the reception time of the packet sent by the neighbor
+ *  \return a pointer to the neighbor entry
+ **/
+struct neighbor *oracenet_neighbor_lookup(call_t *to, int id, int type, double rxdbm, uint64_t time) {
   struct nodedata *nodedata = get_node_private_data(to);
-  
-  /* extract the network and hello headers */
-  field_t *field_header = packet_retrieve_field(packet, "packet_header");
-  struct packet_header* header = (struct packet_header*) field_getValue(field_header);
-  
   struct neighbor *neighbor = NULL;
-  int current_slot, update = 0;
- 
-  /* clear the neighbor table from dead/unavailable neighbors */ 
-  list_selective_delete(nodedata->neighbors, neighbor_timeout_management, (void *)to);
- 
+
   /* check if neighbor node already exist and update related information */
   list_init_traverse(nodedata->neighbors);
-  
   while((neighbor = (struct neighbor *) list_traverse(nodedata->neighbors)) != NULL) {
-  
-    /* update the entry information if the neighbor already exist */
-    if (neighbor->id == header->src) {
-      neighbor->type = header->type;
-      neighbor->hop_to_sink = 1;
-      current_slot = floor((get_time() - nodedata->hello_start) / (int)(nodedata->hello_period) );
-      neighbor->rx_nbr++;
-      nodedata->expected_hello = floor((get_time() - nodedata->hello_start) / nodedata->hello_period) + 1;
-      neighbor->prr = (double)(neighbor->rx_nbr)/ (nodedata->expected_hello - nodedata->delayed_hello);
-      if (neighbor->prr > 1.000000){
-	neighbor->prr = 1.000000;
-      }
-      neighbor->rxdbm = nodedata->rssi_smoothing_factor * neighbor->rxdbm + (1 - nodedata->rssi_smoothing_factor) * packet->rxdBm;
-      neighbor->time = get_time();
-      neighbor->slot = current_slot;
-      update = 1;
-      break;
+    if (neighbor->id == id) {
+      neighbor->type = type;
+      neighbor->rxdbm = nodedata->rssi_smoothing_factor * neighbor->rxdbm + (1 - nodedata->rssi_smoothing_factor) * rxdbm;
+      neighbor->time = time;
+      return neighbor;
     }
-    
   }
-  
+
   /* if the neighbor does not exist, create a new entry in the local neighborhood table */
-  if (update == 0) {
-    neighbor = (struct neighbor *) malloc(sizeof(struct neighbor));
-    neighbor->id = header->src;
-    neighbor->type = header->type;
-    neighbor->hop_to_sink = 1;
-    neighbor->slot_init = floor((get_time()-nodedata->hello_start) / (int)(nodedata->hello_period) ); 
-    neighbor->slot = neighbor->slot_init;
-    neighbor->rx_nbr = 1;
-    nodedata->expected_hello = floor((get_time() - nodedata->hello_start) / nodedata->hello_period) + 1;
-    neighbor->prr = (double)(neighbor->rx_nbr)/ (nodedata->expected_hello - nodedata->delayed_hello);
-    if (neighbor->prr > 1.000000){
-	neighbor->prr = 1.000000;
-    }
-    neighbor->rxdbm = packet->rxdBm;
-    neighbor->time = get_time();
-    list_insert(nodedata->neighbors, (void *) neighbor);
-    
-    /* set the path establishment time */
-    if (neighbor->type == SINK_NODE && nodedata->path_establishment_delay == -1) {
-      nodedata->path_establishment_delay = get_time() * 0.000001;
-      route_update_global_stats(to, nodedata->path_establishment_delay);
-    }
+  neighbor = (struct neighbor *) malloc(sizeof(struct neighbor));
+  neighbor->id = id;
+  neighbor->type = type;
+  neighbor->hop_to_sink = -1;
+  neighbor->slot_init = -1;
+  neighbor->slot = -1;
+  neighbor->rx_nbr = 0;
+  neighbor->loss_nbr = 0;
+  neighbor->sink_prr = 0.0;
+  neighbor->hello_interval = 0;
+  lqe_init(to, neighbor);
+  neighbor->rxdbm = rxdbm;
+  neighbor->time = time;
+  list_insert(nodedata->neighbors, (void *) neighbor);
+
+  /* a new neighbor is a topology change */
+  neighbor_hello_reset(to);
     
+  /* set the path establishment time */
+  if (neighbor->type == SINK_NODE && nodedata->path_establishment_delay == -1) {
+    nodedata->path_establishment_delay = get_time() * 0.000001;
+    route_update_global_stats(to, nodedata->path_establishment_delay);
+  }
+  return neighbor;
+}
+
+/** \brief Function to get the local neighbor entry of the sender of a received packet, created if needed (ORACENET).
+ *  \fn struct neighbor *oracenet_neighbor_get(call_t *to, packet_t *packet, struct packet_header *header, int id)
+ *  \param c is a pointer to the called entity
+ *  \param packet is a pointer to the received packet
+ *  \param header is a pointer to the packet header of the received packet
+ *  \param id is the neighbor node ID
+ *  \return a pointer to the neighbor entry
+ **/
+struct neighbor *oracenet_neighbor_get(call_t *to, packet_t *packet, struct packet_header *header, int id) {
+  struct nodedata *nodedata = get_node_private_data(to);
+
+  /* the overheard packets received before are accounted first, so that the beacons are accounted in order
+   * and the neighbors overheard meanwhile are not timed out */
+  oracenet_neighbor_crosslayer_apply(to);
+
+  /* clear the neighbor table from dead/unavailable neighbors */ 
+  list_selective_delete(nodedata->neighbors, neighbor_timeout_management, (void *)to);
+
+  return oracenet_neighbor_lookup(to, id, header->type, packet->rxdBm, get_time());
+}
+
+/** \brief Function to update the local node neighbor table in ORACENET according to a received hello packet.
+ *  \fn int oracenet_neighbor_update(call_t *to, packet_t *packet, struct packet_header *header, struct hello_packet_header *hello_header)
+ *  \param c is a pointer to the called entity
+ *  \param packet is a pointer to the received packet
+ *  \param header is a pointer to the packet header of the received packet
+ *  \param hello_header is a pointer to the hello header of the received packet
+ *  \return 0 if success, -1 otherwise
+ **/
+int oracenet_neighbor_update(call_t *to, packet_t *packet, struct packet_header *header, struct hello_packet_header *hello_header) {
+  struct neighbor *neighbor = oracenet_neighbor_get(to, packet, header, header->src);
+
+  if (neighbor->rx_nbr > 0) {
+    neighbor_hello_consistent(to);
+  }
 #ifdef ROUTING_LOG_HELLO
-    printf("[ROUTING_LOG_CROSS_LAYER] Time %lfs node %d has discovered the neighbor %d with PRR %lf \n", get_time()*0.000000001, to->object, neighbor->id, neighbor->prr);
+  else {
+    printf("[ROUTING_LOG_HELLO] Time %lfs node %d has discovered the neighbor %d \n", get_time()*0.000000001, to->object, neighbor->id);
+  }
 #endif
+
+  neighbor->hop_to_sink = hello_header->hop_to_sink;
+  neighbor->sink_prr = header->hello_prr;
+  neighbor->hello_interval = header->hello_interval;
+  neighbor->position.x = hello_header->position.x;
+  neighbor->position.y = hello_header->position.y;
+  neighbor->position.z = hello_header->position.z;
+  oracenet_neighbor_prr_update(to, neighbor, header->hello_seq);
+
+  /* Update the route table if the neighbor has new better PRR */
+  if (neighbor->prr > 0.000000) {
+    route_update_oracenet_prr_from_hello(to, header, header->src); 
   }
+
   return 0;
 }
 
+/** \brief Function to update the local node neighbor table in ORACENET according to the hello fields piggybacked on a data or advert packet.
+ *  \fn int oracenet_neighbor_piggyback_update(call_t *to, packet_t *packet, struct packet_header *header, int sender)
+ *  \param c is a pointer to the called entity
+ *  \param packet is a pointer to the received packet
+ *  \param header is a pointer to the packet header of the received packet
+ *  \param sender is the ID of the last sender of the packet
+ *  \return 0 if success, -1 otherwise
+ **/
+int oracenet_neighbor_piggyback_update(call_t *to, packet_t *packet, struct packet_header *header, int sender) {
+  struct neighbor *neighbor = oracenet_neighbor_get(to, packet, header, sender);
+
+  neighbor->hop_to_sink = header->hello_hop_to_sink;
+  neighbor->sink_prr = header->hello_prr;
+  neighbor->hello_interval = header->hello_interval;
+  oracenet_neighbor_prr_update(to, neighbor, header->hello_seq);
+
+#ifdef ROUTING_LOG_HELLO
+  printf("[ROUTING_LOG_HELLO] Time %lfs node %d has received piggybacked hello fields from neighbor %d with PRR %lf \n", get_time()*0.000000001, to->object, neighbor->id, neighbor->prr);
+#endif
+  return 0;
+}
 
+/** \brief Function to buffer a packet overheard and filtered by the MAC layer until the next cross-layer batch (ORACENET).
+ *  \fn void oracenet_neighbor_crosslayer_record(call_t *to, struct overheard_record *record)
+ *  \param c is a pointer to the called entity
+ *  \param record is a pointer to the record of the overheard packet
+ **/
+void oracenet_neighbor_crosslayer_record(call_t *to, struct overheard_record *record) {
+  struct nodedata *nodedata = get_node_private_data(to);
+  call_t from = {-1, -1};
 
+  nodedata->overheard[nodedata->overheard_nbr++] = *record;
 
+  /* apply at once when batching is disabled or when the buffer is full */
+  if (nodedata->overheard_period == 0 || nodedata->overheard_nbr == MAX_OVERHEARD_SIZE) {
+    oracenet_neighbor_crosslayer_apply(to);
+    list_selective_delete(nodedata->neighbors, neighbor_timeout_management, (void *)to);
+  }
+  else if (!nodedata->overheard_scheduled) {
+    nodedata->overheard_scheduled = 1;
+    scheduler_add_callback(get_time() + nodedata->overheard_period, to, &from, oracenet_neighbor_crosslayer_callback, NULL);
+  }
+}
 
-/** \brief Function to update the local node neighbor table in Directed Diffusion according to a received hello packet.
- *  \fn int neighbor_update_from_oracenet_data_packet(call_t *to, packet_t *packet)
+/** \brief Function to apply the buffered overheard packets to the local neighbor table (ORACENET).
+ *  \fn void oracenet_neighbor_crosslayer_apply(call_t *to)
  *  \param c is a pointer to the called entity
- *  \param packet is a pointer to the received packet
- *  \return 0 if success, -1 otherwise
  **/
-int neighbor_update_from_oracenet_data_packet(call_t *to, packet_t *packet, int prevhop) {
-struct nodedata *nodedata = get_node_private_data(to);
-  
-  /* extract the network and hello headers */
-  field_t *field_header = packet_retrieve_field(packet, "packet_header");
-  struct packet_header* header = (struct packet_header*) field_getValue(field_header);
-  
-  struct neighbor *neighbor = NULL;
-  int current_slot, update = 0;
- 
-  /* clear the neighbor table from dead/unavailable neighbors */ 
-  list_selective_delete(nodedata->neighbors, neighbor_timeout_management, (void *)to);
- 
-  /* check if neighbor node already exist and update related information */
-  list_init_traverse(nodedata->neighbors);
-  
-  while((neighbor = (struct neighbor *) list_traverse(nodedata->neighbors)) != NULL) {
-  
-    /* update the entry information if the neighbor already exist */
-    if (neighbor->id == header->src) {
-      neighbor->type = header->type;
-      neighbor->hop_to_sink = 1;
-      current_slot = floor((get_time() - nodedata->hello_start) / (int)(nodedata->hello_period) );
-      neighbor->rx_nbr++;
-      nodedata->expected_hello = floor((get_time() - nodedata->hello_start) / nodedata->hello_period) + 1;
-      neighbor->prr = (double)(neighbor->rx_nbr)/ (nodedata->expected_hello - nodedata->delayed_hello);
-      if (neighbor->prr > 1.000000){
-	neighbor->prr = 1.000000;
-      }
-      neighbor->rxdbm = nodedata->rssi_smoothing_factor * neighbor->rxdbm + (1 - nodedata->rssi_smoothing_factor) * packet->rxdBm;
-      neighbor->time = get_time();
-      neighbor->slot = current_slot;
-      update = 1;
-      break;
-    }
-    
+void oracenet_neighbor_crosslayer_apply(call_t *to) {
+  struct nodedata *nodedata = get_node_private_data(to);
+  struct overheard_record *record;
+  struct neighbor *neighbor;
+  int i;
+
+  /* an overheard data packet is a beacon of its last sender, not of its source */
+  for (i = 0; i < nodedata->overheard_nbr; i++) {
+    record = &(nodedata->overheard[i]);
+    neighbor = oracenet_neighbor_lookup(to, record->sender, record->type, record->rxdbm, record->time);
+    neighbor->hop_to_sink = record->hop_to_sink;
+    neighbor->sink_prr = record->sink_prr;
+    neighbor->hello_interval = record->hello_interval;
+    oracenet_neighbor_prr_update(to, neighbor, record->hello_seq);
   }
-  
-  /* if the neighbor does not exist, create a new entry in the local neighborhood table */
-  if (update == 0) {
-    neighbor = (struct neighbor *) malloc(sizeof(struct neighbor));
-    neighbor->id = header->src;
-    neighbor->type = header->type;
-    neighbor->hop_to_sink = 1;
-    neighbor->slot_init = floor((get_time()-nodedata->hello_start) / (int)(nodedata->hello_period) ); 
-    neighbor->slot = neighbor->slot_init;
-    neighbor->rx_nbr = 1;
-    nodedata->expected_hello = floor((get_time() - nodedata->hello_start) / nodedata->hello_period) + 1;
-    neighbor->prr = (double)(neighbor->rx_nbr)/ (nodedata->expected_hello - nodedata->delayed_hello);
-    if (neighbor->prr > 1.000000){
-	neighbor->prr = 1.000000;
-    }
-    neighbor->rxdbm = packet->rxdBm;
-    neighbor->time = get_time();
-    list_insert(nodedata->neighbors, (void *) neighbor);
-    
-    /* set the path establishment time */
-    if (neighbor->type == SINK_NODE && nodedata->path_establishment_delay == -1) {
-      nodedata->path_establishment_delay = get_time() * 0.000001;
-      route_update_global_stats(to, nodedata->path_establishment_delay);
-    }
-    
+
 #ifdef ROUTING_LOG_HELLO
-    printf("[ROUTING_LOG_DATA] Time %lfs node %d has discovered the neighbor %d with PRR %lf \n", get_time()*0.000000001, to->object, neighbor->id, neighbor->prr);
+  if (nodedata->overheard_nbr > 0) {
+    printf("[ROUTING_LOG_HELLO] Time %lfs node %d has applied %d overheard packets \n", get_time()*0.000000001, to->object, nodedata->overheard_nbr);
+  }
 #endif
+  nodedata->overheard_nbr = 0;
+}
+
+/** \brief Callback function of the periodic cross-layer batch (to be used with the scheduler_add_callback function).
+ *  \fn int oracenet_neighbor_crosslayer_callback(call_t *to, call_t *from, void *args)
+ *  \param c is a pointer to the called entity
+ *  \param args is a pointer to the arguments of the function
+ *  \return 0 if success, -1 otherwise
+ **/
+int oracenet_neighbor_crosslayer_callback(call_t *to, call_t *from, void *args) {
+  struct nodedata *nodedata = get_node_private_data(to);
+
+  nodedata->overheard_scheduled = 0;
+  if (nodedata->overheard_nbr > 0) {
+    oracenet_neighbor_crosslayer_apply(to);
+    list_selective_delete(nodedata->neighbors, neighbor_timeout_management, (void *)to);
   }
   return 0;
 }
 
+
+/** \brief Function to update the local node neighbor table in ORACENET according to a received data packet.
+ *  \fn int neighbor_update_from_oracenet_data_packet(call_t *to, packet_t *packet, struct packet_header *header)
+ *  \param c is a pointer to the called entity
+ *  \param packet is a pointer to the received packet
+ *  \param header is a pointer to the packet header of the received packet
+ *  \return 0 if success, -1 otherwise
+ **/
+int neighbor_update_from_oracenet_data_packet(call_t *to, packet_t *packet, struct packet_header *header) {
+  return oracenet_neighbor_piggyback_update(to, packet, header, header->prevhop);
+}
+
+/** \brief Function to piggyback the hello fields on an outgoing data or advert packet (ORACENET).
+ *  The first broadcast packet sent since the last hello decision stands for the hello of the window.
+ *  A unicast packet only does when hello_piggyback_unicast is set, i.e. when the MAC layer reports the overheard frames.
+ *  \fn void oracenet_hello_piggyback(call_t *to, struct packet_header *header, int hop_to_sink, double prr, int broadcast)
+ *  \param c is a pointer to the called entity
+ *  \param header is a pointer to the packet header of the outgoing packet
+ *  \param hop_to_sink is the number of hops towards the sink
+ *  \param prr is the E2E PRR towards the sink
+ *  \param broadcast is set if the packet is broadcast
+ **/
+void oracenet_hello_piggyback(call_t *to, struct packet_header *header, int hop_to_sink, double prr, int broadcast) {
+  struct nodedata *nodedata = get_node_private_data(to);
+
+  header->hello_hop_to_sink = hop_to_sink;
+  header->hello_prr = prr;
+  header->hello_interval = neighbor_hello_interval(to);
+
+  /* the neighbors which are not the nexthop would see a missing beacon number */
+  if (!broadcast && nodedata->hello_piggyback_unicast == STATUS_OFF) {
+    header->hello_seq = -1;
+    return;
+  }
+
+  if (nodedata->last_tx_time <= nodedata->hello_window_start) {
+    header->hello_seq = nodedata->hello_seq++;
+  }
+  else {
+    header->hello_seq = -1;
+  }
+  nodedata->last_tx_time = get_time();
+}
+
+
+
 /** \brief Function to update the local node neighbor table in AODV according to a received AODV hello packet.
- *  \fn int neighbor_update_from_aodv_hello(call_t *to, packet_t *packet)
+ *  \fn int neighbor_update_from_aodv_hello(call_t *to, packet_t *packet, struct packet_header *header, struct hello_packet_header *hello_header)
  *  \param c is a pointer to the called entity
  *  \param packet is a pointer to the received packet
+ *  \param header is a pointer to the packet header of the received packet
+ *  \param hello_header is a pointer to the hello header of the received packet
  *  \return 0 if success, -1 otherwise
  **/
-int neighbor_update_from_aodv_hello(call_t *to, packet_t *packet) {
+int neighbor_update_from_aodv_hello(call_t *to, packet_t *packet, struct packet_header *header, struct hello_packet_header *hello_header) {
   struct nodedata *nodedata = get_node_private_data(to);
 
-  /* extract the network and hello headers */
-  field_t *field_header = packet_retrieve_field(packet, "packet_header");
-  struct packet_header* header = (struct packet_header*) field_getValue(field_header);
-  field_t *field_hello_header = packet_retrieve_field(packet, "hello_packet_header");
-  struct hello_packet_header* hello_header = (struct hello_packet_header*) field_getValue(field_hello_header);
   
   struct neighbor *neighbor = NULL;
   int current_slot, update = 0;
 
   /* clear the neighbor table from dead/unavailable neighbors */ 
-  list_selective_delete(nodedata->neighbors, neighbor_timeout_management, (void *)to);
+  list_selective_delete(nodedata->neighbors, neighbor_timeout_management_aodv, (void *)to);
  
   /* check if neighbor node already exist and update related information */
   list_init_traverse(nodedata->neighbors);
@@ -937,6 +1274,8 @@ int neighbor_update_from_aodv_hello(call_t *to, packet_t *packet) {
       neighbor->position.x = hello_header->position.x;
       neighbor->position.y = hello_header->position.y;
       neighbor->position.z = hello_header->position.z;
+      neighbor->hello_interval = hello_header->interval;
+      neighbor_hello_consistent(to);
       update = 1;
       break;
     }
@@ -959,7 +1298,11 @@ int neighbor_update_from_aodv_hello(call_t *to, packet_t *packet) {
     neighbor->position.x = hello_header->position.x;
     neighbor->position.y = hello_header->position.y;
     neighbor->position.z = hello_header->position.z;
+    neighbor->hello_interval = hello_header->interval;
     list_insert(nodedata->neighbors, (void *) neighbor);
+
+    /* a new neighbor is a topology change */
+    neighbor_hello_reset(to);
 #ifdef ROUTING_LOG_HELLO
     printf("[ROUTING_LOG_HELLO] Time %lfs node %d has discovered the neighbor %d \n", get_time()*0.000000001, to->object, neighbor->id);
 #endif
@@ -971,22 +1314,19 @@ int neighbor_update_from_aodv_hello(call_t *to, packet_t *packet) {
 
 
 /** \brief Function to update the local node neighbor table in OLSRv2 according to a received OLSRv2 hello packet.
- *  \fn int neighbor_update_from_olsrv2_hello(call_t *to, packet_t *packet)
+ *  \fn int neighbor_update_from_olsrv2_hello(call_t *to, packet_t *packet, struct packet_header *header, struct hello_packet_header *hello_header)
  *  \param c is a pointer to the called entity
  *  \param packet is a pointer to the received packet
+ *  \param header is a pointer to the packet header of the received packet
+ *  \param hello_header is a pointer to the hello header of the received packet
  *  \return 0 if success, -1 otherwise
 
  *  \ Updated by Dhafer BEN ARBIA in 9-5-2015
  **/
 
-int neighbor_update_from_olsrv2_hello(call_t *to, packet_t *packet) {
+int neighbor_update_from_olsrv2_hello(call_t *to, packet_t *packet, struct packet_header *header, struct hello_packet_header *hello_header) {
   struct nodedata *nodedata = get_node_private_data(to);
 
-  /* extract the network and hello headers */
-  field_t *field_header = packet_retrieve_field(packet, "packet_header");
-  struct packet_header* header = (struct packet_header*) field_getValue(field_header);
-  field_t *field_hello_header = packet_retrieve_field(packet, "hello_packet_header");
-  struct hello_packet_header* hello_header = (struct hello_packet_header*) field_getValue(field_hello_header);
   
   struct neighbor *neighbor = NULL;
   int current_slot, update = 0;
@@ -1005,7 +1345,7 @@ for (j=0; j<MAX_NEIGHBORS_SIZE; j++){
   /* update the neighbor 2 hop table */ 
   list_init_traverse(nodedata->neighbors);
   while((neighbor = (struct neighbor *) list_traverse(nodedata->neighbors)) != NULL) {
-      if ((get_time() - neighbor->time) >= nodedata->hello_timeout) {
+      if ((get_time() - neighbor->time) >= neighbor_hello_timeout(to, neighbor)) {
        	  /* remove neighbor from the 2 hop matrix */
 	  for(i = 0; i < MAX_NEIGHBORS_SIZE; i++) {							
 	   	nodedata->neighbors_2hops[neighbor->id][i] = -1; 
@@ -1041,8 +1381,10 @@ for (j=0; j<MAX_NEIGHBORS_SIZE; j++){
       neighbor->position.x = hello_header->position.x;
       neighbor->position.y = hello_header->position.y;
       neighbor->position.z = hello_header->position.z;
+      neighbor->hello_interval = hello_header->interval;
       neighbor->neighbors_2hop_nbr = 0;      
       
+      neighbor_hello_consistent(to);
       update = 1;
       
 
@@ -1079,6 +1421,7 @@ for (j=0; j<MAX_NEIGHBORS_SIZE; j++){
     neighbor->position.x = hello_header->position.x;
     neighbor->position.y = hello_header->position.y;
     neighbor->position.z = hello_header->position.z;
+    neighbor->hello_interval = hello_header->interval;
     neighbor->neighbors_2hop_nbr = 0;
     
 	
@@ -1094,6 +1437,9 @@ for (j=0; j<MAX_NEIGHBORS_SIZE; j++){
       nodedata->neighbors_2hops_nbr[neighbor->id][1]=0;
 
     list_insert(nodedata->neighbors, (void *) neighbor);
+
+    /* a new neighbor is a topology change */
+    neighbor_hello_reset(to);
 #ifdef ROUTING_LOG_HELLO
     printf("[ROUTING_LOG_HELLO] Time %lfs node %d has discovered the neighbor %d which has %d two hop neighbors \n", get_time()*0.000000001, to->object, neighbor->id, neighbor->neighbors_2hop_nbr);
 #endif
@@ -1114,28 +1460,30 @@ for (j=0; j<MAX_NEIGHBORS_SIZE; j++){
  *  \ Updated by Dhafer BEN ARBIA in 24-5-2015
  **/
 
-int route_update_from_tc(call_t *to, packet_t *packet) {
+int route_update_from_tc(call_t *to, struct packet_header *header, struct tc_packet_header *tc_header) {
 
 struct nodedata *nodedata = get_node_private_data(to);
 
-  /* extract the network and hello headers */
-  field_t *field_header = packet_retrieve_field(packet, "packet_header");
-  struct packet_header* header = (struct packet_header*) field_getValue(field_header);
-  field_t *field_tc_header = packet_retrieve_field(packet, "tc_packet_header");
-  struct tc_packet_header* tc_header = (struct tc_packet_header*) field_getValue(field_tc_header);
   int i = 0;
+  int link[MAX_NEIGHBORS_SIZE];
 
   printf("[ROUTING_LOG_TC] Node %d received TC PACKET from neighbor %d \n ", to->object, header->src);
 
-  // init connectivity matrix
+  // build the advertised links of the TC originator
   for (i=0; i<MAX_NEIGHBORS_SIZE; i++){
-		nodedata->topology_matrix[header->src][i] = 0;
+		link[i] = 0;
   }
-
-  // update connectivity matrix
   for (i=0; i<MAX_NEIGHBORS_SIZE; i++){
        if (tc_header->first_hop_neighbors[i] >=0) {
-		nodedata->topology_matrix[header->src][tc_header->first_hop_neighbors[i]] = 1;
+		link[tc_header->first_hop_neighbors[i]] = 1;
+       }
+  }
+
+  // update connectivity matrix and invalidate the routing table only on a real change
+  for (i=0; i<MAX_NEIGHBORS_SIZE; i++){
+       if (nodedata->topology_matrix[header->src][i] != link[i]) {
+		nodedata->topology_matrix[header->src][i] = link[i];
+		nodedata->olsr_topology_changed = 1;
        }
   }
 
@@ -1146,21 +1494,19 @@ struct nodedata *nodedata = get_node_private_data(to);
 
 
 /** \brief Function to update the local node neighbor table in AODV according to a received AODV based packet (RREQ, RREP, etc.).
- *  \fn int neighbor_update_from_aodv_packet(call_t *to, packet_t *packet)
+ *  \fn int neighbor_update_from_aodv_packet(call_t *to, packet_t *packet, struct packet_header *header)
  *  \param c is a pointer to the called entity
  *  \param packet is a pointer to the received packet
+ *  \param header is a pointer to the packet header of the received packet
  *  \return 0 if success, -1 otherwise
  **/
-int neighbor_update_from_aodv_packet(call_t *to, packet_t *packet) {
+int neighbor_update_from_aodv_packet(call_t *to, packet_t *packet, struct packet_header *header) {
   struct nodedata *nodedata = get_node_private_data(to);
   
-  /* extract the network and hello headers */
-  field_t *field_header = packet_retrieve_field(packet, "packet_header");
-  struct packet_header* header = (struct packet_header*) field_getValue(field_header);
   struct neighbor *neighbor = NULL;
 
   /* clear the neighbor table from dead/unavailable neighbors */ 
-  list_selective_delete(nodedata->neighbors, neighbor_timeout_management, (void *)to);
+  list_selective_delete(nodedata->neighbors, neighbor_timeout_management_aodv, (void *)to);
  
   /* check if neighbor node already exist and update related information */
   list_init_traverse(nodedata->neighbors);
@@ -1192,11 +1538,34 @@ int neighbor_timeout_management(void *data, void *arg) {
   
   /* extract the function argument */
   call_t *to = (call_t *) arg;
-  struct nodedata * nodedata = get_node_private_data(to);
 
   /* check if the neighbor entry is still valid */
-  if ((get_time() - neighbor->time) >= nodedata->hello_timeout) {
+  if ((get_time() - neighbor->time) >= neighbor_hello_timeout(to, neighbor)) {
 	route_remove_oracenet(to, neighbor->id);			// # ORACENET :remove the route depending on the removde neighbor
+	neighbor_hello_reset(to);
+    return 1;
+  }
+  
+  return 0;
+}
+
+
+/** \brief Function to remove from the local node neighbor table outdated neighbor entries and repair the related routes (AODV).
+ *  \fn int neighbor_timeout_management_aodv(void *data, void *arg)
+ *  \param data is a pointer to the neighbor entry
+ *  \param arg is a pointer to the function arguments
+ *  \return 1 if the entry is no longuer valid, 0 otherwise
+ **/
+int neighbor_timeout_management_aodv(void *data, void *arg) {
+  struct neighbor *neighbor = (struct neighbor *) data;
+  
+  /* extract the function argument */
+  call_t *to = (call_t *) arg;
+
+  /* check if the neighbor entry is still valid */
+  if ((get_time() - neighbor->time) >= neighbor_hello_timeout(to, neighbor)) {
+	route_aodv_link_failure(to, neighbor->id);		// remove or locally repair the routes through the lost neighbor
+	neighbor_hello_reset(to);
     return 1;
   }
   
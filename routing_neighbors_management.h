@@ -7,6 +7,70 @@
 #ifndef  __routing_neighbors_management__
 #define __routing_neighbors_management__
 
+/** \brief Function to decide whether a periodic hello packet has to be built and sent.
+ *  \fn int neighbor_hello_should_send(call_t *to)
+ *  \param c is a pointer to the called entity
+ *  \return 1 if the hello packet has to be sent, 0 otherwise
+ **/
+int neighbor_hello_should_send(call_t *to);
+
+/** \brief Function to start the hello protocol, either periodic or driven by a Trickle timer (when hello_imax > 0).
+ *  \fn void neighbor_hello_start(call_t *to, call_t *from, int (*callback)(call_t *, call_t *, void *))
+ *  \param c is a pointer to the called entity
+ *  \param from is a pointer to the calling entity
+ *  \param callback is the hello callback of the routing protocol
+ **/
+void neighbor_hello_start(call_t *to, call_t *from, int (*callback)(call_t *, call_t *, void *));
+
+/** \brief Function to schedule the next hello packet transmission, at the next slot or in the next (doubled) Trickle interval.
+ *  \fn void neighbor_hello_schedule(call_t *to, call_t *from, int (*callback)(call_t *, call_t *, void *))
+ *  \param c is a pointer to the called entity
+ *  \param from is a pointer to the calling entity
+ *  \param callback is the hello callback of the routing protocol
+ **/
+void neighbor_hello_schedule(call_t *to, call_t *from, int (*callback)(call_t *, call_t *, void *));
+
+/** \brief Function to check that a hello callback has not been outdated by a reset of the Trickle timer.
+ *  \fn int neighbor_hello_is_pending(call_t *to, void *args)
+ *  \param c is a pointer to the called entity
+ *  \param args is the argument the hello callback was scheduled with
+ *  \return 1 if the callback is still valid, 0 otherwise
+ **/
+int neighbor_hello_is_pending(call_t *to, void *args);
+
+/** \brief Function to count a hello packet bringing no topology change (Trickle consistent transmission).
+ *  \fn void neighbor_hello_consistent(call_t *to)
+ *  \param c is a pointer to the called entity
+ **/
+void neighbor_hello_consistent(call_t *to);
+
+/** \brief Function to reset the Trickle timer to its minimal interval on a topology change (new or lost neighbor).
+ *  \fn void neighbor_hello_reset(call_t *to)
+ *  \param c is a pointer to the called entity
+ **/
+void neighbor_hello_reset(call_t *to);
+
+/** \brief Function to get the hello interval advertised to the neighbors: the hello period, or the Trickle interval of the next hello.
+ *  \fn uint64_t neighbor_hello_interval(call_t *to)
+ *  \param c is a pointer to the called entity
+ *  \return the advertised hello interval
+ **/
+uint64_t neighbor_hello_interval(call_t *to);
+
+/** \brief Function to get the timeout of a neighbor entry, scaled with the hello interval advertised by the neighbor.
+ *  \fn uint64_t neighbor_hello_timeout(call_t *to, struct neighbor *neighbor)
+ *  \param c is a pointer to the called entity
+ *  \param neighbor is a pointer to the neighbor entry
+ *  \return the neighbor entry timeout
+ **/
+uint64_t neighbor_hello_timeout(call_t *to, struct neighbor *neighbor);
+
+/** \brief Function to decide whether a periodic TC packet has to be built and sent (OLSRv2).
+ *  \fn int tc_should_send(call_t *to)
+ *  \param c is a pointer to the called entity
+ *  \return 1 if the TC packet has to be sent, 0 otherwise
+ **/
+int tc_should_send(call_t *to);
 
 /** \brief Callback function for the periodic hello packet transmission in Directed Diffusion (to be used with the scheduler_add_callback function).
  *  \fn int neighbor_discovery_callback_directed_diffusion(call_t *to, void *args)
@@ -56,30 +120,35 @@ int neighbor_discovery_callback_olsrv2(call_t *to, call_t *from, void *args);
 int tc_broadcast_olsrv2(call_t *to, call_t *from, void *args);
 
 /** \brief Function to update the local node neighbor table in Directed Diffusion according to a received hello packet.
- *  \fn int neighbor_update(call_t *to, packet_t *packet)
+ *  \fn int neighbor_update(call_t *to, packet_t *packet, struct packet_header *header, struct hello_packet_header *hello_header)
  *  \param c is a pointer to the called entity
  *  \param packet is a pointer to the received packet
+ *  \param header is a pointer to the packet header of the received packet
+ *  \param hello_header is a pointer to the hello header of the received packet
  *  \return 0 if success, -1 otherwise
  **/
-int neighbor_update(call_t *to, packet_t *packet);
+int neighbor_update(call_t *to, packet_t *packet, struct packet_header *header, struct hello_packet_header *hello_header);
 
 
 /** \brief Function to update the local node neighbor table in AODV according to a received AODV based packet (RREQ, RREP, etc.).
- *  \fn int neighbor_update_from_aodv_packet(call_t *to, packet_t *packet)
+ *  \fn int neighbor_update_from_aodv_packet(call_t *to, packet_t *packet, struct packet_header *header)
  *  \param c is a pointer to the called entity
  *  \param packet is a pointer to the received packet
+ *  \param header is a pointer to the packet header of the received packet
  *  \return 0 if success, -1 otherwise
  **/
-int neighbor_update_from_aodv_packet(call_t *to, packet_t *packet);
+int neighbor_update_from_aodv_packet(call_t *to, packet_t *packet, struct packet_header *header);
 
 
 /** \brief Function to update the local node neighbor table in AODV according to a received AODV hello packet.
- *  \fn int neighbor_update_from_aodv_hello(call_t *to, packet_t *packet)
+ *  \fn int neighbor_update_from_aodv_hello(call_t *to, packet_t *packet, struct packet_header *header, struct hello_packet_header *hello_header)
  *  \param c is a pointer to the called entity
  *  \param packet is a pointer to the received packet
+ *  \param header is a pointer to the packet header of the received packet
+ *  \param hello_header is a pointer to the hello header of the received packet
  *  \return 0 if success, -1 otherwise
  **/
-int neighbor_update_from_aodv_hello(call_t *to, packet_t *packet);
+int neighbor_update_from_aodv_hello(call_t *to, packet_t *packet, struct packet_header *header, struct hello_packet_header *hello_header);
 
 
 /** Update neighbor list from OLSRv2 Hello message
@@ -87,16 +156,18 @@ int neighbor_update_from_aodv_hello(call_t *to, packet_t *packet);
 
 
 /** \brief Function to update the local node neighbor table in AODV according to a received AODV hello packet.
- *  \fn int neighbor_update_from_aodv_hello(call_t *to, packet_t *packet)
+ *  \fn int neighbor_update_from_aodv_hello(call_t *to, packet_t *packet, struct packet_header *header, struct hello_packet_header *hello_header)
  *  \param c is a pointer to the called entity
  *  \param packet is a pointer to the received packet
+ *  \param header is a pointer to the packet header of the received packet
+ *  \param hello_header is a pointer to the hello header of the received packet
  *  \return 0 if success, -1 otherwise
  *  \ Updated by Dhafer BEN ARBIA May-2015
  **/
-int neighbor_update_from_olsrv2_hello(call_t *to, packet_t *packet);
+int neighbor_update_from_olsrv2_hello(call_t *to, packet_t *packet, struct packet_header *header, struct hello_packet_header *hello_header);
 
 
-int route_update_from_tc(call_t *to, packet_t *packet);
+int route_update_from_tc(call_t *to, struct packet_header *header, struct tc_packet_header *tc_header);
 
 
 /** \brief Function to remove from the local node neighbor table outdated neighbor entries.
@@ -108,6 +179,15 @@ int route_update_from_tc(call_t *to, packet_t *packet);
 int neighbor_timeout_management(void *data, void *arg);
 
 
+/** \brief Function to remove from the local node neighbor table outdated neighbor entries and repair the related routes (AODV).
+ *  \fn int neighbor_timeout_management_aodv(void *data, void *arg)
+ *  \param data is a pointer to the neighbor entry
+ *  \param arg is a pointer to the function arguments
+ *  \return 1 if the entry is no longuer valid, 0 otherwise
+ **/
+int neighbor_timeout_management_aodv(void *data, void *arg);
+
+
 /** \brief Function to count hops to the standard output the local neighbor table.
  *  \fn  int neighbor_hop_count(call_t *to)
  *  \param c is a pointer to the called entity
@@ -136,13 +216,126 @@ void neighbor_2hops_list(call_t *to);
  **/
 void get_all_2hop_neighbors(call_t *to, int T[MAX_NEIGHBORS_SIZE]);
 
-int neighbor_update_from_oracenet_data_packet(call_t *to, packet_t *packet, int prevhop);
+int neighbor_update_from_oracenet_data_packet(call_t *to, packet_t *packet, struct packet_header *header);
 
-int oracenet_neighbor_update(call_t *to, packet_t *packet);
+int oracenet_neighbor_update(call_t *to, packet_t *packet, struct packet_header *header, struct hello_packet_header *hello_header);
 
 int neighbor_discovery_callback_oracenet(call_t *to, call_t *from, void *args);
 
 /* Cross layer neighbor update for ORACENET */
-int oracenet_neighbor_crosslayer_update(call_t *to, packet_t *packet, int prevhop);
+
+/** \brief Function to buffer a packet overheard and filtered by the MAC layer until the next cross-layer batch (ORACENET).
+ *  \fn void oracenet_neighbor_crosslayer_record(call_t *to, struct overheard_record *record)
+ *  \param c is a pointer to the called entity
+ *  \param record is a pointer to the record of the overheard packet
+ **/
+void oracenet_neighbor_crosslayer_record(call_t *to, struct overheard_record *record);
+
+/** \brief Function to apply the buffered overheard packets to the local neighbor table (ORACENET).
+ *  \fn void oracenet_neighbor_crosslayer_apply(call_t *to)
+ *  \param c is a pointer to the called entity
+ **/
+void oracenet_neighbor_crosslayer_apply(call_t *to);
+
+/** \brief Callback function of the periodic cross-layer batch (to be used with the scheduler_add_callback function).
+ *  \fn int oracenet_neighbor_crosslayer_callback(call_t *to, call_t *from, void *args)
+ *  \param c is a pointer to the called entity
+ *  \param args is a pointer to the arguments of the function
+ *  \return 0 if success, -1 otherwise
+ **/
+int oracenet_neighbor_crosslayer_callback(call_t *to, call_t *from, void *args);
+
+/** \brief Function to reset the link quality estimator state of a neighbor entry (ORACENET).
+ *  \fn void lqe_init(call_t *to, struct neighbor *neighbor)
+ *  \param c is a pointer to the called entity
+ *  \param neighbor is a pointer to the neighbor entry
+ **/
+void lqe_init(call_t *to, struct neighbor *neighbor);
+
+/** \brief Windowed PRR estimator: ratio of received beacons among the last lqe_w ones, kept in a bitmap.
+ *  \fn double lqe_update_prr(call_t *to, struct neighbor *neighbor, int lost)
+ *  \param c is a pointer to the called entity
+ *  \param neighbor is a pointer to the neighbor entry
+ *  \param lost is the number of beacons lost before the received one
+ *  \return the new link quality estimate
+ **/
+double lqe_update_prr(call_t *to, struct neighbor *neighbor, int lost);
+
+/** \brief EWMA estimator: every beacon, lost or received, is smoothed in with the lqe_alpha factor.
+ *  \fn double lqe_update_ewma(call_t *to, struct neighbor *neighbor, int lost)
+ *  \param c is a pointer to the called entity
+ *  \param neighbor is a pointer to the neighbor entry
+ *  \param lost is the number of beacons lost before the received one
+ *  \return the new link quality estimate
+ **/
+double lqe_update_ewma(call_t *to, struct neighbor *neighbor, int lost);
+
+/** \brief WMEWMA estimator: the PRR of each window of lqe_w beacons is smoothed in with the lqe_alpha factor.
+ *  \fn double lqe_update_wmewma(call_t *to, struct neighbor *neighbor, int lost)
+ *  \param c is a pointer to the called entity
+ *  \param neighbor is a pointer to the neighbor entry
+ *  \param lost is the number of beacons lost before the received one
+ *  \return the new link quality estimate
+ **/
+double lqe_update_wmewma(call_t *to, struct neighbor *neighbor, int lost);
+
+/** \brief Function to feed the link quality estimator selected by lqe_estimator with a received beacon (ORACENET).
+ *  \fn void lqe_update(call_t *to, struct neighbor *neighbor, int lost)
+ *  \param c is a pointer to the called entity
+ *  \param neighbor is a pointer to the neighbor entry
+ *  \param lost is the number of beacons lost before the received one
+ **/
+void lqe_update(call_t *to, struct neighbor *neighbor, int lost);
+
+/** \brief Function to account a beacon (hello, or hello fields piggybacked on a data or advert packet) in the link quality estimate of its sender (ORACENET).
+ *  \fn void oracenet_neighbor_prr_update(call_t *to, struct neighbor *neighbor, int hello_seq)
+ *  \param c is a pointer to the called entity
+ *  \param neighbor is a pointer to the sender entry in the neighbor table
+ *  \param hello_seq is the beacon number carried by the packet (-1 if the packet does not stand for a hello)
+ **/
+void oracenet_neighbor_prr_update(call_t *to, struct neighbor *neighbor, int hello_seq);
+
+/** \brief Function to look up the local neighbor entry of a node, created if needed (ORACENET).
+ *  \fn struct neighbor *oracenet_neighbor_lookup(call_t *to, int id, int type, double rxdbm, uint64_t time)
+ *  \param c is a pointer to the called entity
+ *  \param id is the neighbor node ID
+ *  \param type is the neighbor node type
+ *  \param rxdbm is the received power of the packet sent by the neighbor
+ *  \param time is the reception time of the packet sent by the neighbor
+ *  \return a pointer to the neighbor entry
+ **/
+struct neighbor *oracenet_neighbor_lookup(call_t *to, int id, int type, double rxdbm, uint64_t time);
+
+/** \brief Function to get the local neighbor entry of the sender of a received packet, created if needed (ORACENET).
+ *  \fn struct neighbor *oracenet_neighbor_get(call_t *to, packet_t *packet, struct packet_header *header, int id)
+ *  \param c is a pointer to the called entity
+ *  \param packet is a pointer to the received packet
+ *  \param header is a pointer to the packet header of the received packet
+ *  \param id is the neighbor node ID
+ *  \return a pointer to the neighbor entry
+ **/
+struct neighbor *oracenet_neighbor_get(call_t *to, packet_t *packet, struct packet_header *header, int id);
+
+/** \brief Function to update the local node neighbor table in ORACENET according to the hello fields piggybacked on a data or advert packet.
+ *  \fn int oracenet_neighbor_piggyback_update(call_t *to, packet_t *packet, struct packet_header *header, int sender)
+ *  \param c is a pointer to the called entity
+ *  \param packet is a pointer to the received packet
+ *  \param header is a pointer to the packet header of the received packet
+ *  \param sender is the ID of the last sender of the packet
+ *  \return 0 if success, -1 otherwise
+ **/
+int oracenet_neighbor_piggyback_update(call_t *to, packet_t *packet, struct packet_header *header, int sender);
+
+/** \brief Function to piggyback the hello fields on an outgoing data or advert packet (ORACENET).
+ *  The first broadcast packet sent since the last hello decision stands for the hello of the window.
+ *  A unicast packet only does when hello_piggyback_unicast is set, i.e. when the MAC layer reports the overheard frames.
+ *  \fn void oracenet_hello_piggyback(call_t *to, struct packet_header *header, int hop_to_sink, double prr, int broadcast)
+ *  \param c is a pointer to the called entity
+ *  \param header is a pointer to the packet header of the outgoing packet
+ *  \param hop_to_sink is the number of hops towards the sink
+ *  \param prr is the E2E PRR towards the sink
+ *  \param broadcast is set if the packet is broadcast
+ **/
+void oracenet_hello_piggyback(call_t *to, struct packet_header *header, int hop_to_sink, double prr, int broadcast);
 
 #endif  
@@ -45,6 +45,39 @@ typedef int header_src_t;
     }
 
 
+/** \brief Function to resolve the packet header handles into field names, once per class (to be called by init())
+ *  \fn void packet_header_fields_init(struct classdata *classdata)
+ *  \param classdata is a pointer to the class data
+ **/
+void packet_header_fields_init(struct classdata *classdata) {
+  classdata->header_fields[HEADER_FIELD_PACKET] = "packet_header";
+  classdata->header_fields[HEADER_FIELD_HELLO] = "hello_packet_header";
+  classdata->header_fields[HEADER_FIELD_TC] = "tc_packet_header";
+  classdata->header_fields[HEADER_FIELD_SINK_INTEREST] = "sink_interest_packet_header";
+  classdata->header_fields[HEADER_FIELD_SINK_INTEREST_AGGREGATE] = "sink_interest_aggregate_header";
+  classdata->header_fields[HEADER_FIELD_RREQ] = "rreq_packet_header";
+  classdata->header_fields[HEADER_FIELD_RREP] = "rrep_packet_header";
+  classdata->header_fields[HEADER_FIELD_DATA_AGGREGATE] = "data_aggregate_header";
+}
+
+/** \brief Function to retrieve a header of a packet from its handle
+ *  \fn void* packet_header_get(call_t *to, packet_t *packet, int handle)
+ *  \param c is a pointer to the called entity
+ *  \param packet is a pointer to the packet
+ *  \param handle is the handle of the header (HEADER_FIELD_*)
+ *  \return a pointer to the header, NULL if the packet does not carry it
+ **/
+void* packet_header_get(call_t *to, packet_t *packet, int handle) {
+  struct classdata *classdata = get_class_private_data(to);
+  field_t *field = packet_retrieve_field(packet, classdata->header_fields[handle]);
+
+  if (field == NULL) {
+    return NULL;
+  }
+  return field_getValue(field);
+}
+
+
 /** \brief Function to forward received data packet towards the destination (Directed Diffusion)
  *  \fn void route_forward_advert_packet(call_t *to, packet_t *packet)
  *  \param c is a pointer to the called entity
@@ -54,8 +87,7 @@ void route_forward_interest_packet(call_t *to, call_t *from, packet_t *packet) {
   struct nodedata *nodedata = get_node_private_data(to);
   struct classdata *classdata = get_class_private_data(to);
   
-  field_t *field_header = packet_retrieve_field(packet, "packet_header");
-  struct packet_header* header = (struct packet_header*) field_getValue(field_header);
+  struct packet_header* header = (struct packet_header*) packet_header_get(to, packet, HEADER_FIELD_PACKET);
   
   destination_t destination;
   call_t to0   = {get_class_bindings_down(to)->elts[0], to->object};
@@ -109,28 +141,31 @@ void route_forward_data_packet(call_t *to, call_t *from, packet_t *packet) {
   struct nodedata *nodedata = get_node_private_data(to);
   struct classdata *classdata = get_class_private_data(to);
   
-  field_t *field_header = packet_retrieve_field(packet, "packet_header");
-  struct packet_header* header = (struct packet_header*) field_getValue(field_header);
+  struct packet_header* header = (struct packet_header*) packet_header_get(to, packet, HEADER_FIELD_PACKET);
 
   destination_t destination;
   call_t to0   = {get_class_bindings_down(to)->elts[0], to->object};
   call_t from0 = {to->class, to->object};
   
-  struct route *route = route_get_nexthop(to, header->dst);
+  struct gradient_entry *entry = gradient_lookup(to, header->sink_id, header->data_type, 0);
+  struct gradient *gradient = gradient_get_nexthop(to, entry);
   
-  /* destroy data packet if no route towards the sink */
-  if (route == NULL) {
+  /* destroy data packet if no gradient towards the sink */
+  if (gradient == NULL) {
 #ifdef ROUTING_LOG_DATA_FORWARDING  
-    printf("[ROUTING_LOG_DATA_FORWARDING] node %d => no route towards sink %d : data packet destroyed\n", to->object, header->dst);
+    printf("[ROUTING_LOG_DATA_FORWARDING] node %d => no route towards sink %d : data packet destroyed\n", to->object, header->sink_id);
 #endif
     packet_dealloc(packet);
     return;
   }
+
+  /* remember where the data comes from, for the propagation of the reinforcements */
+  entry->upstream = header->prevhop;
   
-  header->nexthop = route->nexthop_id;
+  header->nexthop = gradient->neighbor;
   header->prevhop = to->object;
 
-  destination.id = route->nexthop_id;
+  destination.id = gradient->neighbor;
   destination.position.x = -1;
   destination.position.y = -1;
   destination.position.z = -1;
@@ -166,21 +201,13 @@ void route_forward_oracenet_data_packet(call_t *to, call_t *from, packet_t *pack
   struct nodedata *nodedata = get_node_private_data(to);
   struct classdata *classdata = get_class_private_data(to);
   
-  field_t *field_header = packet_retrieve_field(packet, "packet_header");
-  struct packet_header* header = (struct packet_header*) field_getValue(field_header);
+  struct packet_header* header = (struct packet_header*) packet_header_get(to, packet, HEADER_FIELD_PACKET);
 
   destination_t destination;
   call_t to0   = {get_class_bindings_down(to)->elts[0], to->object};
   call_t from0 = {to->class, to->object};
 
-  printf("ggg Before get nexthop\n");
-  struct route *route = route_get_nexthop_to_destination_oracenet(to, header->dst);
-  header->nexthop = route->nexthop_id;
-  /* Update the LQE Parameters */
-  route_update_oracenet_prr(to, packet, header->nexthop);
-  
-  /* Update Value of the route->E2E_PRR */
-  route->E2E_PRR = header->E2E_PRR;
+  struct route *route = route_select_oracenet(to, header->dst);
 
   /* destroy data packet if no route towards the sink */
   if (route == NULL) {
@@ -190,8 +217,14 @@ void route_forward_oracenet_data_packet(call_t *to, call_t *from, packet_t *pack
     packet_dealloc(packet);
     return;
   }
-  
+
   header->nexthop = route->nexthop_id;
+  /* Update the LQE Parameters */
+  route_update_oracenet_prr(to, header, header->nexthop);
+  
+  /* Update Value of the route->E2E_PRR */
+  route->E2E_PRR = header->E2E_PRR;
+  
   header->prevhop = to->object;
   destination.id = route->nexthop_id;
   destination.position.x = -1;
@@ -206,6 +239,9 @@ void route_forward_oracenet_data_packet(call_t *to, call_t *from, packet_t *pack
     return;
   }  
 
+  /* the data packet carries the hello fields */
+  oracenet_hello_piggyback(to, header, route->hop_to_sink, route->E2E_PRR, 0);
+
   /* send the data packet to the nexthop */ 
   TX(&to0, &from0, packet);
   
@@ -229,8 +265,7 @@ void route_forward_data_packet_to_destination(call_t *to, call_t *from, packet_t
   struct nodedata *nodedata = get_node_private_data(to);
   struct classdata *classdata = get_class_private_data(to);
   
-  field_t *field_header = packet_retrieve_field(packet, "packet_header");
-  struct packet_header* header = (struct packet_header*) field_getValue(field_header);
+  struct packet_header* header = (struct packet_header*) packet_header_get(to, packet, HEADER_FIELD_PACKET);
   
   destination_t destination; 
   
@@ -239,8 +274,19 @@ void route_forward_data_packet_to_destination(call_t *to, call_t *from, packet_t
   
   struct route_aodv *route = route_get_nexthop_to_destination(to, header->end_dst);
   
-  /* destroy data packet if no route towards the sink */
+  /* no route towards the destination */
   if (route == NULL) {
+    /* local repair: keep the data packet until a new route is discovered */
+    if (nodedata->local_repair_status == STATUS_ON) {
+#ifdef ROUTING_LOG_DATA_FORWARDING 
+      printf("[ROUTING_LOG_DATA_FORWARDING] node %d => no route towards DST %d : data packet buffered, local repair...\n", to->object, header->end_dst);
+#endif
+      route_pending_insert(to, packet, header->end_dst);
+      rreq_route_discovery(to, header->end_dst);
+      return;
+    }
+
+    /* otherwise destroy the data packet */
 #ifdef ROUTING_LOG_DATA_FORWARDING 
     printf("[ROUTING_LOG_DATA_FORWARDING] node %d => no route towards DST %d : data packet destroyed...\n", to->object, header->end_dst);
     route_aodv_show(to);
@@ -248,6 +294,10 @@ void route_forward_data_packet_to_destination(call_t *to, call_t *from, packet_t
     packet_dealloc(packet);
     return;
   }
+
+  /* the previous hop now depends on this route, which stays active while in use */
+  route_aodv_add_precursor(to, route, header->prevhop);
+  route_aodv_refresh(to, route);
   
   destination.id = route->nexthop_id;
   destination.position.x = -1;
@@ -262,6 +312,9 @@ void route_forward_data_packet_to_destination(call_t *to, call_t *from, packet_t
 
   /* Update data packet header before forward */
   //header->hop = header->hop + 1;
+  header->dst = route->nexthop_id;
+  header->prevhop = to->object;
+
   /* send the data packet to the nexthop */ 
   TX(&to0, &from0, packet);
   
@@ -288,11 +341,9 @@ int route_forward_rrep_packet(call_t *to, call_t *from, packet_t* packet) {
   struct nodedata *nodedata = get_node_private_data(to);
   struct classdata *classdata = get_class_private_data(to);
   
-  field_t *field_header = packet_retrieve_field(packet, "packet_header");
-  struct packet_header* header = (struct packet_header*) field_getValue(field_header);
+  struct packet_header* header = (struct packet_header*) packet_header_get(to, packet, HEADER_FIELD_PACKET);
   
-  field_t *field_rrep_header = packet_retrieve_field(packet, "rrep_packet_header");
-  struct rrep_packet_header* rrep_header = (struct rrep_packet_header*) field_getValue(field_rrep_header);
+  struct rrep_packet_header* rrep_header = (struct rrep_packet_header*) packet_header_get(to, packet, HEADER_FIELD_RREP);
   
   call_t to0   = {get_class_bindings_down(to)->elts[0], to->object};
   call_t from0 = {to->class, to->object};
@@ -323,6 +374,13 @@ int route_forward_rrep_packet(call_t *to, call_t *from, packet_t* packet) {
   /* update basic packet header */
   header->src = to->object;
   header->type = nodedata->node_type;
+
+  /* the nexthop towards the source will use the route towards the RREP originator, and vice versa */
+  struct route_aodv *route_src = route_get_nexthop_to_destination(to, rrep_header->src);
+  if (route_src != NULL) {
+    route_aodv_add_precursor(to, route_src, route->nexthop_id);
+    route_aodv_add_precursor(to, route, route_src->nexthop_id);
+  }
   
 #ifdef ROUTING_LOG_RREP_PROPAGATION
   printf("[ROUTING_LOG_RREP_PROPAGATION] Time %lfs node %d forwards RREP towards SRC node %d via nexthop node %d (hop_to_dst=%d) \n", get_time()*0.000000001, to->object, rrep_header->dst, route->nexthop_id, route->hop_to_dst);
@@ -482,19 +540,16 @@ int route_update_from_oracenet_hello_packet(call_t *to, struct packet_header *he
 
 
 /** \brief Function to update the local routing table according to received interest packets
- *  \fn  int route_update_from_interest(call_t *to, packet_t *packet)
+ *  \fn  int route_update_from_interest(call_t *to, struct packet_header *header, struct sink_interest_packet_header *interest_header)
  *  \param c is a pointer to the called entity
- *  \param packet is a pointer to the received packet
+ *  \param header is a pointer to the packet header of the received packet
+ *  \param interest_header is a pointer to the interest header of the received packet
  *  \return 0 if success, -1 otherwise
  **/
-int route_update_from_interest(call_t *to, packet_t *packet) {
+int route_update_from_interest(call_t *to, struct packet_header *header, struct sink_interest_packet_header *interest_header) {
   struct nodedata *nodedata = get_node_private_data(to);
   
-  field_t *field_header = packet_retrieve_field(packet, "packet_header");
-  struct packet_header* header = (struct packet_header*) field_getValue(field_header);
   
-  field_t *field_interest_header = packet_retrieve_field(packet, "sink_interest_packet_header");
-  struct sink_interest_packet_header* interest_header = (struct sink_interest_packet_header*) field_getValue(field_interest_header);
   
   struct route *route;
   int updated = 0;
@@ -547,57 +602,51 @@ int route_update_from_interest(call_t *to, packet_t *packet) {
 }
 
 
+/** \brief Function to update the local routing table according to a received interest and to release the data packets waiting for this sink (ORACENET)
+ *  \fn  int route_update_from_oracenet_interest(call_t *to, struct packet_header *header, struct sink_interest_packet_header *interest_header)
+ *  \param c is a pointer to the called entity
+ *  \param header is a pointer to the packet header of the received packet
+ *  \param interest_header is a pointer to the interest header of the received packet
+ *  \return 0 if success, -1 otherwise
+ **/
+int route_update_from_oracenet_interest(call_t *to, struct packet_header *header, struct sink_interest_packet_header *interest_header) {
+  route_update_from_interest(to, header, interest_header);
+
+  /* send the data packets waiting for a route towards this sink */
+  route_pending_flush_oracenet(to, interest_header->sink_id);
+  return 0;
+}
+
+
 /** \brief Function to update the local routing table according to received RREQ packets
- *  \fn  int route_update_from_rreq(call_t *to, packet_t *packet)
+ *  \fn  int route_update_from_rreq(call_t *to, struct packet_header *header, struct rreq_packet_header *rreq_header)
  *  \param c is a pointer to the called entity
- *  \param packet is a pointer to the received packet
+ *  \param header is a pointer to the packet header of the received packet
+ *  \param rreq_header is a pointer to the RREQ header of the received packet
  *  \return 0 if success, -1 otherwise
  **/
-int route_update_from_rreq(call_t *to, packet_t *packet) {
-  struct nodedata *nodedata = get_node_private_data(to);
-  
-  field_t *field_header = packet_retrieve_field(packet, "packet_header");
-  struct packet_header* header = (struct packet_header*) field_getValue(field_header);
-  field_t *field_rreq_header = packet_retrieve_field(packet, "rreq_packet_header");
-  struct rreq_packet_header* rreq_header = (struct rreq_packet_header*) field_getValue(field_rreq_header);
-  
+int route_update_from_rreq(call_t *to, struct packet_header *header, struct rreq_packet_header *rreq_header) {
   struct route_aodv *route;
-  int updated = 0;
 
   if (to->object == rreq_header->src){
     return 0;
   }
   
   /* check if a nexthop to the dst already exist and update related information */
-  list_init_traverse(nodedata->routing_table);
-  while((route = (struct route_aodv *) list_traverse(nodedata->routing_table)) != NULL) {
+  if ((route = route_get_nexthop_to_destination(to, rreq_header->src)) != NULL) {
   
     /* the dst is present in routing table */    
-    if (route->dst == rreq_header->src && rreq_header->seq >= route->seq_rreq && (route->hop_to_dst > (rreq_header->ttl_max - (rreq_header->ttl - 1))) ) {
+    if (rreq_header->seq >= route->seq_rreq && (route->hop_to_dst > (rreq_header->ttl_max - (rreq_header->ttl - 1))) ) {
       route->nexthop_id = header->src;
       route->hop_to_dst = rreq_header->ttl_max - (rreq_header->ttl - 1);
-      updated = 1;
+      route_aodv_refresh(to, route);
 #ifdef ROUTING_LOG_ROUTES
       //      printf("[ROUTING_LOG_ROUTES] From rreq: Time %lfs at node %d: the route to DST %d has been updated (new nexthop: %d, %d hops) !\n", get_time()*0.000000001, to->object, route->dst, route->nexthop_id, route->hop_to_dst);
 #endif
-      break;
-    }
-    else if (route->dst == rreq_header->src) {
-      updated = 1;
-      break;
     }
   }
-
-  if (updated == 0) {
-    route = (struct route_aodv *) malloc(sizeof(struct route_aodv));
-    route->dst = rreq_header->src;
-    route->nexthop_id = header->src;
-    route->nexthop_lqe = 1.0;
-    route->time = get_time();
-    route->seq_rreq = rreq_header->seq;
-    route->seq_rrep = -1;
-    route->hop_to_dst = rreq_header->ttl_max - (rreq_header->ttl - 1);
-    list_insert(nodedata->routing_table, (void *) route); 
+  else {
+    route = route_aodv_insert(to, rreq_header->src, header->src, rreq_header->ttl_max - (rreq_header->ttl - 1), rreq_header->seq);
 
     #ifdef ROUTING_LOG_ROUTES
     printf("[ROUTING_LOG_ROUTES] From rreq: Time %lfs at node %d: a new route has been added towards DST %d through sensor %d (%d hops) !\n", get_time()*0.000000001, to->object, route->dst, route->nexthop_id, route->hop_to_dst);
@@ -605,67 +654,50 @@ int route_update_from_rreq(call_t *to, packet_t *packet) {
 
   }
 
+  /* send the data packets waiting for this (reverse) route */
+  route_pending_flush(to, rreq_header->src, route_forward_data_packet_to_destination);
+
   return 0;
 }
 
 /** \brief Function to update the local routing table according to received RREP packets
- *  \fn  int route_update_from_rrep(call_t *to, packet_t *packet)
+ *  \fn  int route_update_from_rrep(call_t *to, struct packet_header *header, struct rrep_packet_header *rrep_header)
  *  \param c is a pointer to the called entity
- *  \param packet is a pointer to the received packet
+ *  \param header is a pointer to the packet header of the received packet
+ *  \param rrep_header is a pointer to the RREP header of the received packet
  *  \return 0 if success, -1 otherwise
  **/
-int route_update_from_rrep(call_t *to, packet_t *packet) {
-  struct nodedata *nodedata = get_node_private_data(to);
-  
-  field_t *field_header = packet_retrieve_field(packet, "packet_header");
-  struct packet_header* header = (struct packet_header*) field_getValue(field_header);
-  field_t *field_rrep_header = packet_retrieve_field(packet, "rrep_packet_header");
-  struct rrep_packet_header* rrep_header = (struct rrep_packet_header*) field_getValue(field_rrep_header);
-  
+int route_update_from_rrep(call_t *to, struct packet_header *header, struct rrep_packet_header *rrep_header) {
   struct route_aodv *route;
-  int updated = 0;
 
   if (to->object == rrep_header->src){
     return 0;
   }
    
   /* check if a nexthop to the sink already exist and update related information */
-  list_init_traverse(nodedata->routing_table);
-  
-  while((route = (struct route_aodv *) list_traverse(nodedata->routing_table)) != NULL) {
+  if ((route = route_get_nexthop_to_destination(to, rrep_header->src)) != NULL) {
   
     /* the dst is present in routing table */    
-    if (route->dst == rrep_header->src && rrep_header->seq >= route->seq_rreq && route->hop_to_dst > rrep_header->hop_to_dst ) {
+    if (rrep_header->seq >= route->seq_rreq && route->hop_to_dst > rrep_header->hop_to_dst ) {
       route->nexthop_id = header->src;
       route->hop_to_dst = rrep_header->hop_to_dst;
-      updated = 1;
+      route_aodv_refresh(to, route);
 #ifdef ROUTING_LOG_ROUTES
       //      printf("[ROUTING_LOG_ROUTES] From rrep: Time %lfs at node %d: the route to DST %d has been updated (new nexthop: %d, %d hops) !\n", get_time()*0.000000001, to->object, route->dst, route->nexthop_id, route->hop_to_dst);
 #endif
-      break;
-    }
-    else if (route->dst == rrep_header->src){
-      updated = 1;
-      break;
     }
   }
-
-  if (updated == 0) {
-    route = (struct route_aodv *) malloc(sizeof(struct route_aodv));
-    route->dst = rrep_header->src;
-    route->nexthop_id = header->src;
-    route->nexthop_lqe = 1.0;
-    route->time = get_time();
-    route->seq_rreq = rrep_header->seq;
-    route->seq_rrep = -1;
-    route->hop_to_dst = rrep_header->hop_to_dst;
-    list_insert(nodedata->routing_table, (void *) route); 
+  else {
+    route = route_aodv_insert(to, rrep_header->src, header->src, rrep_header->hop_to_dst, rrep_header->seq);
     
 #ifdef ROUTING_LOG_ROUTES
     printf("[ROUTING_LOG_ROUTES] From rrep: Time %lfs at node %d: a new route has been added towards DST %d through sensor %d (%d hops) !\n", get_time()*0.000000001, to->object, route->dst, route->nexthop_id, route->hop_to_dst);
 #endif
   }
 
+  /* send the data packets waiting for this route */
+  route_pending_flush(to, rrep_header->src, route_forward_data_packet_to_destination);
+
   return 0;
 }
 
@@ -679,8 +711,7 @@ void route_forward_olsrv2_data_packet_to_destination(call_t *to, call_t *from, p
   struct nodedata *nodedata = get_node_private_data(to);
   struct classdata *classdata = get_class_private_data(to);
   
-  field_t *field_header = packet_retrieve_field(packet, "packet_header");
-  struct packet_header* header = (struct packet_header*) field_getValue(field_header);
+  struct packet_header* header = (struct packet_header*) packet_header_get(to, packet, HEADER_FIELD_PACKET);
   
   destination_t destination; 
   
@@ -690,8 +721,18 @@ void route_forward_olsrv2_data_packet_to_destination(call_t *to, call_t *from, p
 
   //printf(" #### HERE IN ROUTE FORWARD \n");
 
+  /* hop-by-hop mode: the nexthop comes from the local routing table */
+  if (nodedata->olsr_forwarding_mode == OLSR_HOP_BY_HOP) {
+    struct route_olsrv2 *route = route_get_nexthop_to_destination_olsrv2(to, header->end_dst);
+    header->dst = (route != NULL) ? route->nexthop_id : -1;
+  }
+  /* source routing mode: the nexthop comes from the path carried by the packet */
+  else {
+    header->dst = header->olsr_path[header->olsr_path_index];
+  }
+
   /* destroy data packet if no route towards the sink */
-  if (header->olsr_path[header->olsr_path_index] == -1) {
+  if (header->dst == -1) {
 #ifdef ROUTING_LOG_DATA_FORWARDING 
     printf("[ROUTING_LOG_DATA_FORWARDING] node %d => no route towards DST %d : data packet destroyed...\n", to->object, header->end_dst);
 #endif
@@ -699,9 +740,7 @@ void route_forward_olsrv2_data_packet_to_destination(call_t *to, call_t *from, p
     return;
   }
   
-  //printf(" ##### %d", header->olsr_path[header->olsr_path_index]);
-  
-  destination.id = header->olsr_path[header->olsr_path_index];
+  destination.id = header->dst;
   destination.position.x = -1;
   destination.position.y = -1;
   destination.position.z = -1;
@@ -766,215 +805,1195 @@ struct route* route_get_nexthop(call_t *to, int sink_id) {
 }
 
 
-struct route* oracenet_route_get_nexthop(call_t *to, int dst) {
+/** \brief Function to get the gradient entry of a given (sink, data type) (Directed Diffusion)
+ *  \fn struct gradient_entry* gradient_lookup(call_t *to, int sink_id, int data_type, int create)
+ *  \param c is a pointer to the called entity
+ *  \param sink_id is the sink ID
+ *  \param data_type is the requested data type
+ *  \param create is set to create the entry if it does not exist
+ *  \return NULL if failure, otherwise a pointer to the entry
+ **/
+struct gradient_entry* gradient_lookup(call_t *to, int sink_id, int data_type, int create) {
   struct nodedata *nodedata = get_node_private_data(to);
-  struct route *route = NULL;
+  struct gradient_entry *entry = NULL;
 
-  /* Check for the nexthop towards a particular destination */
-  list_init_traverse(nodedata->routing_table);
-  while((route = (struct route *) list_traverse(nodedata->routing_table)) != NULL) {
-    if (route->dst == dst) {
-      return route;
+  if (sink_id < 0 || sink_id >= MAX_NEIGHBORS_SIZE) {
+    return NULL;
+  }
+
+  for (entry = (struct gradient_entry *) nodedata->gradient_index[sink_id]; entry != NULL; entry = entry->next) {
+    if (entry->data_type == data_type) {
+      return entry;
     }
   }
 
-  return NULL;
+  if (create == 0) {
+    return NULL;
+  }
+
+  entry = (struct gradient_entry *) malloc(sizeof(struct gradient_entry));
+  entry->sink_id = sink_id;
+  entry->data_type = data_type;
+  entry->gradients_nbr = 0;
+  entry->best = -1;
+  entry->next_expiry = 0;
+  entry->upstream = -1;
+  entry->reinforcement_seq = -1;
+  entry->reinforcement_time = 0;
+  entry->next = (struct gradient_entry *) nodedata->gradient_index[sink_id];
+  nodedata->gradient_index[sink_id] = (void *) entry;
+  list_insert(nodedata->gradient_table, (void *) entry);
+
+  return entry;
 }
 
 
- 
-/** \brief Function to compute the nexthop towards a given destination (AODV)
- *  \fn   struct route_aodv* route_get_nexthop_to_destination(call_t *to, int dst)
+/** \brief Function to remove the expired gradients of an entry and to select its nexthop (Directed Diffusion)
+ *  \fn void gradient_select(call_t *to, struct gradient_entry *entry)
  *  \param c is a pointer to the called entity
- *  \param dst is the ID of the destination
- *  \return NULL if failure, otherwise the destination information of nexthop node
+ *  \param entry is a pointer to the gradient entry
  **/
-struct route_aodv* route_get_nexthop_to_destination(call_t *to, int dst) {
-  struct nodedata *nodedata = get_node_private_data(to);
-  struct route_aodv *route = NULL;
+void gradient_select(call_t *to, struct gradient_entry *entry) {
+  uint64_t now = get_time();
+  struct gradient *gradient = NULL;
+  struct gradient *best = NULL;
+  int i = 0;
 
-  /* Check for the nexthop towards a particular destination */
-  list_init_traverse(nodedata->routing_table);
-  while((route = (struct route_aodv *) list_traverse(nodedata->routing_table)) != NULL) {
-    if (route->dst == dst) {
-      return route;
+  /* timed expiry of the gradients which were not refreshed by an interest */
+  while (i < entry->gradients_nbr) {
+    if (entry->gradients[i].expiry <= now) {
+      entry->gradients[i] = entry->gradients[--entry->gradients_nbr];
+    }
+    else {
+      i++;
     }
   }
 
-  return NULL;
+  /* a reinforced gradient is preferred, then the shortest one */
+  entry->best = -1;
+  entry->next_expiry = (uint64_t) -1;
+  for (i = 0; i < entry->gradients_nbr; i++) {
+    gradient = &(entry->gradients[i]);
+    if (best == NULL
+	|| (gradient->reinforced_until > now && best->reinforced_until <= now)
+	|| ((gradient->reinforced_until > now) == (best->reinforced_until > now) && gradient->hop_to_sink < best->hop_to_sink)) {
+      best = gradient;
+      entry->best = i;
+    }
+
+    if (gradient->expiry < entry->next_expiry) {
+      entry->next_expiry = gradient->expiry;
+    }
+    if (gradient->reinforced_until > now && gradient->reinforced_until < entry->next_expiry) {
+      entry->next_expiry = gradient->reinforced_until;
+    }
+  }
 }
 
-/** \brief Function to compute the nexthop towards a given destination (ORACENET)
- *  \fn   struct route* route_get_nexthop_to_destination_oracenet(call_t *to, int dst)
+
+/** \brief Function to get the selected gradient of an entry (Directed Diffusion)
+ *  \fn struct gradient* gradient_get_nexthop(call_t *to, struct gradient_entry *entry)
  *  \param c is a pointer to the called entity
- *  \param dst is the ID of the destination
- *  \return NULL if failure, otherwise the destination information of nexthop node
+ *  \param entry is a pointer to the gradient entry (may be NULL)
+ *  \return NULL if failure, otherwise a pointer to the selected gradient
  **/
-struct route* route_get_nexthop_to_destination_oracenet(call_t *to, int dst) {
-  struct nodedata *nodedata = get_node_private_data(to);
-  struct route *route = NULL;
-  struct neighbor *neighbor = NULL;
-
-
-  /* intermediate local variables */
-  int routes_count;
-  routes_count = 0;
-  int route_nexthop_id_selected;
-  double var_prr;			
-  var_prr = 0;
-
-  /* checking if we have many routes to the dst */
-  list_init_traverse(nodedata->routing_table);
-  while((route = (struct route *) list_traverse(nodedata->routing_table)) != NULL) {
-    	if (route->dst == dst) {
-    		routes_count++;
-	}
+struct gradient* gradient_get_nexthop(call_t *to, struct gradient_entry *entry) {
+  if (entry == NULL) {
+    return NULL;
   }
-     
-
-  /* If we have only one route to the dst, we return it */
-  list_init_traverse(nodedata->routing_table);
-  while((route = (struct route *) list_traverse(nodedata->routing_table)) != NULL) {
-    	if ((route->dst == dst) && (routes_count == 1) && (route->E2E_PRR <= 1.000000)) {
-	//printf("ONLY ONE Route to dst = %d with E2E_PRR= %lf is selected \n  ", route->dst, route->E2E_PRR);
-    		return route;
-	}else if ((route->dst == dst) && (routes_count == 1) && (route->E2E_PRR > 1.000000)){
-		route->E2E_PRR = 1.000000;
-		return route;
-	}
-  } 
- 
-  /* If we have many routes to the dst, we choose the route with Best E2E_PRR */
 
-  /* Get the first Value of the Nexthop_LQE and ID */
-  list_init_traverse(nodedata->routing_table);
-  while((route = (struct route *) list_traverse(nodedata->routing_table)) != NULL) {
-    if ((route->dst == dst) && (routes_count > 1) && (route->E2E_PRR <= 1)) {
-        var_prr = route->E2E_PRR;
-	route_nexthop_id_selected = route->nexthop_id;
-	//printf("Route to dst = %d with E2E_PRR= %lf is selected \n  ", route->dst, route->E2E_PRR);
-	break;
-    }
-  }
-     
-  /* Check if we have another route with better PRR */
-  list_init_traverse(nodedata->routing_table);
-  while((route = (struct route *) list_traverse(nodedata->routing_table)) != NULL) {
-    if ((route->dst == dst) && (routes_count > 1)) {
-		if ((route->E2E_PRR > var_prr) && (route->E2E_PRR <= 1)){
-			route_nexthop_id_selected = route->nexthop_id;
-			var_prr = route->E2E_PRR;			/* Here we found new route with better prr than the saved one */
-		//	printf("Other Route to dst = %d with E2E_PRR= %lf is selected \n  ", route->dst, route->E2E_PRR);
-		}	  
-    }
-  }
-  /* We return the best route with the best E2E_PRR */
-  list_init_traverse(nodedata->routing_table);
-  while((route = (struct route *) list_traverse(nodedata->routing_table)) != NULL) {
-    if ((route->dst == dst) && (route->nexthop_id == route_nexthop_id_selected)) {
-	    return route;
-    }
+  /* the selection is only computed again when a gradient or a reinforcement expires */
+  if (get_time() >= entry->next_expiry) {
+    gradient_select(to, entry);
   }
-  return NULL;
+
+  return (entry->best == -1) ? NULL : &(entry->gradients[entry->best]);
 }
 
 
-/** \brief Function to compute the nexthop towards a given destination (OLSRv2)
- *  \fn   struct route_olsrv2* route_get_nexthop_to_destination(call_t *to, int dst)
+/** \brief Function to get the gradient entry of the closest sink (Directed Diffusion)
+ *  \fn struct gradient_entry* gradient_get_closest(call_t *to, int sink_id)
  *  \param c is a pointer to the called entity
- *  \param dst is the ID of the destination
- *  \return NULL if failure, otherwise the destination information of nexthop node
+ *  \param sink_id is the sink ID (-1 for any sink)
+ *  \return NULL if failure, otherwise a pointer to the entry
  **/
-struct route_olsrv2* route_get_nexthop_to_destination_olsrv2(call_t *to, int dst) {
+struct gradient_entry* gradient_get_closest(call_t *to, int sink_id) {
   struct nodedata *nodedata = get_node_private_data(to);
-  struct route_olsrv2 *route = NULL;
+  struct gradient_entry *entry = NULL;
+  struct gradient_entry *closest = NULL;
+  struct gradient *gradient = NULL;
+  int hop_to_sink = 9999;
 
-  /* Check for the nexthop towards a particular destination */
-  list_init_traverse(nodedata->routing_table);
-  while((route = (struct route_olsrv2 *) list_traverse(nodedata->routing_table)) != NULL) {
-    if (route->dst == dst) {
-      //printf("#### %d \n", route->dst);
-      return route;
+  list_init_traverse(nodedata->gradient_table);
+  while((entry = (struct gradient_entry *) list_traverse(nodedata->gradient_table)) != NULL) {
+    if ((sink_id == -1 || entry->sink_id == sink_id) && (gradient = gradient_get_nexthop(to, entry)) != NULL && gradient->hop_to_sink < hop_to_sink) {
+      closest = entry;
+      hop_to_sink = gradient->hop_to_sink;
     }
   }
 
-  return NULL;
+  return closest;
 }
 
 
-/** \brief Function to list the routing table on the standard output (AODV)
- *  \fn     void route_aodv_show(call_t *to)
+/** \brief Function to update the gradients according to a received exploratory interest (Directed Diffusion)
+ *  \fn int gradient_update_from_interest(call_t *to, struct packet_header *header, struct sink_interest_packet_header *interest_header)
  *  \param c is a pointer to the called entity
+ *  \param header is a pointer to the packet header of the received packet
+ *  \param interest_header is a pointer to the interest header of the received packet
+ *  \return 0 if success, -1 otherwise
  **/
-void route_aodv_show(call_t *to) {
+int gradient_update_from_interest(call_t *to, struct packet_header *header, struct sink_interest_packet_header *interest_header) {
   struct nodedata *nodedata = get_node_private_data(to);
-  struct route_aodv *route = NULL;
-  
-  list_init_traverse(nodedata->routing_table);
-  while((route = (struct route_aodv *) list_traverse(nodedata->routing_table)) != NULL) {
-    printf("   => Route to dst=%d is nexthop=%d with hop_nbr=%d \n", route->dst, route->nexthop_id, route->hop_to_dst);
+
+
+
+  struct gradient_entry *entry = gradient_lookup(to, interest_header->sink_id, interest_header->data_type, 1);
+  struct gradient *gradient = NULL;
+  int hop_to_sink = interest_header->ttl_max - (interest_header->ttl - 1);
+  int i = 0;
+
+  if (entry == NULL) {
+    return -1;
   }
 
-}
+  for (i = 0; i < entry->gradients_nbr; i++) {
+    if (entry->gradients[i].neighbor == header->src) {
+      gradient = &(entry->gradients[i]);
+      break;
+    }
+  }
 
-/** \brief Function to list the routing table on the standard output (Directed Diffusion)
- *  \fn    void route_show(call_t *to)
- *  \param c is a pointer to the called entity
- **/
-void route_show(call_t *to) {
-  struct nodedata *nodedata = get_node_private_data(to);
-  struct route *route = NULL;
+  if (gradient == NULL) {
+    /* the table is full: replace the longest gradient which is not reinforced, if it is longer */
+    if (entry->gradients_nbr == MAX_GRADIENTS_SIZE) {
+      for (i = 0; i < entry->gradients_nbr; i++) {
+	if (entry->gradients[i].reinforced_until <= get_time() && entry->gradients[i].hop_to_sink > hop_to_sink
+	    && (gradient == NULL || entry->gradients[i].hop_to_sink > gradient->hop_to_sink)) {
+	  gradient = &(entry->gradients[i]);
+	}
+      }
+      if (gradient == NULL) {
+	return 0;
+      }
+    }
+    else {
+      gradient = &(entry->gradients[entry->gradients_nbr++]);
+    }
+    gradient->neighbor = header->src;
+    gradient->reinforced_until = 0;
 
-  printf("Routing table for node %d : \n ", to->object);
-  list_init_traverse(nodedata->routing_table);
-  while((route = (struct route *) list_traverse(nodedata->routing_table)) != NULL) {
-    printf("   => Route to dst=%d is nexthop=%d with hop_nbr=%d \n", route->dst, route->nexthop_id, route->hop_to_dst);
+#ifdef ROUTING_LOG_ROUTES
+    printf("[ROUTING_LOG_ROUTES] From interest: Time %lfs at node %d: a new gradient has been added towards sink %d (data type %d) through sensor %d (%d hops) !\n", get_time()*0.000000001, to->object, entry->sink_id, entry->data_type, header->src, hop_to_sink);
+#endif
   }
 
-}
+  gradient->hop_to_sink = hop_to_sink;
+  gradient->expiry = get_time() + nodedata->gradient_timeout;
+  gradient_select(to, entry);
 
-/** \brief Function to list the routing table on the standard output (Directed Diffusion)
- *  \fn    void route_show(call_t *to)
- *  \param c is a pointer to the called entity
- **/
-void route_show_oracenet(call_t *to) {
-  struct nodedata *nodedata = get_node_private_data(to);
-  struct route *route = NULL;
+  /* set the path establishment time */
+  if (nodedata->path_establishment_delay == -1) {
+    nodedata->path_establishment_delay = get_time() * 0.000001;
+    route_update_global_stats(to, nodedata->path_establishment_delay);
+  }
 
-  printf("Routing table for node %d : \n ", to->object);
-  list_init_traverse(nodedata->routing_table);
- 	 while((route = (struct route *) list_traverse(nodedata->routing_table)) != NULL) {
-		if (route->dst < MAX_NEIGHBORS_SIZE)
-    		printf("   => Route to dst=%d is nexthop=%d with E2E_PRR=%lf \n", route->dst, route->nexthop_id, route->E2E_PRR);
-  	 }
+  return 0;
 }
 
-/** \brief Function to list the routing table on the standard output (Directed Diffusion)
- *  \fn    void route_show(call_t *to)
+
+/** \brief Function to apply a positive or negative reinforcement received from a neighbor (Directed Diffusion)
+ *  \fn int gradient_reinforce(call_t *to, struct packet_header *header, struct sink_interest_packet_header *interest_header)
  *  \param c is a pointer to the called entity
+ *  \param header is a pointer to the packet header of the received packet
+ *  \param interest_header is a pointer to the interest header of the received packet
+ *  \return the neighbor to which the reinforcement has to be propagated, -1 if none
  **/
-void route_remove_oracenet(call_t *to, int nexthop) {
+int gradient_reinforce(call_t *to, struct packet_header *header, struct sink_interest_packet_header *interest_header) {
   struct nodedata *nodedata = get_node_private_data(to);
-  struct route *route = NULL;
 
 
-  list_init_traverse(nodedata->routing_table);
- 	 while((route = (struct route *) list_traverse(nodedata->routing_table)) != NULL) {
-		if ((route->nexthop_id == nexthop) && (route->dst < MAX_NEIGHBORS_SIZE)){
-			list_delete(nodedata->routing_table, (void *) route);
-		}
-		
-  	 }
-}
 
+  struct gradient_entry *entry = gradient_lookup(to, interest_header->sink_id, interest_header->data_type, interest_header->reinforcement == REINFORCEMENT_POSITIVE);
+  struct gradient *gradient = NULL;
+  int i = 0;
 
-/** \brief Function to update the global entity stats informations (global path establishment time, etc.)
- *  \fn     void route_update_global_stats(call_t *to)
- *  \param c is a pointer to the called entity
- *  \param delay is the path establishment time
- **/
-void route_update_global_stats(call_t *to, double path_delay) {
-  struct classdata *classdata = get_class_private_data(to);
+  if (entry == NULL) {
+    return -1;
+  }
+
+  for (i = 0; i < entry->gradients_nbr; i++) {
+    if (entry->gradients[i].neighbor == header->src) {
+      gradient = &(entry->gradients[i]);
+      break;
+    }
+  }
+
+  /* negative reinforcement: prune the gradient until the next exploratory interest */
+  if (interest_header->reinforcement == REINFORCEMENT_NEGATIVE) {
+    if (gradient != NULL) {
+      *gradient = entry->gradients[--entry->gradients_nbr];
+      gradient_select(to, entry);
+#ifdef ROUTING_LOG_ROUTES
+      printf("[ROUTING_LOG_ROUTES] Time %lfs at node %d: the gradient towards sink %d (data type %d) through sensor %d has been pruned !\n", get_time()*0.000000001, to->object, entry->sink_id, entry->data_type, header->src);
+#endif
+    }
+    return -1;
+  }
+
+  /* positive reinforcement: the gradient becomes the preferred one */
+  if (gradient == NULL) {
+    if (entry->gradients_nbr == MAX_GRADIENTS_SIZE) {
+      return -1;
+    }
+    gradient = &(entry->gradients[entry->gradients_nbr++]);
+    gradient->neighbor = header->src;
+    gradient->hop_to_sink = interest_header->ttl_max - (interest_header->ttl - 1);
+  }
+  gradient->reinforced_until = get_time() + nodedata->gradient_timeout;
+  if (gradient->expiry < gradient->reinforced_until) {
+    gradient->expiry = gradient->reinforced_until;
+  }
+  gradient_select(to, entry);
+
+#ifdef ROUTING_LOG_ROUTES
+  printf("[ROUTING_LOG_ROUTES] Time %lfs at node %d: the gradient towards sink %d (data type %d) through sensor %d has been reinforced !\n", get_time()*0.000000001, to->object, entry->sink_id, entry->data_type, header->src);
+#endif
+
+  /* propagate each reinforcement once towards the data sources */
+  if (interest_header->seq <= entry->reinforcement_seq || entry->upstream == -1 || entry->upstream == header->src || entry->upstream == to->object) {
+    return -1;
+  }
+  entry->reinforcement_seq = interest_header->seq;
+
+  return entry->upstream;
+}
+
+
+/** \brief Function to update the reinforcements of a sink according to a received data packet (Directed Diffusion)
+ *  \fn int gradient_update_from_data(call_t *to, struct packet_header *header, int *reinforcement)
+ *  \param c is a pointer to the called entity
+ *  \param header is a pointer to the packet header of the received packet
+ *  \param reinforcement is set to the reinforcement to send to the previous hop (REINFORCEMENT_NONE if none)
+ *  \return 1 if the data packet is a duplicate, 0 otherwise
+ **/
+int gradient_update_from_data(call_t *to, struct packet_header *header, int *reinforcement) {
+  struct nodedata *nodedata = get_node_private_data(to);
+
+
+  struct gradient_entry *entry = gradient_lookup(to, to->object, header->data_type, 1);
+
+  *reinforcement = REINFORCEMENT_NONE;
+
+  if (entry == NULL) {
+    return 0;
+  }
+
+  /* the neighbor brought no new data: its path is redundant, prune it */
+  if (route_duplicate_check(to, header->src, header->seq)) {
+    if (header->prevhop != entry->upstream) {
+      *reinforcement = REINFORCEMENT_NEGATIVE;
+    }
+    return 1;
+  }
+
+  /* reinforce the first neighbor which delivers new data in each period */
+  if (entry->upstream == -1 || get_time() - entry->reinforcement_time >= nodedata->reinforcement_period) {
+    entry->upstream = header->prevhop;
+    entry->reinforcement_time = get_time();
+    entry->reinforcement_seq++;
+    *reinforcement = REINFORCEMENT_POSITIVE;
+  }
+
+  return 0;
+}
+
+
+/** \brief Function to destroy the gradient table (Directed Diffusion)
+ *  \fn void gradient_destroy(call_t *to)
+ *  \param c is a pointer to the called entity
+ **/
+void gradient_destroy(call_t *to) {
+  struct nodedata *nodedata = get_node_private_data(to);
+  struct gradient_entry *entry = NULL;
+
+  while ((entry = (struct gradient_entry *) list_pop(nodedata->gradient_table)) != NULL) {
+    free(entry);
+  }
+  list_destroy(nodedata->gradient_table);
+}
+
+
+struct route* oracenet_route_get_nexthop(call_t *to, int dst) {
+  struct nodedata *nodedata = get_node_private_data(to);
+  struct route *route = NULL;
+
+  /* Check for the nexthop towards a particular destination */
+  list_init_traverse(nodedata->routing_table);
+  while((route = (struct route *) list_traverse(nodedata->routing_table)) != NULL) {
+    if (route->dst == dst) {
+      return route;
+    }
+  }
+
+  return NULL;
+}
+
+
+ 
+/** \brief Function to compute the nexthop towards a given destination (AODV)
+ *  \fn   struct route_aodv* route_get_nexthop_to_destination(call_t *to, int dst)
+ *  \param c is a pointer to the called entity
+ *  \param dst is the ID of the destination
+ *  \return NULL if failure, otherwise the destination information of nexthop node
+ **/
+struct route_aodv* route_get_nexthop_to_destination(call_t *to, int dst) {
+  struct nodedata *nodedata = get_node_private_data(to);
+  struct route_aodv *route = NULL;
+
+  if (dst < 0 || dst >= MAX_NEIGHBORS_SIZE) {
+    return NULL;
+  }
+
+  /* Check for the nexthop towards a particular destination */
+  route = (struct route_aodv *) nodedata->route_index[dst];
+
+  /* remove the route if it has not been used nor refreshed during its lifetime */
+  if (route != NULL && route->lifetime != 0 && get_time() > route->lifetime) {
+#ifdef ROUTING_LOG_ROUTES
+    printf("[ROUTING_LOG_ROUTES] Time %lfs at node %d: the route to DST %d has expired !\n", get_time()*0.000000001, to->object, dst);
+#endif
+    route_aodv_remove(to, route);
+    return NULL;
+  }
+
+  return route;
+}
+
+
+/** \brief Function to add a new route in the local routing table (AODV)
+ *  \fn struct route_aodv* route_aodv_insert(call_t *to, int dst, int nexthop, int hop_to_dst, int seq)
+ *  \param c is a pointer to the called entity
+ *  \param dst is the ID of the destination
+ *  \param nexthop is the ID of the nexthop towards dst
+ *  \param hop_to_dst is the number of hops towards dst
+ *  \param seq is the sequence number related to the route creation
+ *  \return a pointer to the new route
+ **/
+struct route_aodv* route_aodv_insert(call_t *to, int dst, int nexthop, int hop_to_dst, int seq) {
+  struct nodedata *nodedata = get_node_private_data(to);
+  struct route_aodv *route = (struct route_aodv *) malloc(sizeof(struct route_aodv));
+
+  route->dst = dst;
+  route->nexthop_id = nexthop;
+  route->nexthop_lqe = 1.0;
+  route->time = get_time();
+  route->seq_rreq = seq;
+  route->seq_rrep = -1;
+  route->hop_to_dst = hop_to_dst;
+  route->precursors_nbr = 0;
+  route->lifetime = 0;
+  route_aodv_refresh(to, route);
+
+  list_insert(nodedata->routing_table, (void *) route); 
+  if (dst >= 0 && dst < MAX_NEIGHBORS_SIZE) {
+    nodedata->route_index[dst] = route;
+  }
+
+  return route;
+}
+
+
+/** \brief Function to remove and free a route of the local routing table (AODV)
+ *  \fn void route_aodv_remove(call_t *to, struct route_aodv *route)
+ *  \param c is a pointer to the called entity
+ *  \param route is a pointer to the route to remove
+ **/
+void route_aodv_remove(call_t *to, struct route_aodv *route) {
+  struct nodedata *nodedata = get_node_private_data(to);
+
+  if (route->dst >= 0 && route->dst < MAX_NEIGHBORS_SIZE && nodedata->route_index[route->dst] == route) {
+    nodedata->route_index[route->dst] = NULL;
+  }
+  list_delete(nodedata->routing_table, (void *) route);
+  free(route);
+}
+
+
+/** \brief Function to extend the lifetime of an active route (AODV)
+ *  \fn void route_aodv_refresh(call_t *to, struct route_aodv *route)
+ *  \param c is a pointer to the called entity
+ *  \param route is a pointer to the active route
+ **/
+void route_aodv_refresh(call_t *to, struct route_aodv *route) {
+  struct nodedata *nodedata = get_node_private_data(to);
+
+  if (nodedata->route_lifetime > 0) {
+    route->lifetime = get_time() + nodedata->route_lifetime;
+  }
+}
+
+
+/** \brief Function to add a neighbor to the precursor list of a route (AODV)
+ *  \fn void route_aodv_add_precursor(call_t *to, struct route_aodv *route, int precursor)
+ *  \param c is a pointer to the called entity
+ *  \param route is a pointer to the route
+ *  \param precursor is the ID of the upstream neighbor using the route
+ **/
+void route_aodv_add_precursor(call_t *to, struct route_aodv *route, int precursor) {
+  int i = 0;
+
+  if (precursor < 0 || precursor == to->object || precursor == route->nexthop_id) {
+    return;
+  }
+
+  for (i = 0; i < route->precursors_nbr; i++) {
+    if (route->precursors[i] == precursor) {
+      return;
+    }
+  }
+
+  if (route->precursors_nbr < MAX_PRECURSORS_SIZE) {
+    route->precursors[route->precursors_nbr++] = precursor;
+  }
+}
+
+
+/** \brief Function to handle the loss of a nexthop node: remove the related routes and locally repair the active ones (AODV)
+ *  \fn int route_aodv_link_failure(call_t *to, int nexthop)
+ *  \param c is a pointer to the called entity
+ *  \param nexthop is the ID of the lost neighbor
+ *  \return the number of removed routes
+ **/
+int route_aodv_link_failure(call_t *to, int nexthop) {
+  struct nodedata *nodedata = get_node_private_data(to);
+  struct route_aodv *route = NULL;
+  struct route_aodv *broken[MAX_NEIGHBORS_SIZE];
+  int broken_nbr = 0;
+  int i = 0;
+
+  /* collect the routes through the lost neighbor */
+  list_init_traverse(nodedata->routing_table);
+  while((route = (struct route_aodv *) list_traverse(nodedata->routing_table)) != NULL) {
+    if (route->nexthop_id == nexthop && broken_nbr < MAX_NEIGHBORS_SIZE) {
+      broken[broken_nbr++] = route;
+    }
+  }
+
+  for (i = 0; i < broken_nbr; i++) {
+    int dst = broken[i]->dst;
+    int active = (broken[i]->precursors_nbr > 0);
+
+#ifdef ROUTING_LOG_ROUTES
+    printf("[ROUTING_LOG_ROUTES] Time %lfs at node %d: the route to DST %d is broken (nexthop %d lost, %d precursors) !\n", get_time()*0.000000001, to->object, dst, nexthop, broken[i]->precursors_nbr);
+#endif
+    route_aodv_remove(to, broken[i]);
+
+    /* local repair of the routes still used by upstream nodes */
+    if (active && nodedata->local_repair_status == STATUS_ON && dst != nexthop) {
+      rreq_route_discovery(to, dst);
+    }
+  }
+
+  return broken_nbr;
+}
+
+
+/** \brief Function to get the waiting packets entry of a given destination (AODV, ORACENET)
+ *  \fn struct pending_destination* route_pending_lookup(call_t *to, int dst, int create)
+ *  \param c is a pointer to the called entity
+ *  \param dst is the final destination of the waiting packets
+ *  \param create is set to create the entry if it does not exist
+ *  \return NULL if failure, otherwise a pointer to the entry
+ **/
+struct pending_destination* route_pending_lookup(call_t *to, int dst, int create) {
+  struct nodedata *nodedata = get_node_private_data(to);
+  struct pending_destination *pending = NULL;
+
+  list_init_traverse(nodedata->pending_table);
+  while((pending = (struct pending_destination *) list_traverse(nodedata->pending_table)) != NULL) {
+    if (pending->dst == dst) {
+      return pending;
+    }
+  }
+
+  if (create == 0) {
+    return NULL;
+  }
+
+  pending = (struct pending_destination *) malloc(sizeof(struct pending_destination));
+  pending->dst = dst;
+  pending->first = 0;
+  pending->size = 0;
+  pending->rreq_nbr = 0;
+  pending->rreq_timeout = 0;
+  pending->rreq_deadline = 0;
+  list_insert(nodedata->pending_table, (void *) pending);
+
+  return pending;
+}
+
+
+/** \brief Function to destroy the waiting packets entry of a destination together with its packets (AODV, ORACENET)
+ *  \fn void route_pending_release(call_t *to, struct pending_destination *pending)
+ *  \param c is a pointer to the called entity
+ *  \param pending is a pointer to the entry
+ **/
+void route_pending_release(call_t *to, struct pending_destination *pending) {
+  struct nodedata *nodedata = get_node_private_data(to);
+
+  while (pending->size > 0) {
+    packet_dealloc(pending->packets[pending->first]);
+    pending->first = (pending->first + 1) % MAX_PENDING_SIZE;
+    pending->size--;
+  }
+
+  list_delete(nodedata->pending_table, (void *) pending);
+  free(pending);
+}
+
+
+/** \brief Function to drop the packets which have been waiting longer than the pending timeout (AODV, ORACENET)
+ *  \fn int route_pending_purge(call_t *to, struct pending_destination *pending)
+ *  \param c is a pointer to the called entity
+ *  \param pending is a pointer to the entry
+ *  \return the number of packets still waiting
+ **/
+int route_pending_purge(call_t *to, struct pending_destination *pending) {
+  struct nodedata *nodedata = get_node_private_data(to);
+
+  /* the oldest packets are at the head of the ring */
+  while (pending->size > 0 && (get_time() - pending->times[pending->first]) > nodedata->pending_timeout) {
+#ifdef ROUTING_LOG_DATA_FORWARDING
+    printf("[ROUTING_LOG_DATA_FORWARDING] Time %lfs node %d => no route towards DST %d in time : data packet destroyed...\n", get_time()*0.000000001, to->object, pending->dst);
+#endif
+    packet_dealloc(pending->packets[pending->first]);
+    pending->first = (pending->first + 1) % MAX_PENDING_SIZE;
+    pending->size--;
+  }
+
+  return pending->size;
+}
+
+
+/** \brief Function to buffer a data packet until a route towards its destination is known (AODV, ORACENET)
+ *  \fn int route_pending_insert(call_t *to, packet_t *packet, int dst)
+ *  \param c is a pointer to the called entity
+ *  \param packet is a pointer to the data packet
+ *  \param dst is the final destination of the packet
+ *  \return the number of packets waiting for dst
+ **/
+int route_pending_insert(call_t *to, packet_t *packet, int dst) {
+  struct nodedata *nodedata = get_node_private_data(to);
+  struct pending_destination *pending = route_pending_lookup(to, dst, 1);
+
+  route_pending_purge(to, pending);
+
+  /* the queue is full: the oldest packet leaves room for the newest one */
+  if (pending->size >= nodedata->pending_queue_size) {
+#ifdef ROUTING_LOG_DATA_FORWARDING
+    printf("[ROUTING_LOG_DATA_FORWARDING] Time %lfs node %d => too many packets waiting for DST %d : oldest data packet destroyed...\n", get_time()*0.000000001, to->object, dst);
+#endif
+    packet_dealloc(pending->packets[pending->first]);
+    pending->first = (pending->first + 1) % MAX_PENDING_SIZE;
+    pending->size--;
+  }
+
+  pending->packets[(pending->first + pending->size) % MAX_PENDING_SIZE] = packet;
+  pending->times[(pending->first + pending->size) % MAX_PENDING_SIZE] = get_time();
+  pending->size++;
+
+  return pending->size;
+}
+
+
+/** \brief Function to send in bulk the data packets waiting for a newly available route (AODV, ORACENET)
+ *  \fn int route_pending_flush(call_t *to, int dst, void (*forward)(call_t *, call_t *, packet_t *))
+ *  \param c is a pointer to the called entity
+ *  \param dst is the destination of the new route
+ *  \param forward is the protocol function forwarding a data packet along the new route
+ *  \return the number of sent packets
+ **/
+int route_pending_flush(call_t *to, int dst, void (*forward)(call_t *, call_t *, packet_t *)) {
+  struct nodedata *nodedata = get_node_private_data(to);
+  struct pending_destination *pending = NULL;
+  packet_t *ready[MAX_PENDING_SIZE];
+  call_t from = {-1, -1};
+  int ready_nbr = 0;
+  int i = 0;
+
+  if (list_getsize(nodedata->pending_table) == 0 || (pending = route_pending_lookup(to, dst, 0)) == NULL) {
+    return 0;
+  }
+
+  /* detach the still valid packets in their buffering order, this also ends the route discovery */
+  route_pending_purge(to, pending);
+  while (pending->size > 0) {
+    ready[ready_nbr++] = pending->packets[pending->first];
+    pending->first = (pending->first + 1) % MAX_PENDING_SIZE;
+    pending->size--;
+  }
+  route_pending_release(to, pending);
+
+  for (i = 0; i < ready_nbr; i++) {
+    forward(to, &from, ready[i]);
+  }
+
+#ifdef ROUTING_LOG_DATA_FORWARDING
+  if (ready_nbr > 0) {
+    printf("[ROUTING_LOG_DATA_FORWARDING] Time %lfs node %d sent %d buffered data packets towards DST %d\n", get_time()*0.000000001, to->object, ready_nbr, dst);
+  }
+#endif
+
+  return ready_nbr;
+}
+
+
+/** \brief Function to send the data packets waiting for a destination once a route towards it is known (ORACENET)
+ *  \fn int route_pending_flush_oracenet(call_t *to, int dst)
+ *  \param c is a pointer to the called entity
+ *  \param dst is the destination of the waiting packets (BROADCAST_ADDR for the closest sink)
+ *  \return the number of sent packets
+ **/
+int route_pending_flush_oracenet(call_t *to, int dst) {
+  struct nodedata *nodedata = get_node_private_data(to);
+
+  if (list_getsize(nodedata->pending_table) == 0 || route_get_nexthop_to_destination_oracenet(to, dst) == NULL) {
+    return 0;
+  }
+
+  return route_pending_flush(to, dst, route_forward_oracenet_data_packet);
+}
+
+
+/** \brief Function to destroy all the waiting packets (AODV, ORACENET)
+ *  \fn void route_pending_destroy(call_t *to)
+ *  \param c is a pointer to the called entity
+ **/
+void route_pending_destroy(call_t *to) {
+  struct nodedata *nodedata = get_node_private_data(to);
+  struct pending_destination *pending = NULL;
+
+  while ((pending = (struct pending_destination *) list_pop(nodedata->pending_table)) != NULL) {
+    while (pending->size > 0) {
+      packet_dealloc(pending->packets[pending->first]);
+      pending->first = (pending->first + 1) % MAX_PENDING_SIZE;
+      pending->size--;
+    }
+    free(pending);
+  }
+  list_destroy(nodedata->pending_table);
+}
+
+/** \brief Hash function of the duplicate detection table (source node ID)
+ *  \fn unsigned long route_duplicate_hash(void *key)
+ *  \param key is the source node ID
+ *  \return the hash value
+ **/
+unsigned long route_duplicate_hash(void *key) {
+  return (unsigned long) key;
+}
+
+/** \brief Comparison function of the duplicate detection table
+ *  \fn int route_duplicate_equal(void *key0, void *key1)
+ *  \param key0 is the first source node ID
+ *  \param key1 is the second source node ID
+ *  \return 1 if the keys are equal, 0 otherwise
+ **/
+int route_duplicate_equal(void *key0, void *key1) {
+  return (int) (key0 == key1);
+}
+
+/** \brief Function to check whether a data packet was already received, and to record it otherwise (Directed Diffusion, ORACENET).
+ *  Sliding window of DUPLICATE_WINDOW_SIZE sequence numbers per source: reordered packets are accepted, packets older than the window are dropped.
+ *  \fn int route_duplicate_check(call_t *to, int src, int seq)
+ *  \param c is a pointer to the called entity
+ *  \param src is the source of the data packet
+ *  \param seq is the sequence number of the data packet
+ *  \return 1 if the data packet is a duplicate, 0 otherwise
+ **/
+int route_duplicate_check(call_t *to, int src, int seq) {
+  struct nodedata *nodedata = get_node_private_data(to);
+  struct duplicate_window *window = hashtable_retrieve(nodedata->duplicate_table, (void *) ((unsigned long) src));
+  int offset;
+
+  /* first packet from this source */
+  if (window == NULL) {
+    window = (struct duplicate_window *) malloc(sizeof(struct duplicate_window));
+    window->src = src;
+    window->last_seq = seq;
+    window->bitmap = 1;
+    hashtable_insert(nodedata->duplicate_table, (void *) ((unsigned long) src), (void *) window);
+    return 0;
+  }
+
+  /* newer packet: slide the window */
+  if (seq > window->last_seq) {
+    offset = seq - window->last_seq;
+    window->bitmap = (offset >= DUPLICATE_WINDOW_SIZE) ? 1 : ((window->bitmap << offset) | 1);
+    window->last_seq = seq;
+    return 0;
+  }
+
+  /* older packet: new if inside the window and not yet received */
+  offset = window->last_seq - seq;
+  if (offset >= DUPLICATE_WINDOW_SIZE || (window->bitmap & (1ull << offset))) {
+    return 1;
+  }
+  window->bitmap |= (1ull << offset);
+  return 0;
+}
+
+/** \brief Function to destroy the duplicate detection table (Directed Diffusion, ORACENET)
+ *  \fn void route_duplicate_destroy(call_t *to)
+ *  \param c is a pointer to the called entity
+ **/
+void route_duplicate_destroy(call_t *to) {
+  struct nodedata *nodedata = get_node_private_data(to);
+
+  hashtable_destroy(nodedata->duplicate_table);
+}
+
+/** \brief Function to set the aggregation function of a data type from a "data_type:function" parameter (Directed Diffusion, ORACENET)
+ *  \fn int route_aggregation_set(struct nodedata *nodedata, char *value)
+ *  \param nodedata is a pointer to the node private data
+ *  \param value is the parameter value (e.g. "3:avg"), the function being concat, min, max, avg, count or off
+ *  \return 0 if success, -1 otherwise
+ **/
+int route_aggregation_set(struct nodedata *nodedata, char *value) {
+  char function[16];
+  int data_type = -1;
+
+  if (sscanf(value, "%d:%15s", &data_type, function) != 2 || data_type < 0 || data_type >= MAX_DATA_TYPES) {
+    return -1;
+  }
+
+  if (!strcmp(function, "off")) {
+    nodedata->aggregation_function[data_type] = AGGREGATION_OFF;
+  }
+  else if (!strcmp(function, "concat")) {
+    nodedata->aggregation_function[data_type] = AGGREGATION_CONCAT;
+  }
+  else if (!strcmp(function, "min")) {
+    nodedata->aggregation_function[data_type] = AGGREGATION_MIN;
+  }
+  else if (!strcmp(function, "max")) {
+    nodedata->aggregation_function[data_type] = AGGREGATION_MAX;
+  }
+  else if (!strcmp(function, "avg")) {
+    nodedata->aggregation_function[data_type] = AGGREGATION_AVG;
+  }
+  else if (!strcmp(function, "count")) {
+    nodedata->aggregation_function[data_type] = AGGREGATION_COUNT;
+  }
+  else {
+    return -1;
+  }
+
+  return 0;
+}
+
+
+/** \brief Function to get the aggregate header of a data packet, creating it from the packet reading if needed (Directed Diffusion, ORACENET)
+ *  \fn struct data_aggregate_header* route_aggregate_header(call_t *to, packet_t *packet, struct packet_header *header, int function)
+ *  \param c is a pointer to the called entity
+ *  \param packet is a pointer to the data packet
+ *  \param header is a pointer to the packet header of the data packet
+ *  \param function is the aggregation function
+ *  \return a pointer to the aggregate header
+ **/
+struct data_aggregate_header* route_aggregate_header(call_t *to, packet_t *packet, struct packet_header *header, int function) {
+  struct data_aggregate_header *aggregate_header = (struct data_aggregate_header*) packet_header_get(to, packet, HEADER_FIELD_DATA_AGGREGATE);
+  field_t *field_aggregate_header = NULL;
+  field_t *field_value = NULL;
+
+  if (aggregate_header != NULL) {
+    return aggregate_header;
+  }
+  field_value = packet_retrieve_field(packet, "data_value");
+
+  /* a single reading: the upper layer exposes its value in the optional "data_value" field */
+  aggregate_header = malloc(sizeof(struct data_aggregate_header));
+  aggregate_header->function = function;
+  aggregate_header->count = 1;
+  aggregate_header->value = (field_value != NULL) ? *((double *) field_getValue(field_value)) : 0.0;
+  aggregate_header->min = aggregate_header->value;
+  aggregate_header->max = aggregate_header->value;
+  aggregate_header->sum = aggregate_header->value;
+  aggregate_header->sources_nbr = 1;
+  aggregate_header->sources[0] = header->src;
+  aggregate_header->seqs[0] = header->seq;
+
+  field_aggregate_header = field_create(INT, sizeof(struct data_aggregate_header), aggregate_header);
+  packet_add_field(packet, "data_aggregate_header", field_aggregate_header);
+
+  return aggregate_header;
+}
+
+
+/** \brief Function to merge a data packet into an aggregate and to destroy it (Directed Diffusion, ORACENET)
+ *  \fn struct data_aggregate_header* route_aggregate_merge(call_t *to, packet_t *aggregate, packet_t *packet, struct packet_header *header, int function)
+ *  \param c is a pointer to the called entity
+ *  \param aggregate is a pointer to the aggregate (its aggregate header is set when it is held)
+ *  \param packet is a pointer to the merged data packet
+ *  \param header is a pointer to the packet header of the merged data packet
+ *  \param function is the aggregation function
+ *  \return a pointer to the aggregate header of the aggregate
+ **/
+struct data_aggregate_header* route_aggregate_merge(call_t *to, packet_t *aggregate, packet_t *packet, struct packet_header *header, int function) {
+  struct data_aggregate_header *aggregate_header = (struct data_aggregate_header*) packet_header_get(to, aggregate, HEADER_FIELD_DATA_AGGREGATE);
+  struct data_aggregate_header *merged_header = route_aggregate_header(to, packet, header, function);
+  field_t *field_value = packet_retrieve_field(aggregate, "data_value");
+  int i = 0;
+
+  aggregate_header->count += merged_header->count;
+  aggregate_header->sum += merged_header->sum;
+  if (merged_header->min < aggregate_header->min) {
+    aggregate_header->min = merged_header->min;
+  }
+  if (merged_header->max > aggregate_header->max) {
+    aggregate_header->max = merged_header->max;
+  }
+  for (i = 0; i < merged_header->sources_nbr && aggregate_header->sources_nbr < MAX_AGGREGATED_DATA; i++) {
+    aggregate_header->sources[aggregate_header->sources_nbr] = merged_header->sources[i];
+    aggregate_header->seqs[aggregate_header->sources_nbr] = merged_header->seqs[i];
+    aggregate_header->sources_nbr++;
+  }
+
+  switch (function) {
+  case AGGREGATION_CONCAT:
+    /* the merged payload keeps its size, only the transmission is shared */
+    aggregate->real_size += packet->real_size;
+    break;
+  case AGGREGATION_MIN:
+    aggregate_header->value = aggregate_header->min;
+    break;
+  case AGGREGATION_MAX:
+    aggregate_header->value = aggregate_header->max;
+    break;
+  case AGGREGATION_AVG:
+    aggregate_header->value = aggregate_header->sum / aggregate_header->count;
+    break;
+  case AGGREGATION_COUNT:
+    aggregate_header->value = aggregate_header->count;
+    break;
+  }
+
+  /* reduced aggregates carry the result in place of the reading */
+  if (function != AGGREGATION_CONCAT && field_value != NULL) {
+    *((double *) field_getValue(field_value)) = aggregate_header->value;
+  }
+
+  packet_dealloc(packet);
+  return aggregate_header;
+}
+
+
+/** \brief Function to hold a data packet for aggregation before forwarding it (Directed Diffusion, ORACENET)
+ *  \fn void route_aggregate_data_packet(call_t *to, call_t *from, packet_t *packet, int dst, void (*forward)(call_t *, call_t *, packet_t *))
+ *  \param c is a pointer to the called entity
+ *  \param packet is a pointer to the received data packet
+ *  \param dst is the destination (sink) of the data packet
+ *  \param forward is the protocol forwarding function
+ **/
+void route_aggregate_data_packet(call_t *to, call_t *from, packet_t *packet, int dst, void (*forward)(call_t *, call_t *, packet_t *)) {
+  struct nodedata *nodedata = get_node_private_data(to);
+  
+  struct packet_header* header = (struct packet_header*) packet_header_get(to, packet, HEADER_FIELD_PACKET);
+
+  struct data_aggregation *aggregation = NULL;
+  struct data_aggregate_header *aggregate_header = NULL;
+  int function = (header->data_type >= 0 && header->data_type < MAX_DATA_TYPES) ? nodedata->aggregation_function[header->data_type] : AGGREGATION_OFF;
+  int src = header->src;
+  call_t from0 = {-1, -1};
+
+  /* no aggregation for this data type */
+  if (function == AGGREGATION_OFF) {
+    forward(to, from, packet);
+    return;
+  }
+
+  list_init_traverse(nodedata->aggregation_table);
+  while ((aggregation = (struct data_aggregation *) list_traverse(nodedata->aggregation_table)) != NULL) {
+    if (aggregation->dst == dst && aggregation->data_type == header->data_type) {
+      break;
+    }
+  }
+  if (aggregation == NULL) {
+    aggregation = (struct data_aggregation *) malloc(sizeof(struct data_aggregation));
+    aggregation->dst = dst;
+    aggregation->data_type = header->data_type;
+    aggregation->packet = NULL;
+    aggregation->deadline = 0;
+    list_insert(nodedata->aggregation_table, (void *) aggregation);
+  }
+  aggregation->forward = forward;
+
+  /* first packet: hold it */
+  if (aggregation->packet == NULL) {
+    route_aggregate_header(to, packet, header, function);
+    aggregation->packet = packet;
+    aggregation->deadline = get_time() + nodedata->aggregation_hold;
+    scheduler_add_callback(aggregation->deadline, to, &from0, route_aggregation_callback, (void *) aggregation);
+    return;
+  }
+
+  aggregate_header = route_aggregate_merge(to, aggregation->packet, packet, header, function);
+
+#ifdef ROUTING_LOG_DATA_FORWARDING  
+  printf("[ROUTING_LOG_DATA_FORWARDING] node %d merged a data packet from source node %d into the aggregate towards %d (%d readings)\n", to->object, src, dst, aggregate_header->count);
+#endif
+
+  /* full aggregate: forward it without waiting */
+  if (aggregate_header->sources_nbr >= nodedata->aggregation_max_size) {
+    route_aggregation_flush(to, aggregation);
+  }
+}
+
+
+/** \brief Callback function to forward an aggregate at the end of its holding time (to be used with the scheduler_add_callback function).
+ *  \fn int route_aggregation_callback(call_t *to, call_t *from, void *args)
+ *  \param c is a pointer to the called entity
+ *  \param args is a pointer to the aggregation entry
+ *  \return 0 if success, -1 otherwise
+ **/
+int route_aggregation_callback(call_t *to, call_t *from, void *args) {
+  struct data_aggregation *aggregation = (struct data_aggregation *) args;
+
+  /* the aggregate may have been forwarded early and a new one started since */
+  if (aggregation->packet != NULL && aggregation->deadline <= get_time()) {
+    route_aggregation_flush(to, aggregation);
+  }
+
+  return 0;
+}
+
+
+/** \brief Function to forward the aggregate of an aggregation entry (Directed Diffusion, ORACENET)
+ *  \fn void route_aggregation_flush(call_t *to, struct data_aggregation *aggregation)
+ *  \param c is a pointer to the called entity
+ *  \param aggregation is a pointer to the aggregation entry
+ **/
+void route_aggregation_flush(call_t *to, struct data_aggregation *aggregation) {
+  packet_t *packet = aggregation->packet;
+  call_t from0 = {-1, -1};
+
+  aggregation->packet = NULL;
+  aggregation->forward(to, &from0, packet);
+}
+
+
+/** \brief Function to destroy the aggregation entries and the held packets (Directed Diffusion, ORACENET)
+ *  \fn void route_aggregation_destroy(call_t *to)
+ *  \param c is a pointer to the called entity
+ **/
+void route_aggregation_destroy(call_t *to) {
+  struct nodedata *nodedata = get_node_private_data(to);
+  struct data_aggregation *aggregation = NULL;
+
+  while ((aggregation = (struct data_aggregation *) list_pop(nodedata->aggregation_table)) != NULL) {
+    if (aggregation->packet != NULL) {
+      packet_dealloc(aggregation->packet);
+    }
+    free(aggregation);
+  }
+  list_destroy(nodedata->aggregation_table);
+}
+
+/** \brief Function to rank the routes towards a given destination by E2E PRR: the primary next hop first, then the backup ones (ORACENET)
+ *  \fn int route_rank_oracenet(call_t *to, int dst, struct route *ranked[MAX_ORACENET_NEXTHOPS])
+ *  \param c is a pointer to the called entity
+ *  \param dst is the ID of the destination
+ *  \param ranked is filled with the best routes, by decreasing E2E PRR
+ *  \return the number of ranked routes
+ **/
+int route_rank_oracenet(call_t *to, int dst, struct route *ranked[MAX_ORACENET_NEXTHOPS]) {
+  struct nodedata *nodedata = get_node_private_data(to);
+  struct route *route = NULL;
+  int ranked_nbr = 0, i;
+
+  list_init_traverse(nodedata->routing_table);
+  while((route = (struct route *) list_traverse(nodedata->routing_table)) != NULL) {
+    if (route->dst != dst) {
+      continue;
+    }
+    if (route->E2E_PRR > 1.0) {
+      route->E2E_PRR = 1.0;
+    }
+
+    /* insert the route in the ranked set, the worst one falls out (first found wins on ties) */
+    if (ranked_nbr == MAX_ORACENET_NEXTHOPS && route->E2E_PRR <= ranked[MAX_ORACENET_NEXTHOPS - 1]->E2E_PRR) {
+      continue;
+    }
+    i = (ranked_nbr < MAX_ORACENET_NEXTHOPS) ? ranked_nbr++ : MAX_ORACENET_NEXTHOPS - 1;
+    while (i > 0 && ranked[i - 1]->E2E_PRR < route->E2E_PRR) {
+      ranked[i] = ranked[i - 1];
+      i--;
+    }
+    ranked[i] = route;
+  }
+
+  return ranked_nbr;
+}
+
+/** \brief Function to compute the nexthop towards a given destination (ORACENET)
+ *  \fn   struct route* route_get_nexthop_to_destination_oracenet(call_t *to, int dst)
+ *  \param c is a pointer to the called entity
+ *  \param dst is the ID of the destination
+ *  \return NULL if failure, otherwise the route through the primary nexthop node (best E2E PRR)
+ **/
+struct route* route_get_nexthop_to_destination_oracenet(call_t *to, int dst) {
+  struct route *ranked[MAX_ORACENET_NEXTHOPS];
+
+  if (route_rank_oracenet(to, dst, ranked) == 0) {
+    return NULL;
+  }
+  return ranked[0];
+}
+
+/** \brief Function to select the nexthop of a data packet towards a given destination (ORACENET).
+ *  The primary nexthop is used, unless load_split_threshold is set: the load is then split over the nexthops
+ *  whose E2E PRR is within this relative gap of the primary one, in proportion to their E2E PRR.
+ *  \fn   struct route* route_select_oracenet(call_t *to, int dst)
+ *  \param c is a pointer to the called entity
+ *  \param dst is the ID of the destination
+ *  \return NULL if failure, otherwise the route through the selected nexthop node
+ **/
+struct route* route_select_oracenet(call_t *to, int dst) {
+  struct nodedata *nodedata = get_node_private_data(to);
+  struct route *ranked[MAX_ORACENET_NEXTHOPS];
+  int ranked_nbr = route_rank_oracenet(to, dst, ranked);
+  int split_nbr, i;
+  double sum = 0, draw;
+
+  if (ranked_nbr == 0) {
+    return NULL;
+  }
+  if (nodedata->load_split_threshold <= 0) {
+    return ranked[0];
+  }
+
+  /* the near-equal PRR paths share the load */
+  for (split_nbr = 0; split_nbr < ranked_nbr && ranked[split_nbr]->E2E_PRR >= ranked[0]->E2E_PRR * (1 - nodedata->load_split_threshold); split_nbr++) {
+    sum += ranked[split_nbr]->E2E_PRR;
+  }
+  draw = get_random_double() * sum;
+  for (i = 0; i < split_nbr - 1 && draw >= ranked[i]->E2E_PRR; i++) {
+    draw -= ranked[i]->E2E_PRR;
+  }
+  return ranked[i];
+}
+
+/** \brief Function to handle a link-layer transmission failure towards a nexthop: its routes are dropped, the backup nexthops take over (ORACENET)
+ *  \fn   void route_link_failure_oracenet(call_t *to, int nexthop)
+ *  \param c is a pointer to the called entity
+ *  \param nexthop is the ID of the unreachable nexthop
+ **/
+void route_link_failure_oracenet(call_t *to, int nexthop) {
+#ifdef ROUTING_LOG_DATA_FORWARDING
+  printf("[ROUTING_LOG_DATA_FORWARDING] Time %lfs node %d lost the link towards nexthop %d => switching to the backup nexthops\n", get_time()*0.000000001, to->object, nexthop);
+#endif
+  route_remove_oracenet(to, nexthop);
+}
+
+
+/** \brief Function to compute the nexthop towards a given destination (OLSRv2)
+ *  \fn   struct route_olsrv2* route_get_nexthop_to_destination_olsrv2(call_t *to, int dst)
+ *  \param c is a pointer to the called entity
+ *  \param dst is the ID of the destination
+ *  \return NULL if failure, otherwise the destination information of nexthop node
+ **/
+struct route_olsrv2* route_get_nexthop_to_destination_olsrv2(call_t *to, int dst) {
+  struct nodedata *nodedata = get_node_private_data(to);
+  struct route_olsrv2 *route = NULL;
+
+  /* rebuild the routing table only if the topology has changed since the last SPF run */
+  if (nodedata->olsr_topology_changed) {
+    route_compute_olsrv2(to);
+  }
+
+  /* Check for the nexthop towards a particular destination */
+  if (dst >= 0 && dst < MAX_NEIGHBORS_SIZE) {
+    route = (struct route_olsrv2 *) nodedata->route_index[dst];
+  }
+
+  return route;
+}
+
+
+/** \brief Function to list the routing table on the standard output (AODV)
+ *  \fn     void route_aodv_show(call_t *to)
+ *  \param c is a pointer to the called entity
+ **/
+void route_aodv_show(call_t *to) {
+  struct nodedata *nodedata = get_node_private_data(to);
+  struct route_aodv *route = NULL;
+  
+  list_init_traverse(nodedata->routing_table);
+  while((route = (struct route_aodv *) list_traverse(nodedata->routing_table)) != NULL) {
+    printf("   => Route to dst=%d is nexthop=%d with hop_nbr=%d \n", route->dst, route->nexthop_id, route->hop_to_dst);
+  }
+
+}
+
+/** \brief Function to list the routing table on the standard output (Directed Diffusion)
+ *  \fn    void route_show(call_t *to)
+ *  \param c is a pointer to the called entity
+ **/
+void route_show(call_t *to) {
+  struct nodedata *nodedata = get_node_private_data(to);
+  struct route *route = NULL;
+
+  printf("Routing table for node %d : \n ", to->object);
+  list_init_traverse(nodedata->routing_table);
+  while((route = (struct route *) list_traverse(nodedata->routing_table)) != NULL) {
+    printf("   => Route to dst=%d is nexthop=%d with hop_nbr=%d \n", route->dst, route->nexthop_id, route->hop_to_dst);
+  }
+
+}
+
+/** \brief Function to list the routing table on the standard output (Directed Diffusion)
+ *  \fn    void route_show(call_t *to)
+ *  \param c is a pointer to the called entity
+ **/
+void route_show_oracenet(call_t *to) {
+  struct nodedata *nodedata = get_node_private_data(to);
+  struct route *route = NULL;
+
+  printf("Routing table for node %d : \n ", to->object);
+  list_init_traverse(nodedata->routing_table);
+ 	 while((route = (struct route *) list_traverse(nodedata->routing_table)) != NULL) {
+		if (route->dst < MAX_NEIGHBORS_SIZE)
+    		printf("   => Route to dst=%d is nexthop=%d with E2E_PRR=%lf \n", route->dst, route->nexthop_id, route->E2E_PRR);
+  	 }
+}
+
+/** \brief Function to list the routing table on the standard output (Directed Diffusion)
+ *  \fn    void route_show(call_t *to)
+ *  \param c is a pointer to the called entity
+ **/
+void route_remove_oracenet(call_t *to, int nexthop) {
+  struct nodedata *nodedata = get_node_private_data(to);
+  struct route *route = NULL;
+
+
+  list_init_traverse(nodedata->routing_table);
+ 	 while((route = (struct route *) list_traverse(nodedata->routing_table)) != NULL) {
+		if ((route->nexthop_id == nexthop) && (route->dst < MAX_NEIGHBORS_SIZE)){
+			list_delete(nodedata->routing_table, (void *) route);
+		}
+		
+  	 }
+}
+
+
+/** \brief Function to update the global entity stats informations (global path establishment time, etc.)
+ *  \fn     void route_update_global_stats(call_t *to)
+ *  \param c is a pointer to the called entity
+ *  \param delay is the path establishment time
+ **/
+void route_update_global_stats(call_t *to, double path_delay) {
+  struct classdata *classdata = get_class_private_data(to);
 
   classdata->global_tx_control_packet = classdata->current_tx_control_packet;
   classdata->global_rx_control_packet = classdata->current_rx_control_packet;
@@ -1018,34 +2037,87 @@ int printSolution(int dist[], int n)
 }
 
 
-void printPath(struct nodedata *nodedata, int dest, int prev[]){
-   
-  if (prev[dest] != -1){ //If we are not at the source node
-    printPath(nodedata, prev[dest], prev);
+/** \brief Function to extract the path from src to dst out of a shortest path tree (OLSRv2)
+ *  \fn int route_get_path_olsrv2(int prev[], int src, int dst, int path[], int size)
+ *  \param prev is the predecessor array filled by route_spf_olsrv2
+ *  \param src is the root of the shortest path tree
+ *  \param dst is the destination node
+ *  \param path is the caller buffer receiving the nodes from src to dst
+ *  \param size is the capacity of the path buffer
+ *  \return the number of nodes of the path, -1 if dst is unreachable or the path does not fit in the buffer
+ **/
+int route_get_path_olsrv2(int prev[], int src, int dst, int path[], int size) {
+  int length = 1;
+  int node = dst;
+  int i = 0;
+
+  /* first walk back to the root to get the path length (bounded to survive a corrupted tree) */
+  while (node != src) {
+    node = prev[node];
+    if (node == -1 || length >= MAX_NEIGHBORS_SIZE) {
+      return -1;
+    }
+    length++;
+  }
+
+  if (length > size) {
+    return -1;
+  }
+
+  /* then fill the buffer backwards, from dst to src */
+  node = dst;
+  for (i = length - 1; i >= 0; i--) {
+    path[i] = node;
+    node = prev[node];
   }
-  nodedata->olsr_path[nodedata->olsr_path_index] = dest;
-  nodedata->olsr_path_index++;
+
+  return length;
 }
 
 
-// Funtion that implements Dijkstra's single source shortest path algorithm
-// for a graph represented using adjacency matrix representation
-void dijkstra(call_t *to, int src, int dst)
+/** \brief Function to extract only the first hop from src to dst out of a shortest path tree (OLSRv2)
+ *  \fn int route_get_first_hop_olsrv2(int prev[], int src, int dst)
+ *  \param prev is the predecessor array filled by route_spf_olsrv2
+ *  \param src is the root of the shortest path tree
+ *  \param dst is the destination node
+ *  \return the nexthop towards dst, -1 if dst is unreachable
+ **/
+int route_get_first_hop_olsrv2(int prev[], int src, int dst) {
+  int node = dst;
+  int hops = 0;
+
+  if (dst == src) {
+    return -1;
+  }
+
+  while (prev[node] != src) {
+    node = prev[node];
+    if (node == -1 || ++hops >= MAX_NEIGHBORS_SIZE) {
+      return -1;
+    }
+  }
+
+  return node;
+}
+
+
+/** \brief Function to run the shortest path first algorithm over the local topology matrix (OLSRv2)
+ *  \fn void route_spf_olsrv2(call_t *to, int src, int dist[], int prev[])
+ *  \param to is a pointer to the called entity
+ *  \param src is the root of the shortest path tree
+ *  \param dist is filled with the hop distance from src to each node (INT_MAX if unreachable)
+ *  \param prev is filled with the predecessor of each node in the shortest path tree (-1 for the root)
+ **/
+void route_spf_olsrv2(call_t *to, int src, int dist[], int prev[])
 {
   struct nodedata *nodedata = get_node_private_data(to);
-  
-  int dist[MAX_NEIGHBORS_SIZE];     // The output array.  dist[i] will hold the shortest
-  // distance from src to i
-  int prev[MAX_NEIGHBORS_SIZE];
 
   int sptSet[MAX_NEIGHBORS_SIZE]; // sptSet[i] will true if vertex i is included in shortest
   // path tree or shortest distance from src to i is finalized
   int i = 0;
   // Initialize all distances as INFINITE and stpSet[] as false
   for (i = 0; i < MAX_NEIGHBORS_SIZE; i++)
-    dist[i] = INT_MAX, sptSet[i] = false, prev[i] = -1, nodedata->olsr_path[i] = -1;
- 
-  nodedata->olsr_path_index = 0;
+    dist[i] = INT_MAX, sptSet[i] = false, prev[i] = -1;
 
   // Distance of source vertex from itself is always 0
   dist[src] = 0;
@@ -1073,20 +2145,41 @@ void dijkstra(call_t *to, int src, int dst)
 	  prev[v] = u;
 	}
     }
+}
+
+
+// Funtion that implements Dijkstra's single source shortest path algorithm
+// for a graph represented using adjacency matrix representation
+void dijkstra(call_t *to, int src, int dst)
+{
+  struct nodedata *nodedata = get_node_private_data(to);
+  
+  int dist[MAX_NEIGHBORS_SIZE];     // The output array.  dist[i] will hold the shortest
+  // distance from src to i
+  int prev[MAX_NEIGHBORS_SIZE];
+  int i = 0;
+
+  for (i = 0; i < MAX_NEIGHBORS_SIZE; i++)
+    nodedata->olsr_path[i] = -1;
+ 
+  nodedata->olsr_path_index = 0;
+
+  route_spf_olsrv2(to, src, dist, prev);
  
   // print the constructed distance array
   //printSolution(dist, MAX_NEIGHBORS_SIZE);
 
-  // print detailed paths
-  printPath(nodedata, dst, prev);
+  // extract detailed paths
+  int length = route_get_path_olsrv2(prev, src, dst, nodedata->olsr_path, MAX_NEIGHBORS_SIZE);
 
   int j = 0;
-  if (dist[dst] == INT_MAX){
-  	printf("[DIJKSTRA_LOG] Node %d - No route to destination %d - dist = %f\n", to->object, dst,dist[dst]);
+  if (length == -1){
+  	printf("[DIJKSTRA_LOG] Node %d - No route to destination %d - dist = %d\n", to->object, dst,dist[dst]);
 	 for (i = 0; i < MAX_NEIGHBORS_SIZE; i++)
     		nodedata->olsr_path[i] = -1, nodedata->olsr_path_index = 0;
   }
   else {
+  	nodedata->olsr_path_index = length;
   	printf("[DIJKSTRA_LOG] Node %d - Path from %d to %d = ", to->object, src, dst);
   	for (j = 0; j < nodedata->olsr_path_index; j++) {
     		printf("%d -> ", nodedata->olsr_path[j]);
@@ -1094,6 +2187,67 @@ void dijkstra(call_t *to, int src, int dst)
   	printf("\n");
   }
 }
+
+
+/** \brief Function to rebuild the whole OLSRv2 routing table with a single SPF run
+ *  \fn int route_compute_olsrv2(call_t *to)
+ *  \param to is a pointer to the called entity
+ *  \return the number of reachable destinations
+ **/
+int route_compute_olsrv2(call_t *to)
+{
+  struct nodedata *nodedata = get_node_private_data(to);
+  struct route_olsrv2 *route = NULL;
+
+  int dist[MAX_NEIGHBORS_SIZE];
+  int prev[MAX_NEIGHBORS_SIZE];
+  int i = 0, j = 0, length = 0;
+
+  /* flush the routes computed from the previous topology */
+  while ((route = (struct route_olsrv2 *) list_pop(nodedata->routing_table)) != NULL) {
+    free(route);
+  }
+  for (i = 0; i < MAX_NEIGHBORS_SIZE; i++) {
+    nodedata->route_index[i] = NULL;
+  }
+
+  /* one shortest path tree rooted at the current node gives the routes towards all destinations */
+  route_spf_olsrv2(to, to->object, dist, prev);
+
+  for (i = 0; i < MAX_NEIGHBORS_SIZE; i++) {
+    if (i == to->object || dist[i] == INT_MAX) {
+      continue;
+    }
+
+    route = (struct route_olsrv2 *) malloc(sizeof(struct route_olsrv2));
+    route->dst = i;
+    route->nexthop_id = route_get_first_hop_olsrv2(prev, to->object, i);
+    route->nexthop_lqe = -1;
+    route->hop_to_dst = dist[i];
+    route->time = get_time();
+    route->seq_rreq = -1;
+    route->seq_rrep = -1;
+
+    /* extract the path towards i from the shortest path tree (only needed for source routing) */
+    length = 0;
+    if (nodedata->olsr_forwarding_mode == OLSR_SOURCE_ROUTING) {
+      length = route_get_path_olsrv2(prev, to->object, i, route->path, MAX_NEIGHBORS_SIZE);
+    }
+    for (j = (length > 0) ? length : 0; j < MAX_NEIGHBORS_SIZE; j++) {
+      route->path[j] = -1;
+    }
+    list_insert(nodedata->routing_table, (void *) route);
+    nodedata->route_index[i] = route;
+  }
+
+  nodedata->olsr_topology_changed = 0;
+
+#ifdef ROUTING_LOG_ROUTES
+  printf("[ROUTING_LOG_ROUTES] Time %lfs node %d has computed %d OLSRv2 routes\n", get_time()*0.000000001, to->object, list_getsize(nodedata->routing_table));
+#endif
+
+  return list_getsize(nodedata->routing_table);
+}
  
 
 
@@ -1107,11 +2261,9 @@ int route_forward_tc_packet(call_t *to, call_t *from, packet_t* packet) {
   struct nodedata *nodedata = get_node_private_data(to);
   struct classdata *classdata = get_class_private_data(to);
   
-  field_t *field_header = packet_retrieve_field(packet, "packet_header");
-  struct packet_header* header = (struct packet_header*) field_getValue(field_header);
+  struct packet_header* header = (struct packet_header*) packet_header_get(to, packet, HEADER_FIELD_PACKET);
   
-  field_t *field_tc_header = packet_retrieve_field(packet, "tc_packet_header");
-  struct tc_packet_header* tc_header = (struct tc_packet_header*) field_getValue(field_tc_header);
+  struct tc_packet_header* tc_header = (struct tc_packet_header*) packet_header_get(to, packet, HEADER_FIELD_TC);
   int i = 0;
 
   call_t to0   = {get_class_bindings_down(to)->elts[0], to->object};
@@ -1143,11 +2295,9 @@ int route_forward_tc_packet(call_t *to, call_t *from, packet_t* packet) {
  *  \param packet is a pointer to the received packet
  *  \return 0 if success, -1 otherwise
  **/
-int route_update_from_data_packet(call_t *to, packet_t *packet, int last_src) {
+int route_update_from_data_packet(call_t *to, struct packet_header *header, int last_src) {
   struct nodedata *nodedata = get_node_private_data(to);
   
-  field_t *field_header = packet_retrieve_field(packet, "packet_header");
-  struct packet_header* header = (struct packet_header*) field_getValue(field_header);
 
  
   struct route *route;
@@ -1202,16 +2352,14 @@ int route_update_from_data_packet(call_t *to, packet_t *packet, int last_src) {
 }
 
 /** \brief Function to update the local routing table according to received interest packets
- *  \fn  int route_update_from_oracenet_data_packet(call_t *to, packet_t *packet)
+ *  \fn  int route_update_from_oracenet_data_packet(call_t *to, struct packet_header *header, int last_src)
  *  \param c is a pointer to the called entity
- *  \param packet is a pointer to the received packet
+ *  \param header is a pointer to the packet header of the received packet
  *  \return 0 if success, -1 otherwise
  **/
-int route_update_from_oracenet_data_packet(call_t *to, packet_t *packet, int last_src) {
+int route_update_from_oracenet_data_packet(call_t *to, struct packet_header *header, int last_src) {
   struct nodedata *nodedata = get_node_private_data(to);
   
-  field_t *field_header = packet_retrieve_field(packet, "packet_header");
-  struct packet_header* header = (struct packet_header*) field_getValue(field_header);
   
   struct route *route;
   int updated = 0;
@@ -1263,16 +2411,17 @@ int route_update_from_oracenet_data_packet(call_t *to, packet_t *packet, int las
 #endif
   }
 
+  /* send the data packets waiting for this (reverse) route */
+  route_pending_flush_oracenet(to, header->src);
+
   return 0;
 }
 
 /* #ORACENET# GET LQE PAREMETERS */
 
-void route_get_oracenet_lqe(call_t *to, packet_t *packet, int nexthop) {
+void route_get_oracenet_lqe(call_t *to, struct packet_header *header, int nexthop) {
   struct nodedata *nodedata = get_node_private_data(to);
   
-  field_t *field_header = packet_retrieve_field(packet, "packet_header");
-  struct packet_header* header = (struct packet_header*) field_getValue(field_header);
   
   struct neighbor *neighbor;
 
@@ -1299,11 +2448,9 @@ void route_get_oracenet_lqe(call_t *to, packet_t *packet, int nexthop) {
 /* ON FORWARD -> UPDATE LQE FUNCTION */
 
 
-void route_update_oracenet_prr(call_t *to, packet_t *packet, int nexthop) {
+void route_update_oracenet_prr(call_t *to, struct packet_header *header, int nexthop) {
   struct nodedata *nodedata = get_node_private_data(to);
   
-  field_t *field_header = packet_retrieve_field(packet, "packet_header");
-  struct packet_header* header = (struct packet_header*) field_getValue(field_header);
   
   struct neighbor *neighbor;
 
@@ -1319,11 +2466,9 @@ void route_update_oracenet_prr(call_t *to, packet_t *packet, int nexthop) {
 }
 
 
-void route_update_oracenet_prr_from_adv(call_t *to, packet_t *packet, int prevhop) {
+void route_update_oracenet_prr_from_adv(call_t *to, struct packet_header *header, int prevhop) {
   struct nodedata *nodedata = get_node_private_data(to);
   
-  field_t *field_header = packet_retrieve_field(packet, "packet_header");
-  struct packet_header* header = (struct packet_header*) field_getValue(field_header);
   
   struct neighbor *neighbor;
   struct route *route;
@@ -1353,11 +2498,9 @@ void route_update_oracenet_prr_from_adv(call_t *to, packet_t *packet, int prevho
 }
 
 
-void route_update_oracenet_prr_from_hello(call_t *to, packet_t *packet, int prevhop) {
+void route_update_oracenet_prr_from_hello(call_t *to, struct packet_header *header, int prevhop) {
   struct nodedata *nodedata = get_node_private_data(to);
   
-  field_t *field_header = packet_retrieve_field(packet, "packet_header");
-  struct packet_header* header = (struct packet_header*) field_getValue(field_header);
   
   struct neighbor *neighbor;
   struct route *route;
@@ -17,6 +17,22 @@ typedef int bool;
 #define false 0
 
 
+/** \brief Function to resolve the packet header handles into field names, once per class (to be called by init())
+ *  \fn void packet_header_fields_init(struct classdata *classdata)
+ *  \param classdata is a pointer to the class data
+ **/
+void packet_header_fields_init(struct classdata *classdata);
+
+/** \brief Function to retrieve a header of a packet from its handle
+ *  \fn void* packet_header_get(call_t *to, packet_t *packet, int handle)
+ *  \param c is a pointer to the called entity
+ *  \param packet is a pointer to the packet
+ *  \param handle is the handle of the header (HEADER_FIELD_*)
+ *  \return a pointer to the header, NULL if the packet does not carry it
+ **/
+void* packet_header_get(call_t *to, packet_t *packet, int handle);
+
+
 /** \brief Function to forward received data packet towards the destination (Directed Diffusion)
  *  \fn void route_forward_data_packet(call_t *to, packet_t *packet)
  *  \param c is a pointer to the called entity
@@ -33,6 +49,14 @@ void route_forward_data_packet(call_t *to, call_t *from, packet_t *packet);
 void route_forward_data_packet_to_destination(call_t *to, call_t *from, packet_t *packet);
 
 
+/** \brief Function to forward received data packet towards the destination (OLSRv2)
+ *  \fn void route_forward_olsrv2_data_packet_to_destination(call_t *to, call_t *from, packet_t *packet)
+ *  \param c is a pointer to the called entity
+ *  \param packet is a pointer to the received packet
+ **/
+void route_forward_olsrv2_data_packet_to_destination(call_t *to, call_t *from, packet_t *packet);
+
+
 /** \brief Function to forward received RREP packet towards the destination (AODV)
  *  \fn int route_forward_rrep_packet(call_t *to, packet_t* packet)
  *  \param c is a pointer to the called entity
@@ -54,30 +78,42 @@ int route_update_from_hello(call_t *to, struct packet_header *header, struct hel
 
 
 /** \brief Function to update the local routing table according to received interest packets
- *  \fn  int route_update_from_interest(call_t *to, packet_t *packet)
+ *  \fn  int route_update_from_interest(call_t *to, struct packet_header *header, struct sink_interest_packet_header *interest_header)
  *  \param c is a pointer to the called entity
- *  \param packet is a pointer to the received packet
+ *  \param header is a pointer to the packet header of the received packet
+ *  \param interest_header is a pointer to the interest header of the received packet
  *  \return 0 if success, -1 otherwise
  **/
-int route_update_from_interest(call_t *to, packet_t *packet);
+int route_update_from_interest(call_t *to, struct packet_header *header, struct sink_interest_packet_header *interest_header);
+
+/** \brief Function to update the local routing table according to a received interest and to release the data packets waiting for this sink (ORACENET)
+ *  \fn  int route_update_from_oracenet_interest(call_t *to, struct packet_header *header, struct sink_interest_packet_header *interest_header)
+ *  \param c is a pointer to the called entity
+ *  \param header is a pointer to the packet header of the received packet
+ *  \param interest_header is a pointer to the interest header of the received packet
+ *  \return 0 if success, -1 otherwise
+ **/
+int route_update_from_oracenet_interest(call_t *to, struct packet_header *header, struct sink_interest_packet_header *interest_header);
 
  
 /** \brief Function to update the local routing table according to received RREQ packets
- *  \fn  int route_update_from_rreq(call_t *to, packet_t *packet)
+ *  \fn  int route_update_from_rreq(call_t *to, struct packet_header *header, struct rreq_packet_header *rreq_header)
  *  \param c is a pointer to the called entity
- *  \param packet is a pointer to the received packet
+ *  \param header is a pointer to the packet header of the received packet
+ *  \param rreq_header is a pointer to the RREQ header of the received packet
  *  \return 0 if success, -1 otherwise
  **/
-int route_update_from_rreq(call_t *to, packet_t *packet);
+int route_update_from_rreq(call_t *to, struct packet_header *header, struct rreq_packet_header *rreq_header);
 
 
 /** \brief Function to update the local routing table according to received RREP packets
- *  \fn  int route_update_from_rrep(call_t *to, packet_t *packet)
+ *  \fn  int route_update_from_rrep(call_t *to, struct packet_header *header, struct rrep_packet_header *rrep_header)
  *  \param c is a pointer to the called entity
- *  \param packet is a pointer to the received packet
+ *  \param header is a pointer to the packet header of the received packet
+ *  \param rrep_header is a pointer to the RREP header of the received packet
  *  \return 0 if success, -1 otherwise
  **/
-int route_update_from_rrep(call_t *to, packet_t *packet);
+int route_update_from_rrep(call_t *to, struct packet_header *header, struct rrep_packet_header *rrep_header);
 
 
 /** \brief Function to compute the nexthop towards the closest SINK node (Directed Diffusion)
@@ -88,6 +124,72 @@ int route_update_from_rrep(call_t *to, packet_t *packet);
  **/
 struct route* route_get_nexthop(call_t *to, int sink_id);
 
+/** \brief Function to get the gradient entry of a given (sink, data type) (Directed Diffusion)
+ *  \fn struct gradient_entry* gradient_lookup(call_t *to, int sink_id, int data_type, int create)
+ *  \param c is a pointer to the called entity
+ *  \param sink_id is the sink ID
+ *  \param data_type is the requested data type
+ *  \param create is set to create the entry if it does not exist
+ *  \return NULL if failure, otherwise a pointer to the entry
+ **/
+struct gradient_entry* gradient_lookup(call_t *to, int sink_id, int data_type, int create);
+
+/** \brief Function to remove the expired gradients of an entry and to select its nexthop (Directed Diffusion)
+ *  \fn void gradient_select(call_t *to, struct gradient_entry *entry)
+ *  \param c is a pointer to the called entity
+ *  \param entry is a pointer to the gradient entry
+ **/
+void gradient_select(call_t *to, struct gradient_entry *entry);
+
+/** \brief Function to get the selected gradient of an entry (Directed Diffusion)
+ *  \fn struct gradient* gradient_get_nexthop(call_t *to, struct gradient_entry *entry)
+ *  \param c is a pointer to the called entity
+ *  \param entry is a pointer to the gradient entry (may be NULL)
+ *  \return NULL if failure, otherwise a pointer to the selected gradient
+ **/
+struct gradient* gradient_get_nexthop(call_t *to, struct gradient_entry *entry);
+
+/** \brief Function to get the gradient entry of the closest sink (Directed Diffusion)
+ *  \fn struct gradient_entry* gradient_get_closest(call_t *to, int sink_id)
+ *  \param c is a pointer to the called entity
+ *  \param sink_id is the sink ID (-1 for any sink)
+ *  \return NULL if failure, otherwise a pointer to the entry
+ **/
+struct gradient_entry* gradient_get_closest(call_t *to, int sink_id);
+
+/** \brief Function to update the gradients according to a received exploratory interest (Directed Diffusion)
+ *  \fn int gradient_update_from_interest(call_t *to, struct packet_header *header, struct sink_interest_packet_header *interest_header)
+ *  \param c is a pointer to the called entity
+ *  \param header is a pointer to the packet header of the received packet
+ *  \param interest_header is a pointer to the interest header of the received packet
+ *  \return 0 if success, -1 otherwise
+ **/
+int gradient_update_from_interest(call_t *to, struct packet_header *header, struct sink_interest_packet_header *interest_header);
+
+/** \brief Function to apply a positive or negative reinforcement received from a neighbor (Directed Diffusion)
+ *  \fn int gradient_reinforce(call_t *to, struct packet_header *header, struct sink_interest_packet_header *interest_header)
+ *  \param c is a pointer to the called entity
+ *  \param header is a pointer to the packet header of the received packet
+ *  \param interest_header is a pointer to the interest header of the received packet
+ *  \return the neighbor to which the reinforcement has to be propagated, -1 if none
+ **/
+int gradient_reinforce(call_t *to, struct packet_header *header, struct sink_interest_packet_header *interest_header);
+
+/** \brief Function to update the reinforcements of a sink according to a received data packet (Directed Diffusion)
+ *  \fn int gradient_update_from_data(call_t *to, struct packet_header *header, int *reinforcement)
+ *  \param c is a pointer to the called entity
+ *  \param header is a pointer to the packet header of the received packet
+ *  \param reinforcement is set to the reinforcement to send to the previous hop (REINFORCEMENT_NONE if none)
+ *  \return 1 if the data packet is a duplicate, 0 otherwise
+ **/
+int gradient_update_from_data(call_t *to, struct packet_header *header, int *reinforcement);
+
+/** \brief Function to destroy the gradient table (Directed Diffusion)
+ *  \fn void gradient_destroy(call_t *to)
+ *  \param c is a pointer to the called entity
+ **/
+void gradient_destroy(call_t *to);
+
  
 /** \brief Function to compute the nexthop towards a given destination (AODV)
  *  \fn   struct route_aodv* route_get_nexthop_to_destination(call_t *to, int dst)
@@ -97,7 +199,233 @@ struct route* route_get_nexthop(call_t *to, int sink_id);
  **/
 struct route_aodv* route_get_nexthop_to_destination(call_t *to, int dst);
 
+/** \brief Function to add a new route in the local routing table (AODV)
+ *  \fn struct route_aodv* route_aodv_insert(call_t *to, int dst, int nexthop, int hop_to_dst, int seq)
+ *  \param c is a pointer to the called entity
+ *  \param dst is the ID of the destination
+ *  \param nexthop is the ID of the nexthop towards dst
+ *  \param hop_to_dst is the number of hops towards dst
+ *  \param seq is the sequence number related to the route creation
+ *  \return a pointer to the new route
+ **/
+struct route_aodv* route_aodv_insert(call_t *to, int dst, int nexthop, int hop_to_dst, int seq);
+
+/** \brief Function to remove and free a route of the local routing table (AODV)
+ *  \fn void route_aodv_remove(call_t *to, struct route_aodv *route)
+ *  \param c is a pointer to the called entity
+ *  \param route is a pointer to the route to remove
+ **/
+void route_aodv_remove(call_t *to, struct route_aodv *route);
+
+/** \brief Function to extend the lifetime of an active route (AODV)
+ *  \fn void route_aodv_refresh(call_t *to, struct route_aodv *route)
+ *  \param c is a pointer to the called entity
+ *  \param route is a pointer to the active route
+ **/
+void route_aodv_refresh(call_t *to, struct route_aodv *route);
+
+/** \brief Function to add a neighbor to the precursor list of a route (AODV)
+ *  \fn void route_aodv_add_precursor(call_t *to, struct route_aodv *route, int precursor)
+ *  \param c is a pointer to the called entity
+ *  \param route is a pointer to the route
+ *  \param precursor is the ID of the upstream neighbor using the route
+ **/
+void route_aodv_add_precursor(call_t *to, struct route_aodv *route, int precursor);
+
+/** \brief Function to handle the loss of a nexthop node: remove the related routes and locally repair the active ones (AODV)
+ *  \fn int route_aodv_link_failure(call_t *to, int nexthop)
+ *  \param c is a pointer to the called entity
+ *  \param nexthop is the ID of the lost neighbor
+ *  \return the number of removed routes
+ **/
+int route_aodv_link_failure(call_t *to, int nexthop);
+
+/** \brief Function to get the waiting packets entry of a given destination (AODV, ORACENET)
+ *  \fn struct pending_destination* route_pending_lookup(call_t *to, int dst, int create)
+ *  \param c is a pointer to the called entity
+ *  \param dst is the final destination of the waiting packets
+ *  \param create is set to create the entry if it does not exist
+ *  \return NULL if failure, otherwise a pointer to the entry
+ **/
+struct pending_destination* route_pending_lookup(call_t *to, int dst, int create);
+
+/** \brief Function to destroy the waiting packets entry of a destination together with its packets (AODV, ORACENET)
+ *  \fn void route_pending_release(call_t *to, struct pending_destination *pending)
+ *  \param c is a pointer to the called entity
+ *  \param pending is a pointer to the entry
+ **/
+void route_pending_release(call_t *to, struct pending_destination *pending);
+
+/** \brief Function to drop the packets which have been waiting longer than the pending timeout (AODV, ORACENET)
+ *  \fn int route_pending_purge(call_t *to, struct pending_destination *pending)
+ *  \param c is a pointer to the called entity
+ *  \param pending is a pointer to the entry
+ *  \return the number of packets still waiting
+ **/
+int route_pending_purge(call_t *to, struct pending_destination *pending);
+
+/** \brief Function to buffer a data packet until a route towards its destination is known (AODV, ORACENET)
+ *  \fn int route_pending_insert(call_t *to, packet_t *packet, int dst)
+ *  \param c is a pointer to the called entity
+ *  \param packet is a pointer to the data packet
+ *  \param dst is the final destination of the packet
+ *  \return the number of packets waiting for dst
+ **/
+int route_pending_insert(call_t *to, packet_t *packet, int dst);
+
+/** \brief Function to send in bulk the data packets waiting for a newly available route (AODV, ORACENET)
+ *  \fn int route_pending_flush(call_t *to, int dst, void (*forward)(call_t *, call_t *, packet_t *))
+ *  \param c is a pointer to the called entity
+ *  \param dst is the destination of the new route
+ *  \param forward is the protocol function forwarding a data packet along the new route
+ *  \return the number of sent packets
+ **/
+int route_pending_flush(call_t *to, int dst, void (*forward)(call_t *, call_t *, packet_t *));
+
+/** \brief Function to send the data packets waiting for a destination once a route towards it is known (ORACENET)
+ *  \fn int route_pending_flush_oracenet(call_t *to, int dst)
+ *  \param c is a pointer to the called entity
+ *  \param dst is the destination of the waiting packets (BROADCAST_ADDR for the closest sink)
+ *  \return the number of sent packets
+ **/
+int route_pending_flush_oracenet(call_t *to, int dst);
+
+/** \brief Function to destroy all the waiting packets (AODV, ORACENET)
+ *  \fn void route_pending_destroy(call_t *to)
+ *  \param c is a pointer to the called entity
+ **/
+void route_pending_destroy(call_t *to);
+
+/** \brief Hash function of the duplicate detection table (source node ID)
+ *  \fn unsigned long route_duplicate_hash(void *key)
+ *  \param key is the source node ID
+ *  \return the hash value
+ **/
+unsigned long route_duplicate_hash(void *key);
+
+/** \brief Comparison function of the duplicate detection table
+ *  \fn int route_duplicate_equal(void *key0, void *key1)
+ *  \param key0 is the first source node ID
+ *  \param key1 is the second source node ID
+ *  \return 1 if the keys are equal, 0 otherwise
+ **/
+int route_duplicate_equal(void *key0, void *key1);
+
+/** \brief Function to check whether a data packet was already received, and to record it otherwise (Directed Diffusion, ORACENET).
+ *  Sliding window of DUPLICATE_WINDOW_SIZE sequence numbers per source: reordered packets are accepted, packets older than the window are dropped.
+ *  \fn int route_duplicate_check(call_t *to, int src, int seq)
+ *  \param c is a pointer to the called entity
+ *  \param src is the source of the data packet
+ *  \param seq is the sequence number of the data packet
+ *  \return 1 if the data packet is a duplicate, 0 otherwise
+ **/
+int route_duplicate_check(call_t *to, int src, int seq);
+
+/** \brief Function to destroy the duplicate detection table (Directed Diffusion, ORACENET)
+ *  \fn void route_duplicate_destroy(call_t *to)
+ *  \param c is a pointer to the called entity
+ **/
+void route_duplicate_destroy(call_t *to);
+
+/** \brief Function to set the aggregation function of a data type from a "data_type:function" parameter (Directed Diffusion, ORACENET)
+ *  \fn int route_aggregation_set(struct nodedata *nodedata, char *value)
+ *  \param nodedata is a pointer to the node private data
+ *  \param value is the parameter value (e.g. "3:avg"), the function being concat, min, max, avg, count or off
+ *  \return 0 if success, -1 otherwise
+ **/
+int route_aggregation_set(struct nodedata *nodedata, char *value);
+
+/** \brief Function to get the aggregate header of a data packet, creating it from the packet reading if needed (Directed Diffusion, ORACENET)
+ *  \fn struct data_aggregate_header* route_aggregate_header(call_t *to, packet_t *packet, struct packet_header *header, int function)
+ *  \param c is a pointer to the called entity
+ *  \param packet is a pointer to the data packet
+ *  \param header is a pointer to the packet header of the data packet
+ *  \param function is the aggregation function
+ *  \return a pointer to the aggregate header
+ **/
+struct data_aggregate_header* route_aggregate_header(call_t *to, packet_t *packet, struct packet_header *header, int function);
+
+/** \brief Function to merge a data packet into an aggregate and to destroy it (Directed Diffusion, ORACENET)
+ *  \fn struct data_aggregate_header* route_aggregate_merge(call_t *to, packet_t *aggregate, packet_t *packet, struct packet_header *header, int function)
+ *  \param c is a pointer to the called entity
+ *  \param aggregate is a pointer to the aggregate (its aggregate header is set when it is held)
+ *  \param packet is a pointer to the merged data packet
+ *  \param header is a pointer to the packet header of the merged data packet
+ *  \param function is the aggregation function
+ *  \return a pointer to the aggregate header of the aggregate
+ **/
+struct data_aggregate_header* route_aggregate_merge(call_t *to, packet_t *aggregate, packet_t *packet, struct packet_header *header, int function);
+
+/** \brief Function to hold a data packet for aggregation before forwarding it (Directed Diffusion, ORACENET)
+ *  \fn void route_aggregate_data_packet(call_t *to, call_t *from, packet_t *packet, int dst, void (*forward)(call_t *, call_t *, packet_t *))
+ *  \param c is a pointer to the called entity
+ *  \param packet is a pointer to the received data packet
+ *  \param dst is the destination (sink) of the data packet
+ *  \param forward is the protocol forwarding function
+ **/
+void route_aggregate_data_packet(call_t *to, call_t *from, packet_t *packet, int dst, void (*forward)(call_t *, call_t *, packet_t *));
+
+/** \brief Callback function to forward an aggregate at the end of its holding time (to be used with the scheduler_add_callback function).
+ *  \fn int route_aggregation_callback(call_t *to, call_t *from, void *args)
+ *  \param c is a pointer to the called entity
+ *  \param args is a pointer to the aggregation entry
+ *  \return 0 if success, -1 otherwise
+ **/
+int route_aggregation_callback(call_t *to, call_t *from, void *args);
+
+/** \brief Function to forward the aggregate of an aggregation entry (Directed Diffusion, ORACENET)
+ *  \fn void route_aggregation_flush(call_t *to, struct data_aggregation *aggregation)
+ *  \param c is a pointer to the called entity
+ *  \param aggregation is a pointer to the aggregation entry
+ **/
+void route_aggregation_flush(call_t *to, struct data_aggregation *aggregation);
+
+/** \brief Function to destroy the aggregation entries and the held packets (Directed Diffusion, ORACENET)
+ *  \fn void route_aggregation_destroy(call_t *to)
+ *  \param c is a pointer to the called entity
+ **/
+void route_aggregation_destroy(call_t *to);
+
+/** \brief Function to forward received data packet towards the destination (ORACENET)
+ *  \fn void route_forward_oracenet_data_packet(call_t *to, call_t *from, packet_t *packet)
+ *  \param c is a pointer to the called entity
+ *  \param packet is a pointer to the received packet
+ **/
+void route_forward_oracenet_data_packet(call_t *to, call_t *from, packet_t *packet);
+
+/** \brief Function to rank the routes towards a given destination by E2E PRR: the primary next hop first, then the backup ones (ORACENET)
+ *  \fn int route_rank_oracenet(call_t *to, int dst, struct route *ranked[MAX_ORACENET_NEXTHOPS])
+ *  \param c is a pointer to the called entity
+ *  \param dst is the ID of the destination
+ *  \param ranked is filled with the best routes, by decreasing E2E PRR
+ *  \return the number of ranked routes
+ **/
+int route_rank_oracenet(call_t *to, int dst, struct route *ranked[MAX_ORACENET_NEXTHOPS]);
+
+/** \brief Function to compute the nexthop towards a given destination (ORACENET)
+ *  \fn   struct route* route_get_nexthop_to_destination_oracenet(call_t *to, int dst)
+ *  \param c is a pointer to the called entity
+ *  \param dst is the ID of the destination
+ *  \return NULL if failure, otherwise the route through the primary nexthop node (best E2E PRR)
+ **/
 struct route* route_get_nexthop_to_destination_oracenet(call_t *to, int dst);
+
+/** \brief Function to select the nexthop of a data packet towards a given destination (ORACENET).
+ *  The primary nexthop is used, unless load_split_threshold is set: the load is then split over the nexthops
+ *  whose E2E PRR is within this relative gap of the primary one, in proportion to their E2E PRR.
+ *  \fn   struct route* route_select_oracenet(call_t *to, int dst)
+ *  \param c is a pointer to the called entity
+ *  \param dst is the ID of the destination
+ *  \return NULL if failure, otherwise the route through the selected nexthop node
+ **/
+struct route* route_select_oracenet(call_t *to, int dst);
+
+/** \brief Function to handle a link-layer transmission failure towards a nexthop: its routes are dropped, the backup nexthops take over (ORACENET)
+ *  \fn   void route_link_failure_oracenet(call_t *to, int nexthop)
+ *  \param c is a pointer to the called entity
+ *  \param nexthop is the ID of the unreachable nexthop
+ **/
+void route_link_failure_oracenet(call_t *to, int nexthop);
 struct route* oracenet_route_get_nexthop(call_t *to, int dst);
 
 /** \brief Function to list the routing table on the standard output (Directed Diffusion)
@@ -132,10 +460,54 @@ int route_forward_tc_packet(call_t *to, call_t *from, packet_t* packet) ;
  *  \param to is a pointer to the called entity
  *  \param src is the source of the packet
  *  \param dst is the final destination of the packet
- *  \ printsolution, minDistance and printpath are used with Dijkstra
+ *  \ printsolution, minDistance and route_get_path_olsrv2 are used with Dijkstra
  **/
 void dijkstra(call_t *to, int src, int dst);
 
+/** \brief Function to run the shortest path first algorithm over the local topology matrix (OLSRv2)
+ *  \fn void route_spf_olsrv2(call_t *to, int src, int dist[], int prev[])
+ *  \param to is a pointer to the called entity
+ *  \param src is the root of the shortest path tree
+ *  \param dist is filled with the hop distance from src to each node (INT_MAX if unreachable)
+ *  \param prev is filled with the predecessor of each node in the shortest path tree (-1 for the root)
+ **/
+void route_spf_olsrv2(call_t *to, int src, int dist[], int prev[]);
+
+/** \brief Function to extract the path from src to dst out of a shortest path tree (OLSRv2)
+ *  \fn int route_get_path_olsrv2(int prev[], int src, int dst, int path[], int size)
+ *  \param prev is the predecessor array filled by route_spf_olsrv2
+ *  \param src is the root of the shortest path tree
+ *  \param dst is the destination node
+ *  \param path is the caller buffer receiving the nodes from src to dst
+ *  \param size is the capacity of the path buffer
+ *  \return the number of nodes of the path, -1 if dst is unreachable or the path does not fit in the buffer
+ **/
+int route_get_path_olsrv2(int prev[], int src, int dst, int path[], int size);
+
+/** \brief Function to extract only the first hop from src to dst out of a shortest path tree (OLSRv2)
+ *  \fn int route_get_first_hop_olsrv2(int prev[], int src, int dst)
+ *  \param prev is the predecessor array filled by route_spf_olsrv2
+ *  \param src is the root of the shortest path tree
+ *  \param dst is the destination node
+ *  \return the nexthop towards dst, -1 if dst is unreachable
+ **/
+int route_get_first_hop_olsrv2(int prev[], int src, int dst);
+
+/** \brief Function to rebuild the whole OLSRv2 routing table with a single SPF run
+ *  \fn int route_compute_olsrv2(call_t *to)
+ *  \param to is a pointer to the called entity
+ *  \return the number of reachable destinations
+ **/
+int route_compute_olsrv2(call_t *to);
+
+/** \brief Function to compute the nexthop towards a given destination (OLSRv2)
+ *  \fn   struct route_olsrv2* route_get_nexthop_to_destination_olsrv2(call_t *to, int dst)
+ *  \param c is a pointer to the called entity
+ *  \param dst is the ID of the destination
+ *  \return NULL if failure, otherwise the destination information of nexthop node
+ **/
+struct route_olsrv2* route_get_nexthop_to_destination_olsrv2(call_t *to, int dst);
+
 int printSolution(int dist[], int n);
 
 int minDistance(int dist[], bool sptSet[]);
@@ -146,23 +518,23 @@ int minDistance(int dist[], bool sptSet[]);
  *  \param packet is a pointer to the received packet
  *  \return 0 if success, -1 otherwise
  **/
-int route_update_from_oracenet_data_packet(call_t *to, packet_t *packet, int last_src);
+int route_update_from_oracenet_data_packet(call_t *to, struct packet_header *header, int last_src);
 
 //void route_neighbor_lqe_update(call_t *to, packet_t *packet)
 /** Brief Function to remove routes starting by neighbors that disappeared */
 void route_remove_oracenet(call_t *to, int nexthop);
 
-void route_get_oracenet_lqe(call_t *to, packet_t *packet, int nexthop);
+void route_get_oracenet_lqe(call_t *to, struct packet_header *header, int nexthop);
 
-void route_update_oracenet_prr_from_adv(call_t *to, packet_t *packet, int prevhop);
+void route_update_oracenet_prr_from_adv(call_t *to, struct packet_header *header, int prevhop);
 
-void route_update_oracenet_prr(call_t *to, packet_t *packet, int nexthop);
+void route_update_oracenet_prr(call_t *to, struct packet_header *header, int nexthop);
 
 int route_update_from_oracenet_hello_packet(call_t *to, struct packet_header *header, struct hello_packet_header *hello_header, double prr);
 
-void route_update_oracenet_prr_from_hello(call_t *to, packet_t *packet, int prevhop);
+void route_update_oracenet_prr_from_hello(call_t *to, struct packet_header *header, int prevhop);
 
-int oracenet_neighbor_update(call_t *to, packet_t *packet);
+int oracenet_neighbor_update(call_t *to, packet_t *packet, struct packet_header *header, struct hello_packet_header *hello_header);
 
 #endif  
 
@@ -20,13 +20,26 @@
  *  \return 0 if success, -1 otherwise
  **/
 int rreq_propagation_callback(call_t *to, call_t *from, void *args) {
+  struct nodedata *nodedata = get_node_private_data(to);
+  destination_t *dst = (destination_t*) args;
+
+  return rreq_broadcast(to, dst->id, nodedata->rreq_ttl);
+}
+
+/** \brief Function to broadcast a new RREQ packet with a given TTL (AODV)
+ *  \fn int rreq_broadcast(call_t *to, int dst, int ttl)
+ *  \param c is a pointer to the called entity
+ *  \param dst is the ID of the destination
+ *  \param ttl is the number of hops the RREQ packet may travel
+ *  \return 0 if success, -1 otherwise
+ **/
+int rreq_broadcast(call_t *to, int dst, int ttl) {
   struct nodedata *nodedata = get_node_private_data(to);
   struct classdata *classdata = get_class_private_data(to);
   
   call_t to0   = {get_class_bindings_down(to)->elts[0], to->object};
   call_t from0 = {to->class, to->object};
   destination_t destination = {BROADCAST_ADDR, {-1, -1, -1}};
-  destination_t *dst = (destination_t*) args;
 
   packet_t *packet = packet_create(to, nodedata->overhead + sizeof(struct packet_header)+sizeof(struct rreq_packet_header), nodedata->rreq_packet_real_size*8);
 
@@ -51,11 +64,11 @@ int rreq_propagation_callback(call_t *to, call_t *from, void *args) {
   header->packet_type = RREQ_PACKET;
 
   /* set basic packet header */
-  rreq_header->dst = dst->id;
+  rreq_header->dst = dst;
   rreq_header->src = to->object;
   rreq_header->seq = nodedata->rreq_seq++;
-  rreq_header->ttl = nodedata->rreq_ttl;
-  rreq_header->ttl_max = nodedata->rreq_ttl;
+  rreq_header->ttl = ttl;
+  rreq_header->ttl_max = ttl;
   rreq_header->data_type = nodedata->rreq_data_type;
   rreq_header->position.x = get_node_position(to->object)->x;
   rreq_header->position.y = get_node_position(to->object)->y;
@@ -83,80 +96,142 @@ int rreq_propagation_callback(call_t *to, call_t *from, void *args) {
   return 0;
 }
 
-/** \brief Callback function for the periodic generation of RREQ packets in AODV (to be used with the scheduler_add_callback function).
- *  \fn int rreq_periodic_generation_callback(call_t *to, void *args)
+/** \brief Function to start a route discovery towards a given destination, unless one is already in progress (AODV)
+ *  \fn int rreq_route_discovery(call_t *to, int dst)
  *  \param c is a pointer to the called entity
- *  \param args is a pointer to the arguments of the function
+ *  \param dst is the ID of the destination
  *  \return 0 if success, -1 otherwise
  **/
-int rreq_periodic_generation_callback(call_t *to, call_t *from, void *args) {
+int rreq_route_discovery(call_t *to, int dst) {
   struct nodedata *nodedata = get_node_private_data(to);
-  struct classdata *classdata = get_class_private_data(to);
-  call_t to0   = {get_class_bindings_down(to)->elts[0], to->object};
-  call_t from0 = {to->class, to->object};
-  
-  packet_t *packet = packet_create(to, nodedata->overhead + sizeof(struct packet_header)+sizeof(struct rreq_packet_header), nodedata->rreq_packet_real_size*8);
+  struct pending_destination *pending = route_pending_lookup(to, dst, 1);
 
-  struct packet_header *header = malloc(sizeof(struct packet_header));
-  field_t *field_packet_header = field_create(INT, sizeof(struct packet_header), header);
-  packet_add_field(packet, "packet_header", field_packet_header);
-  
-  struct rreq_packet_header *rreq_header = malloc(sizeof(struct rreq_packet_header));
-  field_t *field_rreq_header = field_create(INT, sizeof(struct rreq_packet_header), rreq_header);
-  packet_add_field(packet, "rreq_packet_header", field_rreq_header);
-  
-  struct route_aodv *route;
+  /* a single route discovery in flight per destination */
+  if (pending->rreq_deadline != 0) {
+    return 0;
+  }
 
-  /* broadcast a RREQ packet only if destination ID is known and a route to this destination does not exist */
-  if (nodedata->sink_id != -1 && (route = route_get_nexthop_to_destination(to, nodedata->sink_id)) == NULL) {
+  pending->rreq_nbr = 0;
+  pending->rreq_timeout = nodedata->rreq_discovery_timeout;
 
-    destination_t destination = {BROADCAST_ADDR, {-1, -1, -1}};
+  /* expanding ring search: the first attempts only reach the close neighborhood */
+  if (nodedata->rreq_ttl_start > 0 && nodedata->rreq_ttl_start <= nodedata->rreq_ttl_threshold) {
+    pending->rreq_ttl = nodedata->rreq_ttl_start;
+  }
+  else {
+    pending->rreq_ttl = nodedata->rreq_ttl;
+  }
 
-    /* set mac header */
-    if (SET_HEADER(&to0, to, packet, &destination) == -1) {
-      packet_dealloc(packet);
-      return -1;
-    }
-      
-    /* set basic packet header */
-    header->src = to->object;
-    header->dst = BROADCAST_ADDR;
-    header->type = nodedata->node_type;
-    header->packet_type = RREQ_PACKET;
-
-    /* set basic packet header */
-    rreq_header->dst = nodedata->sink_id;
-    rreq_header->src = to->object;
-    rreq_header->seq = nodedata->rreq_seq++;
-    rreq_header->ttl = nodedata->rreq_ttl;
-    rreq_header->ttl_max = nodedata->rreq_ttl;
-    rreq_header->data_type = nodedata->rreq_data_type;
-    rreq_header->position.x = get_node_position(to->object)->x;
-    rreq_header->position.y = get_node_position(to->object)->y;
-    rreq_header->position.z = get_node_position(to->object)->z;
-      
-    /* send SRC node RREQ packet */
-    TX(&to0, &from0, packet);
-      
-    /* if it is the first generated RREQ message => update the RREQ startup time variable */
-    if (nodedata->first_rreq_startup_time == 0) {
-      nodedata->first_rreq_startup_time = get_time();
+  return rreq_route_discovery_attempt(to, pending);
+}
+
+/** \brief Function to broadcast a RREQ packet for a route discovery and to schedule its timeout (AODV)
+ *  \fn int rreq_route_discovery_attempt(call_t *to, struct pending_destination *pending)
+ *  \param c is a pointer to the called entity
+ *  \param pending is a pointer to the waiting packets entry of the destination
+ *  \return 0 if success, -1 otherwise
+ **/
+int rreq_route_discovery_attempt(call_t *to, struct pending_destination *pending) {
+  struct nodedata *nodedata = get_node_private_data(to);
+  call_t from = {-1, -1};
+  uint64_t timeout = pending->rreq_timeout;
+
+  /* only the network-wide attempts are retries */
+  if (pending->rreq_ttl >= nodedata->rreq_ttl) {
+    pending->rreq_nbr++;
+  }
+  /* a ring only waits for the round trip over its TTL: each hop delays the RREQ and the RREP
+   * by at most their propagation backoff (RING_TRAVERSAL_TIME of RFC 3561) */
+  else {
+    timeout = (pending->rreq_ttl + RREQ_TIMEOUT_BUFFER) * (nodedata->rreq_propagation_backoff + nodedata->rrep_propagation_backoff);
+  }
+  pending->rreq_deadline = get_time() + timeout;
+  scheduler_add_callback(pending->rreq_deadline, to, &from, rreq_discovery_timeout_callback, (void *) ((long) pending->dst));
+
+#ifdef ROUTING_RREQ_GENERATION
+  printf("[ROUTING_RREQ_GENERATION] Time %lfs Node %d route discovery towards DST %d (attempt %d, TTL=%d, timeout %lfs)\n", get_time()*0.000000001, to->object, pending->dst, pending->rreq_nbr, pending->rreq_ttl, timeout*0.000000001);
+#endif
+
+  return rreq_broadcast(to, pending->dst, pending->rreq_ttl);
+}
+
+/** \brief Callback function for the end of a route discovery attempt (to be used with the scheduler_add_callback function) (AODV)
+ *  \fn int rreq_discovery_timeout_callback(call_t *to, call_t *from, void *args)
+ *  \param c is a pointer to the called entity
+ *  \param args is the ID of the destination
+ *  \return 0 if success, -1 otherwise
+ **/
+int rreq_discovery_timeout_callback(call_t *to, call_t *from, void *args) {
+  struct nodedata *nodedata = get_node_private_data(to);
+  struct pending_destination *pending = NULL;
+  int dst = (int) ((long) args);
+
+  /* stale timeout: the discovery ended or was restarted meanwhile */
+  if ((pending = route_pending_lookup(to, dst, 0)) == NULL || pending->rreq_deadline == 0 || get_time() < pending->rreq_deadline) {
+    return 0;
+  }
+  pending->rreq_deadline = 0;
+
+  /* the route has been found by other means */
+  if (route_get_nexthop_to_destination(to, dst) != NULL) {
+    route_pending_flush(to, dst, route_forward_data_packet_to_destination);
+    return 0;
+  }
+
+  /* nobody waits for this route anymore */
+  if (route_pending_purge(to, pending) == 0) {
+    route_pending_release(to, pending);
+    return 0;
+  }
+
+  /* expanding ring search: widen the ring, then flood the whole network */
+  if (pending->rreq_ttl < nodedata->rreq_ttl) {
+    pending->rreq_ttl += nodedata->rreq_ttl_increment;
+    if (pending->rreq_ttl > nodedata->rreq_ttl_threshold) {
+      pending->rreq_ttl = nodedata->rreq_ttl;
     }
-      
-    /* update local stats */
-    nodedata->tx_nbr[header->packet_type]++;
+    return rreq_route_discovery_attempt(to, pending);
+  }
 
-    /* update global stats */
-    classdata->current_tx_control_packet ++;
-    classdata->current_tx_control_packet_bytes += (packet->real_size/8);
-      
-    #ifdef ROUTING_RREQ_GENERATION
-    printf("[ROUTING_RREQ_GENERATION] Time %lfs Node %d broadcasts RREQ packet (dst=%d, seq=%d, data_type=%d, TTL=%d)\n", get_time()*0.000000001, to->object, rreq_header->dst, rreq_header->seq, rreq_header->data_type, rreq_header->ttl);
-    #endif
+  /* give up and drop the waiting packets */
+  if (pending->rreq_nbr > nodedata->rreq_retries) {
+#ifdef ROUTING_RREQ_GENERATION
+    printf("[ROUTING_RREQ_GENERATION] Time %lfs Node %d route discovery towards DST %d failed after %d attempts : %d data packets destroyed\n", get_time()*0.000000001, to->object, dst, pending->rreq_nbr, pending->size);
+#endif
+    route_pending_release(to, pending);
+    return 0;
+  }
+
+  /* retry with an exponential backoff */
+  pending->rreq_timeout *= 2;
+  return rreq_route_discovery_attempt(to, pending);
+}
+
+/** \brief Function to decide whether a periodic RREQ packet has to be built and sent (AODV)
+ *  \fn int rreq_should_send(call_t *to)
+ *  \param c is a pointer to the called entity
+ *  \return 1 if the RREQ packet has to be sent, 0 otherwise
+ **/
+int rreq_should_send(call_t *to) {
+  struct nodedata *nodedata = get_node_private_data(to);
+
+  return (nodedata->sink_id != -1 && route_get_nexthop_to_destination(to, nodedata->sink_id) == NULL);
+}
+
+/** \brief Callback function for the periodic generation of RREQ packets in AODV (to be used with the scheduler_add_callback function).
+ *  \fn int rreq_periodic_generation_callback(call_t *to, void *args)
+ *  \param c is a pointer to the called entity
+ *  \param args is a pointer to the arguments of the function
+ *  \return 0 if success, -1 otherwise
+ **/
+int rreq_periodic_generation_callback(call_t *to, call_t *from, void *args) {
+  struct nodedata *nodedata = get_node_private_data(to);
+
+  /* broadcast a RREQ packet only if destination ID is known and a route to this destination does not exist */
+  if (rreq_should_send(to)) {
+    rreq_broadcast(to, nodedata->sink_id, nodedata->rreq_ttl);
   }
   else {
-    packet_dealloc(packet);
-    
     #ifdef ROUTING_RREQ_GENERATION
     printf("[ROUTING_RREQ_GENERATION] Time %lfs Node %d RREQ broadcast is canceled !\n", get_time()*0.000000001, to->object);
     #endif
@@ -188,16 +263,24 @@ int rreq_propagation(call_t *to, call_t *from, void *args) {
   struct classdata *classdata = get_class_private_data(to);
   packet_t *packet = (packet_t *) args;
 
-  field_t *field_header = packet_retrieve_field(packet, "packet_header");
-  struct packet_header* header = (struct packet_header*) field_getValue(field_header);
+  struct packet_header* header = (struct packet_header*) packet_header_get(to, packet, HEADER_FIELD_PACKET);
   
-  field_t *field_rreq_header = packet_retrieve_field(packet, "rreq_packet_header");
-  struct rreq_packet_header* rreq_header = (struct rreq_packet_header*) field_getValue(field_rreq_header);
+  struct rreq_packet_header* rreq_header = (struct rreq_packet_header*) packet_header_get(to, packet, HEADER_FIELD_RREQ);
   
   call_t to0   = {get_class_bindings_down(to)->elts[0], to->object};
   call_t from0 = {to->class, to->object};
   
   destination_t destination = {BROADCAST_ADDR, {-1, -1, -1}};
+
+  /* end of the backoff: cancel the rebroadcast if enough neighbors already covered the area */
+  if (rreq_backoff_suppressed(to, rreq_header)) {
+#ifdef ROUTING_RREQ_GENERATION
+    printf("[ROUTING_RREQ_GENERATION] Time %lfs Node %d drop the RREQ packet from SRC %d  seq=%d  (TTL=%d) => suppressed !\n", get_time()*0.000000001, to->object, rreq_header->src, rreq_header->seq, rreq_header->ttl);
+#endif
+    rreq_table_update(to, rreq_header->src, rreq_header->dst, rreq_header->data_type, rreq_header->seq);
+    packet_dealloc(packet);
+    return 0;
+  }
   
   /* update TTL */
   if (rreq_header->ttl > 0) {
@@ -234,6 +317,9 @@ int rreq_propagation(call_t *to, call_t *from, void *args) {
     /* update basic packet header */
     header->src = to->object;
     header->type = nodedata->node_type;
+    rreq_header->position.x = get_node_position(to->object)->x;
+    rreq_header->position.y = get_node_position(to->object)->y;
+    rreq_header->position.z = get_node_position(to->object)->z;
 
     /* send SRC node RREQ packet */
     TX(&to0, &from0, packet);
@@ -263,6 +349,79 @@ int rreq_propagation(call_t *to, call_t *from, void *args) {
 }
 
 
+/** \brief Function to record a RREQ packet heard while waiting for its rebroadcast backoff (AODV)
+ *  \fn int rreq_backoff_update(call_t *to, struct rreq_packet_header *rreq_header)
+ *  \param c is a pointer to the called entity
+ *  \param rreq_header is a pointer to the received RREQ header
+ *  \return 0 if it is the first copy (the rebroadcast has to be scheduled), otherwise the number of heard copies
+ **/
+int rreq_backoff_update(call_t *to, struct rreq_packet_header *rreq_header) {
+  struct nodedata *nodedata = get_node_private_data(to);
+  struct rreq_backoff *backoff = NULL;
+  double dist = distance(get_node_position(to->object), &(rreq_header->position));
+
+  list_init_traverse(nodedata->rreq_backoff_table);
+  while((backoff = (struct rreq_backoff *) list_traverse(nodedata->rreq_backoff_table)) != NULL) {
+    if (backoff->src == rreq_header->src && backoff->dst == rreq_header->dst && backoff->data_type == rreq_header->data_type && backoff->seq == rreq_header->seq) {
+      backoff->copies++;
+      if (dist < backoff->distance) {
+        backoff->distance = dist;
+      }
+      return backoff->copies;
+    }
+  }
+
+  backoff = (struct rreq_backoff *) malloc(sizeof(struct rreq_backoff));
+  backoff->src = rreq_header->src;
+  backoff->dst = rreq_header->dst;
+  backoff->data_type = rreq_header->data_type;
+  backoff->seq = rreq_header->seq;
+  backoff->copies = 1;
+  backoff->distance = dist;
+  list_insert(nodedata->rreq_backoff_table, (void *) backoff);
+
+  return 0;
+}
+
+
+/** \brief Function to decide at the end of the backoff whether a RREQ rebroadcast is useless (AODV)
+ *  \fn int rreq_backoff_suppressed(call_t *to, struct rreq_packet_header *rreq_header)
+ *  \param c is a pointer to the called entity
+ *  \param rreq_header is a pointer to the RREQ header waiting for its rebroadcast
+ *  \return 1 if the rebroadcast has to be cancelled, 0 otherwise
+ **/
+int rreq_backoff_suppressed(call_t *to, struct rreq_packet_header *rreq_header) {
+  struct nodedata *nodedata = get_node_private_data(to);
+  struct rreq_backoff *backoff = NULL;
+  int suppressed = 0;
+
+  list_init_traverse(nodedata->rreq_backoff_table);
+  while((backoff = (struct rreq_backoff *) list_traverse(nodedata->rreq_backoff_table)) != NULL) {
+    if (backoff->src == rreq_header->src && backoff->dst == rreq_header->dst && backoff->data_type == rreq_header->data_type && backoff->seq == rreq_header->seq) {
+      break;
+    }
+  }
+
+  if (backoff == NULL) {
+    return 0;
+  }
+
+  /* counter based: enough copies heard, the neighborhood is covered */
+  if (nodedata->rreq_suppression_mode == RREQ_SUPPRESSION_COUNTER && backoff->copies >= nodedata->rreq_counter_threshold) {
+    suppressed = 1;
+  }
+  /* distance based: a sender is too close for a rebroadcast to cover a new area */
+  else if (nodedata->rreq_suppression_mode == RREQ_SUPPRESSION_DISTANCE && backoff->distance < nodedata->rreq_distance_threshold) {
+    suppressed = 1;
+  }
+
+  list_delete(nodedata->rreq_backoff_table, (void *) backoff);
+  free(backoff);
+
+  return suppressed;
+}
+
+
 /** \brief Function to check if RREQ  packet has already been sent (AODV)
  *  \fn int rreq_table_lookup(call_t *to, int src, int dst, int data_type, int seq)
  *  \param c is a pointer to the called entity
@@ -409,8 +568,7 @@ int rrep_transmission_from_sensor(call_t *to, call_t *from, void *args) {
   struct classdata *classdata = get_class_private_data(to);
   packet_t *packet_old = (packet_t *) args;
   
-  field_t *field_rreq_packet_header = packet_retrieve_field(packet_old, "rreq_packet_header");
-  struct rreq_packet_header* rreq_header = (struct rreq_packet_header*) field_getValue(field_rreq_packet_header);
+  struct rreq_packet_header* rreq_header = (struct rreq_packet_header*) packet_header_get(to, packet_old, HEADER_FIELD_RREQ);
   
   call_t to0   = {get_class_bindings_down(to)->elts[0], to->object};
   call_t from0 = {to->class, to->object};
@@ -17,6 +17,46 @@
  **/
 int rreq_propagation_callback(call_t *to, call_t *from, void *args);
 
+/** \brief Function to broadcast a new RREQ packet with a given TTL (AODV)
+ *  \fn int rreq_broadcast(call_t *to, int dst, int ttl)
+ *  \param c is a pointer to the called entity
+ *  \param dst is the ID of the destination
+ *  \param ttl is the number of hops the RREQ packet may travel
+ *  \return 0 if success, -1 otherwise
+ **/
+int rreq_broadcast(call_t *to, int dst, int ttl);
+
+/** \brief Function to start a route discovery towards a given destination, unless one is already in progress (AODV)
+ *  \fn int rreq_route_discovery(call_t *to, int dst)
+ *  \param c is a pointer to the called entity
+ *  \param dst is the ID of the destination
+ *  \return 0 if success, -1 otherwise
+ **/
+int rreq_route_discovery(call_t *to, int dst);
+
+/** \brief Function to broadcast a RREQ packet for a route discovery and to schedule its timeout (AODV)
+ *  \fn int rreq_route_discovery_attempt(call_t *to, struct pending_destination *pending)
+ *  \param c is a pointer to the called entity
+ *  \param pending is a pointer to the waiting packets entry of the destination
+ *  \return 0 if success, -1 otherwise
+ **/
+int rreq_route_discovery_attempt(call_t *to, struct pending_destination *pending);
+
+/** \brief Callback function for the end of a route discovery attempt (to be used with the scheduler_add_callback function) (AODV)
+ *  \fn int rreq_discovery_timeout_callback(call_t *to, call_t *from, void *args)
+ *  \param c is a pointer to the called entity
+ *  \param args is the ID of the destination
+ *  \return 0 if success, -1 otherwise
+ **/
+int rreq_discovery_timeout_callback(call_t *to, call_t *from, void *args);
+
+/** \brief Function to decide whether a periodic RREQ packet has to be built and sent (AODV)
+ *  \fn int rreq_should_send(call_t *to)
+ *  \param c is a pointer to the called entity
+ *  \return 1 if the RREQ packet has to be sent, 0 otherwise
+ **/
+int rreq_should_send(call_t *to);
+
 /** \brief Callback function for the periodic generation of RREQ packets in AODV (to be used with the scheduler_add_callback function).
  *  \fn int rreq_periodic_generation_callback(call_t *to, void *args)
  *  \param c is a pointer to the called entity
@@ -34,6 +74,22 @@ int rreq_periodic_generation_callback(call_t *to, call_t *from, void *args);
 int rreq_propagation(call_t *to, call_t *from, void *args);
 
 
+/** \brief Function to record a RREQ packet heard while waiting for its rebroadcast backoff (AODV)
+ *  \fn int rreq_backoff_update(call_t *to, struct rreq_packet_header *rreq_header)
+ *  \param c is a pointer to the called entity
+ *  \param rreq_header is a pointer to the received RREQ header
+ *  \return 0 if it is the first copy (the rebroadcast has to be scheduled), otherwise the number of heard copies
+ **/
+int rreq_backoff_update(call_t *to, struct rreq_packet_header *rreq_header);
+
+/** \brief Function to decide at the end of the backoff whether a RREQ rebroadcast is useless (AODV)
+ *  \fn int rreq_backoff_suppressed(call_t *to, struct rreq_packet_header *rreq_header)
+ *  \param c is a pointer to the called entity
+ *  \param rreq_header is a pointer to the RREQ header waiting for its rebroadcast
+ *  \return 1 if the rebroadcast has to be cancelled, 0 otherwise
+ **/
+int rreq_backoff_suppressed(call_t *to, struct rreq_packet_header *rreq_header);
+
 /** \brief Function to check if RREQ  packet has already been sent (AODV)
  *  \fn int rreq_table_lookup(call_t *to, int src, int dst, int data_type, int seq)
  *  \param c is a pointer to the called entity
@@ -12,6 +12,18 @@
 #include "routing_routes_management.h"
 #include "routing_sink_interest_management.h"
 
+/** \brief Function to decide whether a periodic Interest packet has to be built and sent (Directed Diffusion, ORACENET)
+ *  \fn int sink_interest_should_send(call_t *to)
+ *  \param c is a pointer to the called entity
+ *  \return 1 if the Interest packet has to be sent, 0 otherwise
+ **/
+int sink_interest_should_send(call_t *to) {
+  struct nodedata *nodedata = get_node_private_data(to);
+
+  /* only the sinks originate interests */
+  return (nodedata->sink_interest_status == STATUS_ON && nodedata->node_type == SINK_NODE);
+}
+
 /** \brief Callback function for the periodic dissemination of Interest packets in Directed Diffusion (to be used with the scheduler_add_callback function).
  *  \fn int sink_interest_propagation_callback(call_t *to, void *args)
  *  \param c is a pointer to the called entity
@@ -27,6 +39,96 @@ int sink_interest_propagation_callback(call_t *to, call_t *from, void *args) {
   
   destination_t destination = {BROADCAST_ADDR, {-1, -1, -1}};
 
+  /* build the interest packet only if it has to be sent */
+  if (sink_interest_should_send(to)) {
+    /* create a sink interest packet */
+    packet_t *packet = packet_create(to, nodedata->overhead + sizeof(struct packet_header)+sizeof(struct sink_interest_packet_header), nodedata->interest_packet_real_size*8);
+  
+    struct packet_header *header = malloc(sizeof(struct packet_header));
+    field_t *field_packet_header = field_create(INT, sizeof(struct packet_header), header);
+    packet_add_field(packet, "packet_header", field_packet_header);
+  
+    struct sink_interest_packet_header *interest_header = malloc(sizeof(struct sink_interest_packet_header));
+    field_t *field_interest_header = field_create(INT, sizeof(struct sink_interest_packet_header), interest_header);
+    packet_add_field(packet, "sink_interest_packet_header", field_interest_header);
+
+ 
+    /* set mac header */
+    if (SET_HEADER(&to0, to, packet, &destination) == -1) {
+      packet_dealloc(packet);
+      return -1;
+    }
+  
+    /* set basic packet header */
+    header->src = to->object;
+    header->dst = BROADCAST_ADDR;
+    header->type = nodedata->node_type;
+    header->packet_type = SINK_INTEREST_PACKET;
+
+    /* set basic packet header */
+    interest_header->sink_id = to->object;
+    interest_header->seq = nodedata->sink_interest_seq++;
+    interest_header->ttl = nodedata->sink_interest_ttl;
+    interest_header->ttl_max = nodedata->sink_interest_ttl;
+    interest_header->data_type = nodedata->sink_interest_data_type;
+    interest_header->position.x = get_node_position(to->object)->x;
+    interest_header->position.y = get_node_position(to->object)->y;
+    interest_header->position.z = get_node_position(to->object)->z;
+    interest_header->time         = get_time();
+    interest_header->reinforcement = REINFORCEMENT_NONE;
+
+    /* the advert carries the hello fields (ORACENET) */
+    oracenet_hello_piggyback(to, header, 0, 1.0, 1);
+  
+    /* send sink interest packet */
+    TX(&to0, &from0, packet);
+  
+    /* update local stats */
+    nodedata->tx_nbr[header->packet_type]++;
+  
+    /* update global stats */
+    classdata->current_tx_control_packet ++;
+    classdata->current_tx_control_packet_bytes += (packet->real_size/8);
+  
+#ifdef LOCALG_LOG_INTEREST_PROPAGATION
+    printf("[LOCALG_NET_IG] Time %lfs CC node %d propagate interest packet (seq=%d, data_type=%d, TTL=%d, DST=%d)\n", get_time()*0.000000001, to->object, interest_header->seq, interest_header->data_type, interest_header->ttl, destination.id);
+#endif
+  }
+
+  /* update nbr of transmitted sink interest packets */
+  if (nodedata->sink_interest_nbr > 0) {
+    nodedata->sink_interest_nbr--;
+  }
+  
+  /* schedules next sink interest packet transmission */
+  if (nodedata->sink_interest_nbr > 0 || nodedata->sink_interest_nbr == -1) {
+    nodedata->previous_sink_interest_slot_time += nodedata->sink_interest_period;
+    scheduler_add_callback(nodedata->previous_sink_interest_slot_time + get_random_double() * nodedata->sink_interest_period, to, from, sink_interest_propagation_callback, NULL);
+  }
+
+  return 0;
+}
+
+/** \brief Function to send a positive or negative reinforcement to a neighbor (Directed Diffusion)
+ *  \fn int sink_interest_reinforcement(call_t *to, int neighbor, int sink_id, int data_type, int seq, int hop_to_sink, int reinforcement)
+ *  \param c is a pointer to the called entity
+ *  \param neighbor is the ID of the reinforced neighbor
+ *  \param sink_id is the sink ID
+ *  \param data_type is the requested data type
+ *  \param seq is the sequence number of the reinforcement
+ *  \param hop_to_sink is the number of hops from the local node to the sink
+ *  \param reinforcement is REINFORCEMENT_POSITIVE or REINFORCEMENT_NEGATIVE
+ *  \return 0 if success, -1 otherwise
+ **/
+int sink_interest_reinforcement(call_t *to, int neighbor, int sink_id, int data_type, int seq, int hop_to_sink, int reinforcement) {
+  struct nodedata *nodedata = get_node_private_data(to);
+  struct classdata *classdata = get_class_private_data(to);
+  
+  call_t to0   = {get_class_bindings_down(to)->elts[0], to->object};
+  call_t from0 = {to->class, to->object};
+  
+  destination_t destination = {neighbor, {-1, -1, -1}};
+
   packet_t *packet = packet_create(to, nodedata->overhead + sizeof(struct packet_header)+sizeof(struct sink_interest_packet_header), nodedata->interest_packet_real_size*8);
   
   struct packet_header *header = malloc(sizeof(struct packet_header));
@@ -37,7 +139,6 @@ int sink_interest_propagation_callback(call_t *to, call_t *from, void *args) {
   field_t *field_interest_header = field_create(INT, sizeof(struct sink_interest_packet_header), interest_header);
   packet_add_field(packet, "sink_interest_packet_header", field_interest_header);
 
- 
   /* set mac header */
   if (SET_HEADER(&to0, to, packet, &destination) == -1) {
     packet_dealloc(packet);
@@ -46,22 +147,23 @@ int sink_interest_propagation_callback(call_t *to, call_t *from, void *args) {
   
   /* set basic packet header */
   header->src = to->object;
-  header->dst = BROADCAST_ADDR;
+  header->dst = neighbor;
   header->type = nodedata->node_type;
   header->packet_type = SINK_INTEREST_PACKET;
 
-  /* set basic packet header */
-  interest_header->sink_id = to->object;
-  interest_header->seq = nodedata->sink_interest_seq++;
-  interest_header->ttl = nodedata->sink_interest_ttl;
-  interest_header->ttl_max = nodedata->sink_interest_ttl;
-  interest_header->data_type = nodedata->sink_interest_data_type;
+  /* set the reinforcement header: the receiver is one hop further from the sink */
+  interest_header->sink_id = sink_id;
+  interest_header->seq = seq;
+  interest_header->ttl = 1;
+  interest_header->ttl_max = hop_to_sink + 1;
+  interest_header->data_type = data_type;
+  interest_header->reinforcement = reinforcement;
   interest_header->position.x = get_node_position(to->object)->x;
   interest_header->position.y = get_node_position(to->object)->y;
   interest_header->position.z = get_node_position(to->object)->z;
-  interest_header->time         = get_time();
+  interest_header->time = get_time();
   
-  /* send sink interest packet */
+  /* send the reinforcement */
   TX(&to0, &from0, packet);
   
   /* update local stats */
@@ -70,111 +172,248 @@ int sink_interest_propagation_callback(call_t *to, call_t *from, void *args) {
   /* update global stats */
   classdata->current_tx_control_packet ++;
   classdata->current_tx_control_packet_bytes += (packet->real_size/8);
-  
+
 #ifdef LOCALG_LOG_INTEREST_PROPAGATION
-  printf("[LOCALG_NET_IG] Time %lfs CC node %d propagate interest packet (seq=%d, data_type=%d, TTL=%d, DST=%d)\n", get_time()*0.000000001, to->object, interest_header->seq, interest_header->data_type, interest_header->ttl, destination.id);
+  printf("[LOCALG_NET_IG] Time %lfs node %d sends a %s reinforcement to node %d (sink=%d, data_type=%d, seq=%d)\n", get_time()*0.000000001, to->object, (reinforcement == REINFORCEMENT_POSITIVE) ? "positive" : "negative", neighbor, sink_id, data_type, seq);
 #endif
 
-  /* update nbr of transmitted sink interest packets */
-  if (nodedata->sink_interest_nbr > 0) {
-    nodedata->sink_interest_nbr--;
+  return 0;
+}
+
+/** \brief Function to process the Interests carried by a received Interest packet (Directed Diffusion, ORACENET)
+ *  \fn int sink_interest_receive(call_t *to, packet_t *packet, struct packet_header *header, struct sink_interest_packet_header *interest_header, int (*update)(call_t *, struct packet_header *, struct sink_interest_packet_header *))
+ *  \param c is a pointer to the called entity
+ *  \param packet is a pointer to the received packet (destroyed by the function)
+ *  \param header is a pointer to the packet header of the received packet
+ *  \param interest_header is a pointer to the interest header of the received packet
+ *  \param update is the routing update function called once per carried Interest
+ *  \return 0 if success, -1 otherwise
+ **/
+int sink_interest_receive(call_t *to, packet_t *packet, struct packet_header *header, struct sink_interest_packet_header *interest_header, int (*update)(call_t *, struct packet_header *, struct sink_interest_packet_header *)) {
+  struct sink_interest_aggregate_header *aggregate_header = (struct sink_interest_aggregate_header*) packet_header_get(to, packet, HEADER_FIELD_SINK_INTEREST_AGGREGATE);
+  int i = 0;
+
+  /* the first Interest is carried in the usual header, the aggregated ones follow */
+  do {
+    if (i > 0) {
+      *interest_header = aggregate_header->interests[i-1];
+    }
+    update(to, header, interest_header);
+    sink_interest_enqueue(to, header, interest_header);
+    i++;
+  } while (aggregate_header != NULL && i <= aggregate_header->interests_nbr);
+
+  /* the packet is no longer needed: only the pending Interests are kept */
+  packet_dealloc(packet);
+  return 0;
+}
+
+
+/** \brief Function to schedule the rebroadcast of a received Interest, dropping duplicates and merging pending copies (Directed Diffusion, ORACENET)
+ *  \fn int sink_interest_enqueue(call_t *to, struct packet_header *header, struct sink_interest_packet_header *interest_header)
+ *  \param c is a pointer to the called entity
+ *  \param header is a pointer to the packet header of the received copy
+ *  \param interest_header is a pointer to the received Interest
+ *  \return 1 if the Interest is pending, 0 if dropped
+ **/
+int sink_interest_enqueue(call_t *to, struct packet_header *header, struct sink_interest_packet_header *interest_header) {
+  struct nodedata *nodedata = get_node_private_data(to);
+  struct pending_interest *pending;
+  call_t from = {-1, -1};
+
+  /* already rebroadcast */
+  if (sink_interest_table_lookup(to, interest_header->sink_id, interest_header->data_type, interest_header->seq)) {
+#ifdef LOCALG_LOG_INTEREST_PROPAGATION
+    printf("[LOCALG_NET_IG] Time %lfs Node %d drop the interest packet from SINK %d  seq=%d  (TTL=%d) => already sent !\n", get_time()*0.000000001, to->object, interest_header->sink_id, interest_header->seq, interest_header->ttl);
+#endif
+    return 0;
   }
-  
-  /* schedules next sink interest packet transmission */
-  if (nodedata->sink_interest_nbr > 0 || nodedata->sink_interest_nbr == -1) {
-    nodedata->previous_sink_interest_slot_time += nodedata->sink_interest_period;
-    scheduler_add_callback(nodedata->previous_sink_interest_slot_time + get_random_double() * nodedata->sink_interest_period, to, from, sink_interest_propagation_callback, NULL);
+
+  /* a rebroadcast is already pending for this (sink, data type) */
+  list_init_traverse(nodedata->interest_pending);
+  while ((pending = (struct pending_interest *) list_traverse(nodedata->interest_pending)) != NULL) {
+    if (pending->interest.sink_id != interest_header->sink_id || pending->interest.data_type != interest_header->data_type) {
+      continue;
+    }
+    /* older copy: drop it */
+    if (pending->interest.seq > interest_header->seq) {
+      return 0;
+    }
+    /* newer Interest: it cancels the pending one; same Interest: keep the copy with the largest TTL */
+    if (pending->interest.seq < interest_header->seq || pending->interest.ttl < interest_header->ttl) {
+      pending->header = *header;
+      pending->interest = *interest_header;
+    }
+    return 1;
   }
 
-  return 0;
+  pending = (struct pending_interest *) malloc(sizeof(struct pending_interest));
+  pending->header = *header;
+  pending->interest = *interest_header;
+  list_insert(nodedata->interest_pending, (void *) pending);
+
+  /* a single backoff timer serves all the pending Interests */
+  if (nodedata->interest_flush_scheduled == 0) {
+    nodedata->interest_flush_scheduled = 1;
+    scheduler_add_callback(get_time() + get_random_double() * nodedata->sink_interest_propagation_backoff, to, &from, sink_interest_flush_callback, NULL);
+  }
+
+  return 1;
 }
 
-/** \brief Function to propagate received Interest packets (Directed Diffusion)
- *  \fn int sink_interest_propagation(call_t *to, void *args);
+
+/** \brief Function to broadcast a set of Interests within a single packet (Directed Diffusion, ORACENET)
+ *  \fn int sink_interest_aggregate_send(call_t *to, struct packet_header *model, struct sink_interest_packet_header *interests, int interests_nbr)
  *  \param c is a pointer to the called entity
- *  \param args is a pointer to the arguments of the function
+ *  \param model is a pointer to the packet header of the first Interest
+ *  \param interests is the array of Interests to send
+ *  \param interests_nbr is the number of Interests to send
  *  \return 0 if success, -1 otherwise
  **/
-int sink_interest_propagation(call_t *to, call_t *from, void *args) {
+int sink_interest_aggregate_send(call_t *to, struct packet_header *model, struct sink_interest_packet_header *interests, int interests_nbr) {
   struct nodedata *nodedata = get_node_private_data(to);
   struct classdata *classdata = get_class_private_data(to);
-  packet_t *packet = (packet_t *) args;
-  
-  
-  field_t *field_header = packet_retrieve_field(packet, "packet_header");
-  struct packet_header* header = (struct packet_header*) field_getValue(field_header);
-  field_t *field_interest_header = packet_retrieve_field(packet, "sink_interest_packet_header");
-  struct sink_interest_packet_header* interest_header = (struct sink_interest_packet_header*) field_getValue(field_interest_header);
   
   call_t to0   = {get_class_bindings_down(to)->elts[0], to->object};
   call_t from0 = {to->class, to->object};
 
   destination_t destination = {BROADCAST_ADDR, {-1, -1, -1}};
+  int i = 0;
+
+  /* the headers are charged once with the first Interest, each aggregated Interest only adds its own entry */
+  packet_t *packet = packet_create(to, nodedata->overhead + sizeof(struct packet_header) + sizeof(struct sink_interest_packet_header) + sizeof(struct sink_interest_aggregate_header), (nodedata->interest_packet_real_size + nodedata->interest_entry_real_size*(interests_nbr-1))*8);
+
+  struct packet_header *header = malloc(sizeof(struct packet_header));
+  field_t *field_packet_header = field_create(INT, sizeof(struct packet_header), header);
+  packet_add_field(packet, "packet_header", field_packet_header);
   
-  /* update TTL */
-  if (interest_header->ttl > 0) {
-    interest_header->ttl --;
-  }
+  struct sink_interest_packet_header *interest_header = malloc(sizeof(struct sink_interest_packet_header));
+  field_t *field_interest_header = field_create(INT, sizeof(struct sink_interest_packet_header), interest_header);
+  packet_add_field(packet, "sink_interest_packet_header", field_interest_header);
 
-  /* drop sink interest packet if TTL is 0 */
-  if (interest_header->ttl <= 0) {
-#ifdef LOCALG_LOG_INTEREST_PROPAGATION
-    printf("[LOCALG_NET_IG] Time %lfs Node %d drop the interest packet from SINK %d  seq=%d  (TTL=%d) => TTL!\n", get_time()*0.000000001, to->object, interest_header->sink_id, interest_header->seq, interest_header->ttl);
-#endif
+  struct sink_interest_aggregate_header *aggregate_header = malloc(sizeof(struct sink_interest_aggregate_header));
+  field_t *field_aggregate_header = field_create(INT, sizeof(struct sink_interest_aggregate_header), aggregate_header);
+  packet_add_field(packet, "sink_interest_aggregate_header", field_aggregate_header);
+
+  /* set mac header */
+  if (SET_HEADER(&to0, to, packet, &destination) == -1) {
     packet_dealloc(packet);
-    return 0;
+    return -1;
   }
 
-  /* drop the sink interest packet according to a given probability */
-  if (get_random_double_range(0.0, 1.0) > nodedata->sink_interest_propagation_probability) {
-#ifdef LOCALG_LOG_INTEREST_PROPAGATION
-    printf("[LOCALG_NET_IG] Time %lfs Node %d drop the interest packet from SINK %d  seq=%d  (TTL=%d) => probability !\n", get_time()*0.000000001, to->object, interest_header->sink_id, interest_header->seq, interest_header->ttl);
-#endif
-    packet_dealloc(packet);   
-    return 0;
+  /* update basic packet header */
+  *header = *model;
+  header->src = to->object;
+  header->type = nodedata->node_type;
+
+  /* set the Interests */
+  *interest_header = interests[0];
+  aggregate_header->interests_nbr = interests_nbr - 1;
+  for (i = 1; i < interests_nbr; i++) {
+    aggregate_header->interests[i-1] = interests[i];
   }
 
-  /* broadcast packet only once */
-  if (sink_interest_table_lookup(to, interest_header->sink_id, interest_header->data_type, interest_header->seq) == 0) {
-    
-    /* set mac header */
-    if (SET_HEADER(&to0, to, packet, &destination) == -1) {
-      packet_dealloc(packet);
-      return 0;
-    }
-  
-    /* update basic packet header */
-    header->src = to->object;
-    header->type = nodedata->node_type;
+  /* the advert carries the hello fields (ORACENET) */
+  oracenet_hello_piggyback(to, header, interests[0].ttl_max - interests[0].ttl, header->E2E_PRR, 1);
 
-    /* send sink interest packet */
-    TX(&to0, &from0, packet);
+  /* send sink interest packet */
+  TX(&to0, &from0, packet);
     
-    /* update local stats */
-    nodedata->tx_nbr[header->packet_type]++;
+  /* update local stats */
+  nodedata->tx_nbr[header->packet_type]++;
     
-    /* update global stats */
-    classdata->current_tx_control_packet ++;
-    classdata->current_tx_control_packet_bytes += (packet->real_size/8);
+  /* update global stats */
+  classdata->current_tx_control_packet ++;
+  classdata->current_tx_control_packet_bytes += (packet->real_size/8);
   
 #ifdef LOCALG_LOG_INTEREST_PROPAGATION
-    printf("[LOCALG_NET_IG] Time %lfs Node %d broadcast interest packet from SINK %d  seq=%d  (TTL=%d) \n", get_time()*0.000000001, to->object, interest_header->sink_id, interest_header->seq, interest_header->ttl);
+  for (i = 0; i < interests_nbr; i++) {
+    printf("[LOCALG_NET_IG] Time %lfs Node %d broadcast interest packet from SINK %d  seq=%d  (TTL=%d) \n", get_time()*0.000000001, to->object, interests[i].sink_id, interests[i].seq, interests[i].ttl);
+  }
 #endif
 
-    sink_interest_table_update(to, interest_header->sink_id, interest_header->data_type, interest_header->seq);
-  }
-  /* Otherwise destroy the received interest packet*/
-  else {
+  return 0;
+}
+
+
+/** \brief Callback function to rebroadcast the pending Interests, aggregated per packet (to be used with the scheduler_add_callback function).
+ *  \fn int sink_interest_flush_callback(call_t *to, call_t *from, void *args)
+ *  \param c is a pointer to the called entity
+ *  \param args is a pointer to the arguments of the function
+ *  \return 0 if success, -1 otherwise
+ **/
+int sink_interest_flush_callback(call_t *to, call_t *from, void *args) {
+  struct nodedata *nodedata = get_node_private_data(to);
+  struct pending_interest *pending;
+  struct packet_header model;
+  struct sink_interest_packet_header interests[MAX_AGGREGATED_INTERESTS];
+  int interests_nbr = 0;
+
+  nodedata->interest_flush_scheduled = 0;
+
+  while ((pending = (struct pending_interest *) list_pop(nodedata->interest_pending)) != NULL) {
+    
+    /* update TTL */
+    if (pending->interest.ttl > 0) {
+      pending->interest.ttl --;
+    }
+
+    /* drop sink interest if TTL is 0 */
+    if (pending->interest.ttl <= 0) {
 #ifdef LOCALG_LOG_INTEREST_PROPAGATION
-    printf("[LOCALG_NET_IG] Time %lfs Node %d drop the interest packet from SINK %d  seq=%d  (TTL=%d) => already sent !\n", get_time()*0.000000001, to->object, interest_header->sink_id, interest_header->seq, interest_header->ttl);
+      printf("[LOCALG_NET_IG] Time %lfs Node %d drop the interest packet from SINK %d  seq=%d  (TTL=%d) => TTL!\n", get_time()*0.000000001, to->object, pending->interest.sink_id, pending->interest.seq, pending->interest.ttl);
 #endif
-    packet_dealloc(packet);
+      free(pending);
+      continue;
+    }
+
+    /* drop the sink interest according to a given probability */
+    if (get_random_double_range(0.0, 1.0) > nodedata->sink_interest_propagation_probability) {
+#ifdef LOCALG_LOG_INTEREST_PROPAGATION
+      printf("[LOCALG_NET_IG] Time %lfs Node %d drop the interest packet from SINK %d  seq=%d  (TTL=%d) => probability !\n", get_time()*0.000000001, to->object, pending->interest.sink_id, pending->interest.seq, pending->interest.ttl);
+#endif
+      free(pending);
+      continue;
+    }
+
+    /* broadcast each Interest only once */
+    sink_interest_table_update(to, pending->interest.sink_id, pending->interest.data_type, pending->interest.seq);
+
+    if (interests_nbr == 0) {
+      model = pending->header;
+    }
+    interests[interests_nbr++] = pending->interest;
+    free(pending);
+
+    if (interests_nbr == nodedata->interest_aggregation_size) {
+      sink_interest_aggregate_send(to, &model, interests, interests_nbr);
+      interests_nbr = 0;
+    }
   }
-  
+
+  if (interests_nbr > 0) {
+    sink_interest_aggregate_send(to, &model, interests, interests_nbr);
+  }
+
   return 0;
 }
 
 
+/** \brief Function to destroy the pending Interests (Directed Diffusion, ORACENET)
+ *  \fn void sink_interest_pending_destroy(call_t *to)
+ *  \param c is a pointer to the called entity
+ **/
+void sink_interest_pending_destroy(call_t *to) {
+  struct nodedata *nodedata = get_node_private_data(to);
+  struct pending_interest *pending;
+
+  while ((pending = (struct pending_interest *) list_pop(nodedata->interest_pending)) != NULL) {
+    free(pending);
+  }
+  list_destroy(nodedata->interest_pending);
+}
+
+
 /** \brief Function to check if Interest packet has already been sent (Directed Diffusion)
  *  \fn int sink_interest_table_lookup(call_t *to, int sink_id, int data_type, int seq);
  *  \param c is a pointer to the called entity
@@ -211,7 +450,11 @@ void sink_interest_table_update(call_t *to, int sink_id, int data_type, int seq)
 
   list_init_traverse(nodedata->interest_table);
   while((interest = (struct interest *) list_traverse(nodedata->interest_table)) != NULL) {
-    if (interest->sink_id == sink_id && interest->data_type == data_type && interest->seq > seq) {
+    if (interest->sink_id == sink_id && interest->data_type == data_type) {
+      /* keep a single entry per (sink, data type) */
+      if (interest->seq >= seq) {
+        return;
+      }
       interest->seq = seq;
       interest->time = get_time();
       return;
@@ -8,6 +8,12 @@
 #ifndef  __routing_sink_interest_management__
 #define  __routing_sink_interest_management__
 
+/** \brief Function to decide whether a periodic Interest packet has to be built and sent (Directed Diffusion, ORACENET)
+ *  \fn int sink_interest_should_send(call_t *to)
+ *  \param c is a pointer to the called entity
+ *  \return 1 if the Interest packet has to be sent, 0 otherwise
+ **/
+int sink_interest_should_send(call_t *to);
 
 /** \brief Callback function for the periodic dissemination of Interest packets in Directed Diffusion (to be used with the scheduler_add_callback function).
  *  \fn int sink_interest_propagation_callback(call_t *to, void *args)
@@ -17,14 +23,63 @@
  **/
 int sink_interest_propagation_callback(call_t *to, call_t *from, void *args);
 
- 
-/** \brief Function to propagate received Interest packets (Directed Diffusion)
- *  \fn int sink_interest_propagation(call_t *to, void *args);
+
+/** \brief Function to send a positive or negative reinforcement to a neighbor (Directed Diffusion)
+ *  \fn int sink_interest_reinforcement(call_t *to, int neighbor, int sink_id, int data_type, int seq, int hop_to_sink, int reinforcement)
+ *  \param c is a pointer to the called entity
+ *  \param neighbor is the ID of the reinforced neighbor
+ *  \param sink_id is the sink ID
+ *  \param data_type is the requested data type
+ *  \param seq is the sequence number of the reinforcement
+ *  \param hop_to_sink is the number of hops from the local node to the sink
+ *  \param reinforcement is REINFORCEMENT_POSITIVE or REINFORCEMENT_NEGATIVE
+ *  \return 0 if success, -1 otherwise
+ **/
+int sink_interest_reinforcement(call_t *to, int neighbor, int sink_id, int data_type, int seq, int hop_to_sink, int reinforcement);
+
+/** \brief Function to process the Interests carried by a received Interest packet (Directed Diffusion, ORACENET)
+ *  \fn int sink_interest_receive(call_t *to, packet_t *packet, struct packet_header *header, struct sink_interest_packet_header *interest_header, int (*update)(call_t *, struct packet_header *, struct sink_interest_packet_header *))
+ *  \param c is a pointer to the called entity
+ *  \param packet is a pointer to the received packet (destroyed by the function)
+ *  \param header is a pointer to the packet header of the received packet
+ *  \param interest_header is a pointer to the interest header of the received packet
+ *  \param update is the routing update function called once per carried Interest
+ *  \return 0 if success, -1 otherwise
+ **/
+int sink_interest_receive(call_t *to, packet_t *packet, struct packet_header *header, struct sink_interest_packet_header *interest_header, int (*update)(call_t *, struct packet_header *, struct sink_interest_packet_header *));
+
+/** \brief Function to schedule the rebroadcast of a received Interest, dropping duplicates and merging pending copies (Directed Diffusion, ORACENET)
+ *  \fn int sink_interest_enqueue(call_t *to, struct packet_header *header, struct sink_interest_packet_header *interest_header)
+ *  \param c is a pointer to the called entity
+ *  \param header is a pointer to the packet header of the received copy
+ *  \param interest_header is a pointer to the received Interest
+ *  \return 1 if the Interest is pending, 0 if dropped
+ **/
+int sink_interest_enqueue(call_t *to, struct packet_header *header, struct sink_interest_packet_header *interest_header);
+
+/** \brief Function to broadcast a set of Interests within a single packet (Directed Diffusion, ORACENET)
+ *  \fn int sink_interest_aggregate_send(call_t *to, struct packet_header *model, struct sink_interest_packet_header *interests, int interests_nbr)
+ *  \param c is a pointer to the called entity
+ *  \param model is a pointer to the packet header of the first Interest
+ *  \param interests is the array of Interests to send
+ *  \param interests_nbr is the number of Interests to send
+ *  \return 0 if success, -1 otherwise
+ **/
+int sink_interest_aggregate_send(call_t *to, struct packet_header *model, struct sink_interest_packet_header *interests, int interests_nbr);
+
+/** \brief Callback function to rebroadcast the pending Interests, aggregated per packet (to be used with the scheduler_add_callback function).
+ *  \fn int sink_interest_flush_callback(call_t *to, call_t *from, void *args)
  *  \param c is a pointer to the called entity
  *  \param args is a pointer to the arguments of the function
  *  \return 0 if success, -1 otherwise
  **/
-int sink_interest_propagation(call_t *to, call_t *from, void *args);
+int sink_interest_flush_callback(call_t *to, call_t *from, void *args);
+
+/** \brief Function to destroy the pending Interests (Directed Diffusion, ORACENET)
+ *  \fn void sink_interest_pending_destroy(call_t *to)
+ *  \param c is a pointer to the called entity
+ **/
+void sink_interest_pending_destroy(call_t *to);
 
 
 /** \brief Function to check if Interest packet has already been sent (Directed Diffusion)